@@ -0,0 +1,104 @@
+#ifndef DUNE_OSEEN_ALLOCATION_COUNTER_HH
+#define DUNE_OSEEN_ALLOCATION_COUNTER_HH
+
+#include <cmake_config.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+#ifndef OSEEN_COUNT_ALLOCATIONS
+	#define OSEEN_COUNT_ALLOCATIONS 0
+#endif
+
+namespace Dune {
+namespace Oseen {
+
+/** \brief global count of operator new calls
+	Counting only happens if the executable was configured with ENABLE_ALLOCATION_COUNTER and exactly one
+	translation unit defines OSEEN_ALLOCATION_COUNTER_HOOKS before including this header, which then
+	replaces the global allocation operators. Otherwise count() stays at zero and enabled() is false.
+	The count is atomic since threaded code (USE_OMP) allocates concurrently.
+  **/
+struct AllocationCounter
+{
+	static std::atomic< std::size_t >& count()
+	{
+		static std::atomic< std::size_t > allocations( 0 );
+		return allocations;
+	}
+
+	static bool enabled() { return OSEEN_COUNT_ALLOCATIONS; }
+
+	//! number of allocations since construction
+	class Scope
+	{
+		public:
+			Scope() : start_( AllocationCounter::count() ) {}
+			std::size_t allocations() const { return AllocationCounter::count() - start_; }
+			void reset() { start_ = AllocationCounter::count(); }
+		private:
+			std::size_t start_;
+	};
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#if OSEEN_COUNT_ALLOCATIONS && defined(OSEEN_ALLOCATION_COUNTER_HOOKS)
+void* operator new( std::size_t size )
+{
+	++Dune::Oseen::AllocationCounter::count();
+	void* ptr = std::malloc( size ? size : 1 );
+	if ( !ptr )
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[]( std::size_t size )
+{
+	return operator new( size );
+}
+
+void operator delete( void* ptr ) noexcept
+{
+	std::free( ptr );
+}
+
+void operator delete[]( void* ptr ) noexcept
+{
+	std::free( ptr );
+}
+#endif
+
+#endif // DUNE_OSEEN_ALLOCATION_COUNTER_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
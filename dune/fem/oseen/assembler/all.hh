@@ -5,6 +5,7 @@
 #include <dune/fem/oseen/assembler/w.hh>
 #include <dune/fem/oseen/assembler/e.hh>
 #include <dune/fem/oseen/assembler/m.hh>
+#include <dune/fem/oseen/assembler/mp.hh>
 #include <dune/fem/oseen/assembler/o.hh>
 #include <dune/fem/oseen/assembler/r.hh>
 #include <dune/fem/oseen/assembler/x.hh>
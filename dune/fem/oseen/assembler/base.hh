@@ -4,10 +4,16 @@
 #include <dune/stuff/grid/entity.hh>
 #include <dune/stuff/common/misc.hh>
 #include <dune/stuff/common/profiler.hh>
-#include <dune/stuff/fem/localmatrix_proxy.hh>
+#include <dune/fem/oseen/assembler/localmatrix_proxy.hh>
 #include <dune/fem/oseen/stab_coeff.hh>
+#include <dune/fem/oseen/assembler/element_graph.hh>
+#include <dune/fem/oseen/allocation_counter.hh>
 
 #include <boost/integer/static_min_max.hpp>
+#include <string>
+#include <new>
+#include <utility>
+#include <type_traits>
 
 
 namespace Dune {
@@ -126,6 +132,44 @@ namespace Assembler {
                                       + 1 ) ;
     };
 
+	/** \brief storage for one T that is built and rebuilt in place, never on the heap
+		build() destroys the previous object first, so T needs no assignment (the info containers hold references)
+	  **/
+	template < class T >
+	class InPlace
+	{
+		public:
+			InPlace()
+				: built_( false )
+			{}
+
+			~InPlace() { clear(); }
+
+			template < class... Args >
+			const T& build( Args&&... args )
+			{
+				clear();
+				new ( &storage_ ) T( std::forward< Args >( args )... );
+				built_ = true;
+				return get();
+			}
+
+			void clear()
+			{
+				if ( built_ )
+					get().~T();
+				built_ = false;
+			}
+
+			const T& get() const { return *reinterpret_cast< const T* >( &storage_ ); }
+
+		private:
+			InPlace( const InPlace& );
+
+			typename std::aligned_storage< sizeof(T), alignof(T) >::type storage_;
+			bool built_;
+	};
+
 	template < class Traits, class IntegratorTuple >
 	class Coordinator
 	{
@@ -171,6 +215,32 @@ namespace Assembler {
 					sigma_space_(sigma_space)
 		{}
 
+		/** \brief loop invariant assembly data
+			Everything in here used to be looked up (by string key) for every single element and face.
+			It is built once per apply() and shared by all info containers of that traversal.
+		  **/
+		struct AssemblyContext {
+			const double eps;
+			const int penalty_form;
+			const StabilizationCoefficients& stabil_coeff;
+			const StabilizationCoefficients::FactorType C11_factor;
+			const StabilizationCoefficients::FactorType D11_factor;
+			const StabilizationCoefficients::FactorType D12_factor;
+			const StabilizationCoefficients::PowerType C11_power;
+			const StabilizationCoefficients::PowerType D11_power;
+
+			AssemblyContext( const typename Traits::DiscreteModelType& discrete_modelIn )
+				: eps( DSC_CONFIG_GET( "eps", 1.0e-14 ) ),
+				  penalty_form( DSC_CONFIG_GET( "penalty_form", 1 ) ),
+				  stabil_coeff( discrete_modelIn.getStabilizationCoefficients() ),
+				  C11_factor( stabil_coeff.Factor("C11") ),
+				  D11_factor( stabil_coeff.Factor("D11") ),
+				  D12_factor( stabil_coeff.Factor("D12") ),
+				  C11_power( stabil_coeff.Power("C11") ),
+				  D11_power( stabil_coeff.Power("D11") )
+			{}
+		};
+
 		//! just to avoid overly long argument lists
 		struct InfoContainerVolume {
 			const typename Traits::EntityType& entity;
@@ -195,6 +265,7 @@ namespace Assembler {
 			const double alpha;
 			const typename Traits::GridPartType& grid_part;
 			InfoContainerVolume(const CoordinatorType& interface,
+								const AssemblyContext& context,
 								const typename Traits::EntityType& ent,
 								const typename Traits::DiscreteModelType& discrete_modelIn,
 								const typename Traits::GridPartType& grid_partIn)
@@ -208,16 +279,39 @@ namespace Assembler {
                   numPressureBaseFunctionsElement( pressure_basefunction_set_element.size() ),
                   volumeQuadratureElement( entity, PolOrder<Traits>::value ),
 				  discrete_model( discrete_modelIn ),
-				  eps( DSC_CONFIG_GET( "eps", 1.0e-14 ) ),
+				  eps( context.eps ),
 				  viscosity( discrete_modelIn.viscosity() ),
 				  convection_scaling( discrete_modelIn.convection_scaling() ),
 				  pressure_gradient_scaling( discrete_modelIn.pressure_gradient_scaling() ),
 				  alpha( discrete_modelIn.alpha() ),
 				  grid_part( grid_partIn )
 			{}
-			virtual ~InfoContainerVolume() {}
 		};
-		struct InfoContainerFace : public InfoContainerVolume {
+
+		/** the element part is referenced from the element's InfoContainerVolume (same member names as there),
+			so a face only builds its own geometry, quadrature and penalties
+		  **/
+		struct InfoContainerFace {
+			const typename Traits::EntityType& entity;
+            const typename Traits::EntityType::Geometry& geometry;
+			const SigmaBaseFunctionSetType&
+					sigma_basefunction_set_element;
+			const VelocityBaseFunctionSetType&
+					velocity_basefunction_set_element;
+			const PressureBaseFunctionSetType&
+					pressure_basefunction_set_element;
+			const int numSigmaBaseFunctionsElement;
+			const int numVelocityBaseFunctionsElement;
+			const int numPressureBaseFunctionsElement;
+			const typename Traits::VolumeQuadratureType& volumeQuadratureElement;
+			const typename Traits::DiscreteModelType&	discrete_model;
+			const double eps;
+			const double viscosity;
+			const double convection_scaling;
+			const double pressure_gradient_scaling;
+			const double alpha;
+			const typename Traits::GridPartType& grid_part;
+
             const typename Traits::IntersectionIteratorType::Intersection& intersection;
             const typename Traits::IntersectionIteratorType::Intersection::Geometry intersectionGeometry;
 			const typename Traits::FaceQuadratureType faceQuadratureElement;
@@ -228,25 +322,39 @@ namespace Assembler {
 			typename Traits::VelocityRangeType D_12;
 
 			InfoContainerFace (const CoordinatorType& interface,
-								const typename Traits::EntityType& ent,
-							   const typename Traits::IntersectionIteratorType::Intersection& inter,
-								const typename Traits::DiscreteModelType& discrete_modelIn,
-							   const typename Traits::GridPartType& grid_partIn )
-				:InfoContainerVolume( interface, ent, discrete_modelIn, grid_partIn ),
+								const AssemblyContext& context,
+								const InfoContainerVolume& element,
+							   const typename Traits::IntersectionIteratorType::Intersection& inter )
+				: entity( element.entity ),
+				  geometry( element.geometry ),
+				  sigma_basefunction_set_element( element.sigma_basefunction_set_element ),
+				  velocity_basefunction_set_element( element.velocity_basefunction_set_element ),
+				  pressure_basefunction_set_element( element.pressure_basefunction_set_element ),
+				  numSigmaBaseFunctionsElement( element.numSigmaBaseFunctionsElement ),
+				  numVelocityBaseFunctionsElement( element.numVelocityBaseFunctionsElement ),
+				  numPressureBaseFunctionsElement( element.numPressureBaseFunctionsElement ),
+				  volumeQuadratureElement( element.volumeQuadratureElement ),
+				  discrete_model( element.discrete_model ),
+				  eps( element.eps ),
+				  viscosity( element.viscosity ),
+				  convection_scaling( element.convection_scaling ),
+				  pressure_gradient_scaling( element.pressure_gradient_scaling ),
+				  alpha( element.alpha ),
+				  grid_part( element.grid_part ),
 				  intersection( inter ),
 				  intersectionGeometry( intersection.geometry() ),
 				  faceQuadratureElement( interface.sigma_space_.gridPart(),
 																  intersection,
                                                                   PolOrder<Traits>::value,
 																  Traits::FaceQuadratureType::INSIDE ),
-                  lengthOfIntersection( intersection.geometry().volume() ),
-				  stabil_coeff( discrete_modelIn.getStabilizationCoefficients() ),
-				  C_11( penalty<-1>(ent,intersection, stabil_coeff, lengthOfIntersection ) ),
-				  D_11( penalty<1>(ent,intersection, stabil_coeff, lengthOfIntersection ) ),
+                  lengthOfIntersection( intersectionGeometry.volume() ),
+				  stabil_coeff( context.stabil_coeff ),
+				  C_11( penalty<-1>(entity,intersection, context, lengthOfIntersection ) ),
+				  D_11( penalty<1>(entity,intersection, context, lengthOfIntersection ) ),
 				  D_12( 1 )//vector!
 			{
 				D_12 /= D_12.two_norm();
-				D_12 *= stabil_coeff.Factor("D12");
+				D_12 *= context.D12_factor;
 			}
 		};
 
@@ -260,11 +368,10 @@ namespace Assembler {
 		static double penalty(const typename Traits::EntityType& entity,
 							  const typename Traits::EntityType& neighbour,
 							  const typename Traits::IntersectionIteratorType::Intersection& intersection,
-							  const Dune::StabilizationCoefficients& stabil_coeff,
+							  const AssemblyContext& context,
 							  const double lengthOfIntersection )
 		{
-			const int penalty_form = DSC_CONFIG_GET( "penalty_form", 1 );
-			switch (penalty_form) {
+			switch (context.penalty_form) {
 				case 1:
 				{
 					const double entity_measure = std::pow( charactisticSize( entity, intersection), double(power) );
@@ -281,16 +388,16 @@ namespace Assembler {
 				{
                     const double entity_diameter = std::pow( DSG::geometryDiameter( entity ), double(power) );
                     const double neighbour_diameter = std::pow( DSG::geometryDiameter( neighbour ), double(power) );
-					return std::max(entity_diameter, neighbour_diameter) * ( power > 0 ? stabil_coeff.Factor("C11") : stabil_coeff.Factor("D11") );
+					return std::max(entity_diameter, neighbour_diameter) * ( power > 0 ? context.C11_factor : context.D11_factor );
 				}
 				default:
 				case 4:
 				{
 //					return std::pow( intersection.intersectionGlobal().volume(), double(power) );
 					if (power==-1)
-						return stabil_coeff.Factor("C11") * std::pow( lengthOfIntersection, stabil_coeff.Power("C11") );
+						return context.C11_factor * std::pow( lengthOfIntersection, context.C11_power );
 					else
-						return stabil_coeff.Factor("D11") * std::pow( lengthOfIntersection, stabil_coeff.Power("D11") );
+						return context.D11_factor * std::pow( lengthOfIntersection, context.D11_power );
 				}
 			}
 
@@ -299,10 +406,10 @@ namespace Assembler {
 		template <int power>
 		static double penalty(const typename Traits::EntityType& entity,
 							  const typename Traits::IntersectionIteratorType::Intersection& intersection,
-							  const Dune::StabilizationCoefficients& stabil_coeff,
+							  const AssemblyContext& context,
 							  const double lengthOfIntersection)
 		{
-			return penalty<power>( entity, entity, intersection, stabil_coeff, lengthOfIntersection );
+			return penalty<power>( entity, entity, intersection, context, lengthOfIntersection );
 		}
 
 		struct InfoContainerInteriorFace : public InfoContainerFace {
@@ -321,12 +428,11 @@ namespace Assembler {
 			const double D_11;
 
 			InfoContainerInteriorFace (const CoordinatorType& interface,
-								const typename Traits::EntityType& ent,
+								const AssemblyContext& context,
+								const InfoContainerVolume& element,
 							   const typename Traits::EntityType& nei,
-							   const typename Traits::IntersectionIteratorType::Intersection& inter,
-								const typename Traits::DiscreteModelType& discrete_modelIn,
-								const typename Traits::GridPartType& grid_partIn )
-                :InfoContainerFace( interface, ent, inter, discrete_modelIn, grid_partIn ),
+							   const typename Traits::IntersectionIteratorType::Intersection& inter )
+                :InfoContainerFace( interface, context, element, inter ),
 				  neighbour( nei ),
 				  sigma_basefunction_set_neighbour( interface.sigma_space_.baseFunctionSet( neighbour ) ),
 				  velocity_basefunction_set_neighbour( interface.velocity_space_.baseFunctionSet( neighbour ) ),
@@ -338,14 +444,31 @@ namespace Assembler {
 																  inter,
                                                                   PolOrder<Traits>::value,
 																  Traits::FaceQuadratureType::OUTSIDE ),
-				  C_11( penalty<-1>( ent, nei, inter, InfoContainerFace::stabil_coeff, InfoContainerFace::lengthOfIntersection ) ),
-				  D_11( penalty<1>( ent, nei, inter, InfoContainerFace::stabil_coeff, InfoContainerFace::lengthOfIntersection ) )
+				  C_11( penalty<-1>( element.entity, nei, inter, context, InfoContainerFace::lengthOfIntersection ) ),
+				  D_11( penalty<1>( element.entity, nei, inter, context, InfoContainerFace::lengthOfIntersection ) )
 			{
 				//some integration logic depends on this
 				assert( InfoContainerFace::faceQuadratureElement.nop() == faceQuadratureNeighbour.nop() );
 			}
 		};
 
+		/** \brief the info containers of one assembling thread, rebuilt in place for every element and face
+			apply() keeps one as a local, so every thread running a traversal has its own.
+			A container keeps referring to its last element/face until it is rebuilt, it is only read in between.
+		  **/
+		struct AssemblyWorkspace {
+			enum { VolumeSeen = 1, InteriorFaceSeen = 2, BoundaryFaceSeen = 4 };
+			InPlace< InfoContainerVolume > volume;
+			InPlace< InfoContainerFace > boundary_face;
+			InPlace< InfoContainerInteriorFace > interior_face;
+			//! container kinds built so far, each first one warms up the local matrix stacks and buffers
+			unsigned int seen;
+
+			AssemblyWorkspace()
+				: seen( 0 )
+			{}
+		};
+
 		struct ApplyVolume {
 			template < class IntegratorType >
 			static void apply( IntegratorType& integrator, const InfoContainerVolume& info )
@@ -385,37 +508,73 @@ namespace Assembler {
 			}
 		};
 
+		/** visits all elements and their intersections once, in the grid's leaf iteration order
+			With "ordering_stats" the bandwidth of the element face graph in index set numbering, which is the
+			block structure of the assembled matrices, is logged whenever the grid changed.
+			If the allocation counter is compiled in, the heap allocations after the warm-up (up to the first
+			element, interior face and boundary face each) are reported, they should be zero.
+		  **/
 		void apply ( IntegratorTuple& integrator_tuple ) const
 		{
 			DSC::Profiler::ScopedTiming assembler_time("assembler");
             const auto& gridView = grid_part_.grid().leafView();
+			typedef typename Traits::GridType::LeafGridView
+				GridViewType;
+			const AssemblyContext context( discrete_model_ );
+			AssemblyWorkspace workspace;
+			AllocationCounter::Scope allocations;
+
+			if ( DSC_CONFIG_GET( "ordering_stats", false ) ) {
+				bool built = false;
+				const ElementGraph< GridViewType >& graph = ElementGraph< GridViewType >::cached( gridView, built );
+				if ( built )
+					graph.statistics().print( DSC_LOG_INFO, "element face graph, index set order" );
+			}
+			for ( const auto& entity : DSC::viewRange(gridView)) {
+				const unsigned int seen = workspace.seen;
+				applyElement( integrator_tuple, context, workspace, gridView, entity );
+				if ( workspace.seen != seen )
+					allocations.reset();
+			}
+			if ( AllocationCounter::enabled() )
+				DSC_LOG_INFO << "assembly: " << allocations.allocations()
+							 << " heap allocations after the warm-up" << std::endl;
+		}
 
-            for ( const auto& entity : DSC::viewRange(gridView))
+	private:
+		template < class GridViewType >
+		void applyElement ( IntegratorTuple& integrator_tuple,
+							const AssemblyContext& context,
+							AssemblyWorkspace& workspace,
+							const GridViewType& gridView,
+							const typename Traits::EntityType& entity ) const
+		{
+			const InfoContainerVolume& e_info = workspace.volume.build( *this, context, entity, discrete_model_, grid_part_ );
+			ForEachIntegrator<ApplyVolume,InfoContainerVolume>( integrator_tuple, e_info );
+			workspace.seen |= AssemblyWorkspace::VolumeSeen;
+
+			// walk the intersections
+			const typename Traits::IntersectionIteratorType intItEnd = gridView.iend( entity );
+			for (   typename Traits::IntersectionIteratorType intIt = gridView.ibegin( entity );
+					intIt != intItEnd;
+					++intIt )
 			{
-                const InfoContainerVolume e_info( *this, entity, discrete_model_,grid_part_ );
-                ForEachIntegrator<ApplyVolume,InfoContainerVolume>( integrator_tuple, e_info );
-
-				// walk the intersections
-				const typename Traits::IntersectionIteratorType intItEnd = gridView.iend( entity );
-				for (   typename Traits::IntersectionIteratorType intIt = gridView.ibegin( entity );
-						intIt != intItEnd;
-						++intIt )
+				const typename Traits::IntersectionIteratorType::Intersection& intersection = *intIt;
+
+				// if we are inside the grid
+				if ( intersection.neighbor() && !intersection.boundary() )
+				{
+					//! DO NOT TRY TO DEREF outside() DIRECTLY
+					const typename Traits::IntersectionIteratorType::Intersection::EntityPointer neighbourPtr = intersection.outside();
+					const InfoContainerInteriorFace& i_info = workspace.interior_face.build( *this, context, e_info, *neighbourPtr, intersection );
+					ForEachIntegrator<ApplyInteriorFace,InfoContainerInteriorFace>( integrator_tuple, i_info );
+					workspace.seen |= AssemblyWorkspace::InteriorFaceSeen;
+				}
+				else if ( !intersection.neighbor() && intersection.boundary() )
 				{
-					const typename Traits::IntersectionIteratorType::Intersection& intersection = *intIt;
-
-					// if we are inside the grid
-					if ( intersection.neighbor() && !intersection.boundary() )
-					{
-						//! DO NOT TRY TO DEREF outside() DIRECTLY
-                        const typename Traits::IntersectionIteratorType::Intersection::EntityPointer neighbourPtr = intersection.outside();
-                        const InfoContainerInteriorFace i_info( *this, entity, *neighbourPtr, intersection, discrete_model_,grid_part_ );
-                        ForEachIntegrator<ApplyInteriorFace,InfoContainerInteriorFace>( integrator_tuple, i_info );
-					}
-					else if ( !intersection.neighbor() && intersection.boundary() )
-					{
-                        const InfoContainerFace o_info( *this, entity, intersection, discrete_model_, grid_part_ );
-                        ForEachIntegrator<ApplyBoundaryFace,InfoContainerFace>( integrator_tuple, o_info );
-					}
+					const InfoContainerFace& o_info = workspace.boundary_face.build( *this, context, e_info, intersection );
+					ForEachIntegrator<ApplyBoundaryFace,InfoContainerFace>( integrator_tuple, o_info );
+					workspace.seen |= AssemblyWorkspace::BoundaryFaceSeen;
 				}
 			}
 		}
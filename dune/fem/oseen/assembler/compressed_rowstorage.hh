@@ -0,0 +1,323 @@
+#ifndef DUNE_OSEEN_ASSEMBLER_COMPRESSED_ROWSTORAGE_HH
+#define DUNE_OSEEN_ASSEMBLER_COMPRESSED_ROWSTORAGE_HH
+
+#include <cmake_config.h>
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <cassert>
+
+namespace Dune {
+namespace Oseen {
+
+/** \brief compact (CSR) copy of a fem SparseRowMatrix
+	SparseRowMatrix keeps a fixed number of slots per row, unused slots are marked with a negative column index.
+	This class squeezes those out, so the copy can be traversed row-wise without any branching.
+	assignTransposed() builds the CSR of the transposed matrix, which turns A^T x into a gather-style
+	product that can be split over rows without write conflicts.
+  **/
+class CompressedRowStorage
+{
+	public:
+		CompressedRowStorage()
+			: rows_( 0 ),
+			cols_( 0 )
+		{}
+
+		//! copy the non-default entries of matrix
+		template < class SparseRowMatrixType >
+		void assign( const SparseRowMatrixType& matrix )
+		{
+			rows_ = matrix.rows();
+			cols_ = matrix.cols();
+			const int slots = matrix.numNonZeros();
+			row_start_.assign( rows_ + 1, 0 );
+			for ( int row = 0; row < rows_; ++row ) {
+				for ( int k = 0; k < slots; ++k ) {
+					if ( matrix.realValue( row, k ).second >= 0 )
+						++row_start_[ row + 1 ];
+				}
+			}
+			for ( int row = 0; row < rows_; ++row )
+				row_start_[ row + 1 ] += row_start_[ row ];
+			col_.resize( row_start_[ rows_ ] );
+			values_.resize( row_start_[ rows_ ] );
+			for ( int row = 0; row < rows_; ++row ) {
+				int pos = row_start_[ row ];
+				for ( int k = 0; k < slots; ++k ) {
+					const std::pair< double, int > entry = matrix.realValue( row, k );
+					if ( entry.second < 0 )
+						continue;
+					col_[ pos ] = entry.second;
+					values_[ pos ] = entry.first;
+					++pos;
+				}
+			}
+		}
+
+		//! copy the non-default entries of matrix^T, columns within a row come out in ascending order
+		template < class SparseRowMatrixType >
+		void assignTransposed( const SparseRowMatrixType& matrix )
+		{
+			rows_ = matrix.cols();
+			cols_ = matrix.rows();
+			const int slots = matrix.numNonZeros();
+			row_start_.assign( rows_ + 1, 0 );
+			for ( int row = 0; row < cols_; ++row ) {
+				for ( int k = 0; k < slots; ++k ) {
+					const int col = matrix.realValue( row, k ).second;
+					if ( col >= 0 )
+						++row_start_[ col + 1 ];
+				}
+			}
+			for ( int row = 0; row < rows_; ++row )
+				row_start_[ row + 1 ] += row_start_[ row ];
+			col_.resize( row_start_[ rows_ ] );
+			values_.resize( row_start_[ rows_ ] );
+			std::vector< int > fill( row_start_.begin(), row_start_.end() - 1 );
+			for ( int row = 0; row < cols_; ++row ) {
+				for ( int k = 0; k < slots; ++k ) {
+					const std::pair< double, int > entry = matrix.realValue( row, k );
+					if ( entry.second < 0 )
+						continue;
+					const int pos = fill[ entry.second ]++;
+					col_[ pos ] = row;
+					values_[ pos ] = entry.first;
+				}
+			}
+		}
+
+		//! ret = A * x
+		void mult( const double* x, double* ret ) const
+		{
+#if USE_OMP
+#pragma omp parallel for schedule(static)
+#endif
+			for ( int row = 0; row < rows_; ++row ) {
+				double sum = 0.0;
+				for ( int pos = row_start_[ row ]; pos < row_start_[ row + 1 ]; ++pos )
+					sum += values_[ pos ] * x[ col_[ pos ] ];
+				ret[ row ] = sum;
+			}
+		}
+
+		//! ret += A * x
+		void multAdd( const double* x, double* ret ) const
+		{
+#if USE_OMP
+#pragma omp parallel for schedule(static)
+#endif
+			for ( int row = 0; row < rows_; ++row ) {
+				double sum = 0.0;
+				for ( int pos = row_start_[ row ]; pos < row_start_[ row + 1 ]; ++pos )
+					sum += values_[ pos ] * x[ col_[ pos ] ];
+				ret[ row ] += sum;
+			}
+		}
+
+		/** ret = A * x for count vectors at once
+			x and ret are interleaved, entry i of vector k lives at [i * count + k].
+			Every matrix entry is loaded once for all vectors.
+		  **/
+		void multBlock( const double* x, double* ret, const int count ) const
+		{
+#if USE_OMP
+#pragma omp parallel for schedule(static)
+#endif
+			for ( int row = 0; row < rows_; ++row ) {
+				double* out = ret + row * count;
+				for ( int k = 0; k < count; ++k )
+					out[ k ] = 0.0;
+				for ( int pos = row_start_[ row ]; pos < row_start_[ row + 1 ]; ++pos ) {
+					const double val = values_[ pos ];
+					const double* in = x + col_[ pos ] * count;
+					for ( int k = 0; k < count; ++k )
+						out[ k ] += val * in[ k ];
+				}
+			}
+		}
+
+		//! ret += A * x for count interleaved vectors, see multBlock()
+		void multAddBlock( const double* x, double* ret, const int count ) const
+		{
+#if USE_OMP
+#pragma omp parallel for schedule(static)
+#endif
+			for ( int row = 0; row < rows_; ++row ) {
+				double* out = ret + row * count;
+				for ( int pos = row_start_[ row ]; pos < row_start_[ row + 1 ]; ++pos ) {
+					const double val = values_[ pos ];
+					const double* in = x + col_[ pos ] * count;
+					for ( int k = 0; k < count; ++k )
+						out[ k ] += val * in[ k ];
+				}
+			}
+		}
+
+		//! take over ready made CSR arrays, the argument vectors are left with the old content
+		void swapIn( const int rows, const int cols,
+					 std::vector< int >& row_start, std::vector< int >& col, std::vector< double >& values )
+		{
+			assert( int(row_start.size()) == rows + 1 );
+			assert( col.size() == values.size() );
+			rows_ = rows;
+			cols_ = cols;
+			row_start_.swap( row_start );
+			col_.swap( col );
+			values_.swap( values );
+		}
+
+		void clear()
+		{
+			rows_ = cols_ = 0;
+			std::vector< int >().swap( row_start_ );
+			std::vector< int >().swap( col_ );
+			std::vector< double >().swap( values_ );
+		}
+
+		bool empty() const { return row_start_.empty(); }
+		int rows() const { return rows_; }
+		int cols() const { return cols_; }
+		int nonZeros() const { return row_start_.empty() ? 0 : row_start_[ rows_ ]; }
+
+		//! first entry of row in colIndex()/value()
+		int rowStart( const int row ) const { return row_start_[ row ]; }
+		int rowEnd( const int row ) const { return row_start_[ row + 1 ]; }
+		int colIndex( const int pos ) const { return col_[ pos ]; }
+		double value( const int pos ) const { return values_[ pos ]; }
+		double& value( const int pos ) { return values_[ pos ]; }
+
+		//! bytes held by this copy
+		std::size_t memoryUsage() const
+		{
+			return row_start_.capacity() * sizeof(int)
+					+ col_.capacity() * sizeof(int)
+					+ values_.capacity() * sizeof(double);
+		}
+
+	private:
+		int rows_;
+		int cols_;
+		std::vector< int > row_start_;
+		std::vector< int > col_;
+		std::vector< double > values_;
+};
+
+//! result = a^T
+inline void transpose( const CompressedRowStorage& a, CompressedRowStorage& result )
+{
+	std::vector< int > row_start( a.cols() + 1, 0 );
+	for ( int pos = 0; pos < a.nonZeros(); ++pos )
+		++row_start[ a.colIndex( pos ) + 1 ];
+	for ( int row = 0; row < a.cols(); ++row )
+		row_start[ row + 1 ] += row_start[ row ];
+	std::vector< int > col( a.nonZeros() );
+	std::vector< double > values( a.nonZeros() );
+	std::vector< int > fill( row_start.begin(), row_start.end() - 1 );
+	for ( int row = 0; row < a.rows(); ++row ) {
+		for ( int pos = a.rowStart( row ); pos < a.rowEnd( row ); ++pos ) {
+			const int target = fill[ a.colIndex( pos ) ]++;
+			col[ target ] = row;
+			values[ target ] = a.value( pos );
+		}
+	}
+	result.swapIn( a.cols(), a.rows(), row_start, col, values );
+}
+
+//! result = a * b, columns within a row are in order of first appearance
+inline void multiply( const CompressedRowStorage& a, const CompressedRowStorage& b, CompressedRowStorage& result )
+{
+	assert( a.cols() == b.rows() );
+	std::vector< int > row_start( a.rows() + 1, 0 );
+	std::vector< int > col;
+	std::vector< double > values;
+	std::vector< int > marker( b.cols(), -1 );
+	for ( int row = 0; row < a.rows(); ++row ) {
+		const int row_begin = col.size();
+		for ( int pos = a.rowStart( row ); pos < a.rowEnd( row ); ++pos ) {
+			const int k = a.colIndex( pos );
+			const double a_val = a.value( pos );
+			for ( int b_pos = b.rowStart( k ); b_pos < b.rowEnd( k ); ++b_pos ) {
+				const int j = b.colIndex( b_pos );
+				if ( marker[ j ] < row_begin ) {
+					marker[ j ] = col.size();
+					col.push_back( j );
+					values.push_back( a_val * b.value( b_pos ) );
+				}
+				else
+					values[ marker[ j ] ] += a_val * b.value( b_pos );
+			}
+		}
+		row_start[ row + 1 ] = col.size();
+	}
+	result.swapIn( a.rows(), b.cols(), row_start, col, values );
+}
+
+//! result = alpha * a + beta * b
+inline void add( const double alpha, const CompressedRowStorage& a,
+				 const double beta, const CompressedRowStorage& b,
+				 CompressedRowStorage& result )
+{
+	assert( a.rows() == b.rows() && a.cols() == b.cols() );
+	std::vector< int > row_start( a.rows() + 1, 0 );
+	std::vector< int > col;
+	std::vector< double > values;
+	col.reserve( a.nonZeros() + b.nonZeros() );
+	values.reserve( a.nonZeros() + b.nonZeros() );
+	std::vector< int > marker( a.cols(), -1 );
+	for ( int row = 0; row < a.rows(); ++row ) {
+		const int row_begin = col.size();
+		for ( int pos = a.rowStart( row ); pos < a.rowEnd( row ); ++pos ) {
+			marker[ a.colIndex( pos ) ] = col.size();
+			col.push_back( a.colIndex( pos ) );
+			values.push_back( alpha * a.value( pos ) );
+		}
+		for ( int pos = b.rowStart( row ); pos < b.rowEnd( row ); ++pos ) {
+			const int j = b.colIndex( pos );
+			if ( marker[ j ] < row_begin ) {
+				marker[ j ] = col.size();
+				col.push_back( j );
+				values.push_back( beta * b.value( pos ) );
+			}
+			else
+				values[ marker[ j ] ] += beta * b.value( pos );
+		}
+		row_start[ row + 1 ] = col.size();
+	}
+	result.swapIn( a.rows(), a.cols(), row_start, col, values );
+}
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_ASSEMBLER_COMPRESSED_ROWSTORAGE_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
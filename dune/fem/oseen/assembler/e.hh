@@ -33,7 +33,7 @@ namespace Assembler {
 											EntityGeometryType::coorddimension,
 											EntityGeometryType::mydimension >
 			JacobianInverseTransposedType;
-		typedef DSFe::LocalMatrixProxy<MatrixObjectType>
+		typedef LocalMatrixProxy<MatrixObjectType>
 			LocalMatrixProxyType;
 
 		MatrixObjectType& matrix_object_;
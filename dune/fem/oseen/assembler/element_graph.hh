@@ -0,0 +1,150 @@
+#ifndef DUNE_OSEEN_ASSEMBLER_ELEMENT_GRAPH_HH
+#define DUNE_OSEEN_ASSEMBLER_ELEMENT_GRAPH_HH
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+#include <ostream>
+
+namespace Dune {
+namespace Oseen {
+namespace Assembler {
+
+/** \brief face neighbour graph of the codim 0 entities of a grid view, numbered by the grid's index set
+	The DG dofs of the velocity, pressure and sigma spaces are numbered by the index set, one contiguous
+	block per element, so the bandwidth and profile of this graph are those of the block structure
+	of the assembled matrices. The graph is built once per grid, see cached().
+  **/
+template < class GridViewImp >
+class ElementGraph
+{
+	public:
+		typedef GridViewImp
+			GridViewType;
+		typedef typename GridViewType::Grid
+			GridType;
+		typedef typename GridViewType::template Codim< 0 >::Iterator
+			IteratorType;
+		typedef typename GridViewType::template Codim< 0 >::EntityPointer
+			EntityPointerType;
+		typedef typename GridViewType::IntersectionIterator
+			IntersectionIteratorType;
+
+		//! bandwidth of the element numbering
+		struct Statistics {
+			int max_bandwidth;
+			double avg_bandwidth;
+			long profile;
+
+			Statistics()
+				: max_bandwidth( 0 ), avg_bandwidth( 0.0 ), profile( 0 )
+			{}
+
+			template < class Stream >
+			void print( Stream& stream, const std::string& name ) const
+			{
+				stream << name << ": max bandwidth " << max_bandwidth
+						<< " | avg neighbour distance " << avg_bandwidth
+						<< " | profile " << profile << std::endl;
+			}
+		};
+
+		explicit ElementGraph( const GridViewType& gridView )
+			: grid_( &gridView.grid() )
+		{
+			const auto& indexSet = gridView.indexSet();
+			neighbours_.assign( indexSet.size( 0 ), std::vector< int >() );
+			for ( IteratorType it = gridView.template begin< 0 >(); it != gridView.template end< 0 >(); ++it ) {
+				const int index = indexSet.index( *it );
+				const IntersectionIteratorType endIt = gridView.iend( *it );
+				for ( IntersectionIteratorType intIt = gridView.ibegin( *it ); intIt != endIt; ++intIt ) {
+					if ( intIt->neighbor() ) {
+						const EntityPointerType outside = intIt->outside();
+						neighbours_[ index ].push_back( indexSet.index( *outside ) );
+					}
+				}
+			}
+		}
+
+		/** the graph of gridView's grid, built on the first call and again only when the grid
+			or its number of elements changed since, i.e. after adaption
+			\param built set to whether the graph was (re)built by this call
+		  **/
+		static const ElementGraph& cached( const GridViewType& gridView, bool& built )
+		{
+			static std::unique_ptr< const ElementGraph > graph;
+			built = !graph
+					|| graph->grid_ != &gridView.grid()
+					|| graph->size() != int( gridView.indexSet().size( 0 ) );
+			if ( built )
+				graph.reset( new ElementGraph( gridView ) );
+			return *graph;
+		}
+
+		//! number of elements
+		int size() const { return neighbours_.size(); }
+
+		//! index set indices of the face neighbours of the element with index set index
+		const std::vector< int >& neighbours( const int index ) const { return neighbours_[ index ]; }
+
+		//! bandwidth of the graph in index set numbering
+		Statistics statistics() const
+		{
+			Statistics stats;
+			long edges = 0;
+			double sum = 0.0;
+			for ( int e = 0; e < size(); ++e ) {
+				int row_width = 0;
+				for ( const int n : neighbours_[ e ] ) {
+					stats.max_bandwidth = std::max( stats.max_bandwidth, std::abs( e - n ) );
+					row_width = std::max( row_width, e - n );
+					sum += std::abs( e - n );
+					++edges;
+				}
+				stats.profile += row_width;
+			}
+			stats.avg_bandwidth = edges > 0 ? sum / edges : 0.0;
+			return stats;
+		}
+
+	private:
+		const GridType* grid_;
+		std::vector< std::vector< int > > neighbours_;
+};
+
+} // end namespace Assembler
+} // end namespace Oseen
+} // end namespace Dune
+
+#endif // DUNE_OSEEN_ASSEMBLER_ELEMENT_GRAPH_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
@@ -87,6 +87,7 @@ public:
     TYPEDEF_MATRIX_AND_INTEGRATOR( Z, Velocity, Pressure );
     TYPEDEF_MATRIX_AND_INTEGRATOR( E, Pressure, Velocity );
     TYPEDEF_MATRIX_AND_INTEGRATOR( R, Pressure, Pressure );
+    TYPEDEF_MATRIX_AND_INTEGRATOR( Mp, Pressure, Pressure );
     static const bool verbose_ = true;
 
     typedef Oseen::Assembler::O< YmatrixType, StokesTraitsType, DiscreteVelocityFunctionType >
@@ -127,6 +128,31 @@ public:
                     H2_IntegratorType,
                     H3_IntegratorType >
         StokesIntegratorTuple;
+    //! the split tuples below let OseenLDGMethod::applyMulti assemble the matrices once and the right hand sides per model
+    typedef tuple<	MmatrixIntegratorType,
+                    WmatrixIntegratorType,
+                    XmatrixIntegratorType,
+                    YmatrixIntegratorType,
+                    OmatrixIntegratorType,
+                    ZmatrixIntegratorType,
+                    EmatrixIntegratorType,
+                    RmatrixIntegratorType >
+        OseenMatrixIntegratorTuple;
+    typedef tuple<	MmatrixIntegratorType,
+                    WmatrixIntegratorType,
+                    XmatrixIntegratorType,
+                    YmatrixIntegratorType,
+                    ZmatrixIntegratorType,
+                    EmatrixIntegratorType,
+                    RmatrixIntegratorType >
+        StokesMatrixIntegratorTuple;
+    typedef tuple<	H1_IntegratorType,
+                    H2_IntegratorType,
+                    H3_IntegratorType >
+        RhsIntegratorTuple;
+    //! pressure mass matrix for the Schur complement preconditioner, assembled in its own (volume only) traversal
+    typedef tuple<	MpmatrixIntegratorType >
+        PressureMassIntegratorTuple;
 
     template < class RowSpace, class ColSpace >
     struct magic {
@@ -0,0 +1,140 @@
+#ifndef DUNE_OSEEN_ASSEMBLER_LOCALMATRIX_PROXY_HH
+#define DUNE_OSEEN_ASSEMBLER_LOCALMATRIX_PROXY_HH
+
+#include <cmake_config.h>
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+
+namespace Dune {
+namespace Oseen {
+namespace Assembler {
+
+/** \brief per thread scratch space for LocalMatrixProxy
+	Proxies are scoped locals of the integrators, so their buffers are handed out and given back in stack order.
+	The storage only grows (until the largest set of simultaneously alive local matrices was seen) and is never freed.
+  **/
+class LocalMatrixBuffer
+{
+	public:
+		static LocalMatrixBuffer& local()
+		{
+			static thread_local LocalMatrixBuffer buffer;
+			return buffer;
+		}
+
+		//! zeroed room for size values, returns its offset (pointers would not survive a later growth)
+		std::size_t push( const std::size_t size )
+		{
+			const std::size_t offset = top_;
+			top_ += size;
+			if ( top_ > values_.size() )
+				values_.resize( top_ );
+			std::fill( values_.begin() + offset, values_.begin() + top_, 0.0 );
+			return offset;
+		}
+
+		void pop( const std::size_t offset )
+		{
+			assert( offset <= top_ );
+			top_ = offset;
+		}
+
+		double* at( const std::size_t offset ) { return &values_[0] + offset; }
+
+	private:
+		LocalMatrixBuffer()
+			: top_( 0 )
+		{}
+
+		std::vector< double > values_;
+		std::size_t top_;
+};
+
+/** \brief collects the additions to one local matrix, on destruction the entries above eps are added to it
+	Drop-in for DSFe::LocalMatrixProxy, which allocates a fresh buffer per proxy, this one borrows from LocalMatrixBuffer.
+  **/
+template < class MatrixObjectType >
+class LocalMatrixProxy
+{
+	typedef typename MatrixObjectType::LocalMatrixType
+		LocalMatrixType;
+
+	public:
+		template < class RowEntityType, class ColumnEntityType >
+		LocalMatrixProxy( MatrixObjectType& object, const RowEntityType& row_entity, const ColumnEntityType& column_entity,
+						  const double eps )
+			: local_matrix_( object.localMatrix( row_entity, column_entity ) ),
+			eps_( eps ),
+			rows_( local_matrix_.rows() ),
+			cols_( local_matrix_.columns() ),
+			buffer_( LocalMatrixBuffer::local() ),
+			offset_( buffer_.push( std::size_t( rows_ ) * cols_ ) )
+		{}
+
+		~LocalMatrixProxy()
+		{
+			const double* values = buffer_.at( offset_ );
+			for ( int row = 0; row < rows_; ++row )
+				for ( int col = 0; col < cols_; ++col )
+					if ( std::fabs( values[ row * cols_ + col ] ) > eps_ )
+						local_matrix_.add( row, col, values[ row * cols_ + col ] );
+			buffer_.pop( offset_ );
+		}
+
+		void add( const int row, const int col, const double value )
+		{
+			assert( row < rows_ && col < cols_ );
+			buffer_.at( offset_ )[ row * cols_ + col ] += value;
+		}
+
+		int rows() const { return rows_; }
+		int cols() const { return cols_; }
+
+	private:
+		LocalMatrixProxy( const LocalMatrixProxy& );
+
+		LocalMatrixType local_matrix_;
+		const double eps_;
+		const int rows_;
+		const int cols_;
+		LocalMatrixBuffer& buffer_;
+		const std::size_t offset_;
+};
+
+} // end namespace Assembler
+} // end namespace Oseen
+} // end namespace Dune
+
+#endif // DUNE_OSEEN_ASSEMBLER_LOCALMATRIX_PROXY_HH
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
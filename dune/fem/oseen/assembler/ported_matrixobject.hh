@@ -14,6 +14,10 @@
 #include <dune/fem/operator/common/operator.hh>
 #include <dune/fem/misc/functor.hh>
 
+#include <dune/stuff/common/logging.hh>
+#include <dune/stuff/common/parameter/configcontainer.hh>
+#include <dune/fem/oseen/assembler/compressed_rowstorage.hh>
+
 #ifdef ENABLE_UMFPACK 
 #include <umfpack.h>
 #endif
@@ -79,6 +83,11 @@ namespace Dune
 
     mutable LocalMatrixStackType localMatrixStack_;
 
+    //! opt-in CSR copy of matrix_^T, rebuilt lazily after invalidateTransposed() or any matrix() access
+    bool cache_transposed_;
+    mutable bool transposed_valid_;
+    mutable Oseen::CompressedRowStorage transposed_;
+
   public:
     //! setup matrix handler 
     inline PortedSparseRowMatrixObject( const DomainSpaceType &domainSpace,
@@ -89,7 +98,9 @@ namespace Dune
       sequence_( -1 ),
       matrix_(),
       preconditioning_( false ),
-      localMatrixStack_( *this )
+      localMatrixStack_( *this ),
+      cache_transposed_( DSC_CONFIG_GET( "cache_transposed", false ) ),
+      transposed_valid_( false )
     {
       int precon = 0;
       if( paramfile != "" )
@@ -103,12 +114,54 @@ namespace Dune
       preconditioning_ = (precon > 0) ? true : false;
     }
 
-    //! return reference to stability matrix
+    /** \brief return reference to stability matrix
+        \note the reference allows modification, so the transposed copy is marked outdated on every call;
+               products that only read use matrix_ directly and keep it
+      **/
     inline MatrixType &matrix () const
     {
+      invalidateTransposed();
       return matrix_;
     }
 
+    //! enable/disable the transposed copy used by apply_t for this block only
+    void setCacheTransposed( const bool cache )
+    {
+      cache_transposed_ = cache;
+      if( !cache_transposed_ )
+        transposed_.clear();
+      transposed_valid_ = false;
+    }
+
+    bool cachesTransposed () const
+    {
+      return cache_transposed_;
+    }
+
+    //! mark the transposed copy as outdated, it is rebuilt on the next transposed product
+    void invalidateTransposed () const
+    {
+      transposed_valid_ = false;
+    }
+
+    //! bytes currently held by the transposed copy (0 if not built)
+    std::size_t transposedMemoryUsage () const
+    {
+      return transposed_.memoryUsage();
+    }
+
+    //! (re)build the transposed copy if caching is enabled and it is outdated
+    void buildTransposed () const
+    {
+      if( !cache_transposed_ || transposed_valid_ )
+        return;
+      transposed_.assignTransposed( matrix_ );
+      transposed_valid_ = true;
+      DSC_LOG_DEBUG << "PortedSparseRowMatrixObject: built transposed copy with "
+                    << transposed_.nonZeros() << " entries, "
+                    << transposed_.memoryUsage() / 1024 << " KiB" << std::endl;
+    }
+
     //! interface method from LocalMatrixFactory
     inline ObjectType *newObject () const
     {
@@ -119,6 +172,7 @@ namespace Dune
     inline LocalMatrixType localMatrix( const RowEntityType &rowEntity,
                                         const ColumnEntityType &colEntity ) const
     {
+      invalidateTransposed();
       return LocalMatrixType( localMatrixStack_, rowEntity, colEntity );
     }
 
@@ -126,6 +180,7 @@ namespace Dune
     inline void clear ()
     {
       matrix_.clear();
+      invalidateTransposed();
     }
 
     //! return true if precoditioning matrix is provided 
@@ -156,6 +211,7 @@ namespace Dune
           matrix_.reserve( domainSpace_.size(), rangeSpace_.size(), nonZeros, 0.0 );
         }
         sequence_ = domainSpace_.sequence();
+        invalidateTransposed();
       }
     }
 
@@ -199,8 +255,17 @@ namespace Dune
     template< class DomainFunction, class RangeFunction >
     void apply_t ( const RangeFunction &arg, DomainFunction &dest ) const
     {
-      // do matrix vector multiplication 
-      matrix_.apply_t( arg, dest );
+      // do matrix vector multiplication
+      if( cache_transposed_ )
+      {
+        // generic functions need not store their dofs contiguously, go through plain copies
+        std::vector< double > in( arg.dbegin(), arg.dend() );
+        std::vector< double > out( dest.size() );
+        multOEM_t( &in[0], &out[0] );
+        std::copy( out.begin(), out.end(), dest.dbegin() );
+      }
+      else
+        matrix_.apply_t( arg, dest );
 
       // communicate data 
       dest.communicate();
@@ -211,12 +276,24 @@ namespace Dune
                    AdaptiveDiscreteFunction< DomainSpaceType> &dest ) const
     {
       // do matrix vector multiplication 
-      matrix_.multOEM_t( arg.leakPointer(), dest.leakPointer() );
+      multOEM_t( arg.leakPointer(), dest.leakPointer() );
 
       // communicate data 
       dest.communicate();
     }
 
+    //! transposed mult on raw dof vectors, gathers from the transposed copy if enabled
+    void multOEM_t( const double *arg, double *dest ) const
+    {
+      if( cache_transposed_ )
+      {
+        buildTransposed();
+        transposed_.mult( arg, dest );
+      }
+      else
+        matrix_.multOEM_t( arg, dest );
+    }
+
 
     //! mult method of matrix object used by oem solver
     double ddotOEM( const double *v, const double *w ) const
@@ -242,6 +319,7 @@ namespace Dune
     void resort() 
     {
       matrix_.resort();
+      invalidateTransposed();
     }
 
     void createPreconditionMatrix()
@@ -252,6 +330,7 @@ namespace Dune
     template <class HangingNodesType> 
     void changeHangingNodes(const HangingNodesType& hangingNodes) 
     {
+      invalidateTransposed();
       {
         typedef typename HangingNodesType :: IteratorType IteratorType;
         const IteratorType end = hangingNodes.end();
@@ -380,6 +459,10 @@ protected:
     : BaseType( domainSpace_in, rangeSpace_in),
       matrix_( matrixObject.matrix() )
     {
+      // local matrices are recycled through the object stack, sizing the index
+      // vectors for the largest element once keeps init() free of reallocations
+      row_.reserve( domainSpace_.mapper().maxNumDofs() );
+      col_.reserve( rangeSpace_.mapper().maxNumDofs() );
     }
     
   private: 
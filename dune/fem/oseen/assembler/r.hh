@@ -27,7 +27,7 @@ namespace Assembler {
 			SigmaJacobianRangeType;
 		typedef typename Traits::LocalIntersectionCoordinateType
 			LocalIntersectionCoordinateType;
-		typedef DSFe::LocalMatrixProxy<MatrixObjectType>
+		typedef LocalMatrixProxy<MatrixObjectType>
 			LocalMatrixProxyType;
 
 		MatrixObjectType& matrix_object_;
@@ -0,0 +1,368 @@
+#ifndef DUNE_OSEEN_ASSEMBLER_SYSTEM_CACHE_HH
+#define DUNE_OSEEN_ASSEMBLER_SYSTEM_CACHE_HH
+
+#include <cmake_config.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#include <stdint.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <dune/stuff/common/logging.hh>
+#include <dune/stuff/common/profiler.hh>
+#include <dune/stuff/common/filesystem.hh>
+#include <dune/fem/oseen/assembler/ported_matrixobject.hh>
+#include <dune/fem/oseen/assembler/compressed_rowstorage.hh>
+
+namespace Dune {
+namespace Oseen {
+namespace Assembler {
+
+//! 64bit FNV-1a over everything streamed in, used to key the SystemCache
+class HashBuilder
+{
+	public:
+		HashBuilder()
+			: hash_( 14695981039346656037ULL )
+		{}
+
+		void add( const void* data, const std::size_t bytes )
+		{
+			const unsigned char* ptr = static_cast< const unsigned char* >( data );
+			for ( std::size_t i = 0; i < bytes; ++i ) {
+				hash_ ^= ptr[i];
+				hash_ *= 1099511628211ULL;
+			}
+		}
+
+		HashBuilder& operator<<( const double value ) { add( &value, sizeof(value) ); return *this; }
+		HashBuilder& operator<<( const int value ) { add( &value, sizeof(value) ); return *this; }
+		HashBuilder& operator<<( const bool value ) { return *this << int(value); }
+		HashBuilder& operator<<( const std::string& value ) { add( value.data(), value.size() ); return *this << int(value.size()); }
+
+		uint64_t value() const { return hash_; }
+
+	private:
+		uint64_t hash_;
+};
+
+/** \brief binary on-disk copy of all assembled LDG blocks and right hand sides
+	Layout (native endianness, every section padded to 8 bytes, load() reads it through an mmap):
+	header { char magic[8]; uint32 version; uint32 blocks; uint64 key; }
+	per block { int64 kind; int64 rows; int64 cols; int64 nonzeros; } followed by
+	kind 0 (matrix): int32 row_start[rows+1], int32 col[nonzeros] (each padded to 8 bytes), double value[nonzeros]
+	kind 1 (vector): double value[rows]
+	Files are named after the key, a stale or foreign file is never picked up because the key is also checked
+	against the header. The caller builds the key and has to cover everything the blocks depend on,
+	see OseenLDGMethod::systemCacheKey. Loading still refills the fem matrices entry by entry, whether that beats
+	assembling depends on the problem: compare the system_cache_load and assembler timings in the profiler output.
+  **/
+class SystemCache
+{
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t blocks;
+		uint64_t key;
+	};
+	struct BlockHeader {
+		int64_t kind;
+		int64_t rows;
+		int64_t cols;
+		int64_t nonzeros;
+	};
+	enum { MatrixBlock = 0, VectorBlock = 1 };
+	static const uint32_t version = 1;
+
+	static std::size_t padded( const std::size_t bytes ) { return ( bytes + 7 ) & ~std::size_t( 7 ); }
+
+	public:
+		SystemCache( const std::string& directory, const uint64_t key )
+			: directory_( directory ),
+			key_( key )
+		{}
+
+		std::string filename() const
+		{
+			std::stringstream name;
+			name << directory_ << "/system_" << std::hex << std::setw(16) << std::setfill('0') << key_ << ".bin";
+			return name.str();
+		}
+
+		bool exists() const
+		{
+			struct stat buf;
+			return stat( filename().c_str(), &buf ) == 0;
+		}
+
+		/** fills the matrix objects and discrete functions (in the order they were saved) from the cache file
+			\return false if there is no usable file, the blocks are left untouched in that case
+		  **/
+		template < class... Blocks >
+		bool load( Blocks&... blocks ) const
+		{
+			DSC::Profiler::ScopedTiming load_time("system_cache_load");
+			const int fd = open( filename().c_str(), O_RDONLY );
+			if ( fd < 0 )
+				return false;
+			struct stat buf;
+			if ( fstat( fd, &buf ) != 0 || std::size_t(buf.st_size) < sizeof(Header) ) {
+				close( fd );
+				return false;
+			}
+			const std::size_t length = buf.st_size;
+			void* mapped = mmap( 0, length, PROT_READ, MAP_PRIVATE, fd, 0 );
+			close( fd );
+			if ( mapped == MAP_FAILED )
+				return false;
+
+			const char* cursor = static_cast< const char* >( mapped );
+			const char* end = cursor + length;
+			const Header* header = reinterpret_cast< const Header* >( cursor );
+			bool ok = std::memcmp( header->magic, "OSEENSYS", 8 ) == 0
+					&& header->version == version
+					&& header->key == key_
+					&& header->blocks == sizeof...(Blocks);
+			cursor += sizeof(Header);
+			if ( ok )
+				ok = checkBlocks( cursor, end, blocks... );
+			if ( ok )
+				readBlocks( cursor, blocks... );
+			else
+				DSC_LOG_ERROR << "system cache: ignoring incompatible file " << filename() << std::endl;
+			munmap( mapped, length );
+			return ok;
+		}
+
+		//! writes all blocks, via a temporary file so concurrent runs never see half written caches
+		template < class... Blocks >
+		void save( const Blocks&... blocks ) const
+		{
+			DSC::Profiler::ScopedTiming save_time("system_cache_save");
+			DSC::testCreateDirectory( filename() );
+			const std::string tmp_name = filename() + ".tmp";
+			{
+				std::ofstream out( tmp_name.c_str(), std::ios::binary | std::ios::trunc );
+				if ( !out ) {
+					DSC_LOG_ERROR << "system cache: cannot write " << tmp_name << std::endl;
+					return;
+				}
+				Header header;
+				std::memcpy( header.magic, "OSEENSYS", 8 );
+				header.version = version;
+				header.blocks = sizeof...(Blocks);
+				header.key = key_;
+				out.write( reinterpret_cast< const char* >( &header ), sizeof(header) );
+				writeBlocks( out, blocks... );
+				if ( !out ) {
+					DSC_LOG_ERROR << "system cache: writing " << tmp_name << " failed" << std::endl;
+					std::remove( tmp_name.c_str() );
+					return;
+				}
+			}
+			std::rename( tmp_name.c_str(), filename().c_str() );
+		}
+
+	private:
+		// -- writing
+		static void writeBlocks( std::ofstream& ) {}
+
+		template < class Block, class... Rest >
+		static void writeBlocks( std::ofstream& out, const Block& block, const Rest&... rest )
+		{
+			writeBlock( out, block );
+			writeBlocks( out, rest... );
+		}
+
+		static void writePadding( std::ofstream& out, const std::size_t bytes )
+		{
+			static const char zeros[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+			out.write( zeros, padded( bytes ) - bytes );
+		}
+
+		template < class DomainFunction, class RangeFunction, class TraitsImp >
+		static void writeBlock( std::ofstream& out, const PortedSparseRowMatrixObject< DomainFunction, RangeFunction, TraitsImp >& object )
+		{
+			CompressedRowStorage csr;
+			csr.assign( object.matrix() );
+			BlockHeader block = { MatrixBlock, csr.rows(), csr.cols(), csr.nonZeros() };
+			out.write( reinterpret_cast< const char* >( &block ), sizeof(block) );
+			std::vector< int32_t > row_start( csr.rows() + 1 );
+			for ( int row = 0; row <= csr.rows(); ++row )
+				row_start[row] = row < csr.rows() ? csr.rowStart( row ) : csr.nonZeros();
+			// columns ascending within each row, so loading appends to the row instead of inserting
+			std::vector< int32_t > col( csr.nonZeros() );
+			std::vector< double > values( csr.nonZeros() );
+			std::vector< std::pair< int32_t, double > > entries;
+			for ( int row = 0; row < csr.rows(); ++row ) {
+				entries.clear();
+				for ( int pos = row_start[row]; pos < row_start[row + 1]; ++pos )
+					entries.push_back( std::make_pair( int32_t( csr.colIndex( pos ) ), csr.value( pos ) ) );
+				std::sort( entries.begin(), entries.end() );
+				for ( std::size_t k = 0; k < entries.size(); ++k ) {
+					col[ row_start[row] + k ] = entries[k].first;
+					values[ row_start[row] + k ] = entries[k].second;
+				}
+			}
+			writeArray( out, row_start );
+			writeArray( out, col );
+			writeArray( out, values );
+		}
+
+		template < class DiscreteFunctionType >
+		static void writeBlock( std::ofstream& out, const DiscreteFunctionType& function )
+		{
+			BlockHeader block = { VectorBlock, function.size(), 1, 0 };
+			out.write( reinterpret_cast< const char* >( &block ), sizeof(block) );
+			const std::size_t bytes = function.size() * sizeof(double);
+			out.write( reinterpret_cast< const char* >( function.leakPointer() ), bytes );
+			writePadding( out, bytes );
+		}
+
+		template < class T >
+		static void writeArray( std::ofstream& out, const std::vector< T >& array )
+		{
+			const std::size_t bytes = array.size() * sizeof(T);
+			if ( bytes )
+				out.write( reinterpret_cast< const char* >( &array[0] ), bytes );
+			writePadding( out, bytes );
+		}
+
+		// -- reading, first pass only validates sizes so nothing gets touched on a mismatch
+		static bool checkBlocks( const char*, const char* ) { return true; }
+
+		template < class Block, class... Rest >
+		static bool checkBlocks( const char*& cursor, const char* end, const Block& block, const Rest&... rest )
+		{
+			const char* start = cursor;
+			if ( !checkBlock( cursor, end, block ) )
+				return false;
+			const bool ok = checkBlocks( cursor, end, rest... );
+			cursor = start;
+			return ok;
+		}
+
+		static std::size_t matrixBytes( const BlockHeader& block )
+		{
+			return padded( ( block.rows + 1 ) * sizeof(int32_t) )
+					+ padded( block.nonzeros * sizeof(int32_t) )
+					+ block.nonzeros * sizeof(double);
+		}
+
+		template < class DomainFunction, class RangeFunction, class TraitsImp >
+		static bool checkBlock( const char*& cursor, const char* end,
+								const PortedSparseRowMatrixObject< DomainFunction, RangeFunction, TraitsImp >& object )
+		{
+			if ( end - cursor < std::ptrdiff_t(sizeof(BlockHeader)) )
+				return false;
+			const BlockHeader* block = reinterpret_cast< const BlockHeader* >( cursor );
+			if ( block->kind != MatrixBlock || block->rows != object.matrix().rows() || block->cols != object.matrix().cols() )
+				return false;
+			cursor += sizeof(BlockHeader) + matrixBytes( *block );
+			return cursor <= end;
+		}
+
+		template < class DiscreteFunctionType >
+		static bool checkBlock( const char*& cursor, const char* end, const DiscreteFunctionType& function )
+		{
+			if ( end - cursor < std::ptrdiff_t(sizeof(BlockHeader)) )
+				return false;
+			const BlockHeader* block = reinterpret_cast< const BlockHeader* >( cursor );
+			if ( block->kind != VectorBlock || block->rows != function.size() )
+				return false;
+			cursor += sizeof(BlockHeader) + padded( block->rows * sizeof(double) );
+			return cursor <= end;
+		}
+
+		static void readBlocks( const char* ) {}
+
+		template < class Block, class... Rest >
+		static void readBlocks( const char*& cursor, Block& block, Rest&... rest )
+		{
+			readBlock( cursor, block );
+			readBlocks( cursor, rest... );
+		}
+
+		template < class DomainFunction, class RangeFunction, class TraitsImp >
+		static void readBlock( const char*& cursor, PortedSparseRowMatrixObject< DomainFunction, RangeFunction, TraitsImp >& object )
+		{
+			const BlockHeader* block = reinterpret_cast< const BlockHeader* >( cursor );
+			cursor += sizeof(BlockHeader);
+			const int32_t* row_start = reinterpret_cast< const int32_t* >( cursor );
+			cursor += padded( ( block->rows + 1 ) * sizeof(int32_t) );
+			const int32_t* col = reinterpret_cast< const int32_t* >( cursor );
+			cursor += padded( block->nonzeros * sizeof(int32_t) );
+			const double* values = reinterpret_cast< const double* >( cursor );
+			cursor += block->nonzeros * sizeof(double);
+
+			// SparseRowMatrix only takes single entries, so the slots per row are cut to the longest stored row
+			// and every row is copied in one ascending pass, which keeps each insert within the row's filled part
+			int longest = 0;
+			for ( int row = 0; row < block->rows; ++row )
+				longest = std::max( longest, row_start[row + 1] - row_start[row] );
+			auto& matrix = object.matrix();
+			matrix.reserve( block->rows, block->cols, std::max( longest, 1 ), 0.0 );
+			for ( int row = 0; row < block->rows; ++row )
+				for ( int pos = row_start[row]; pos < row_start[row + 1]; ++pos )
+					matrix.set( row, col[pos], values[pos] );
+			object.invalidateTransposed();
+		}
+
+		template < class DiscreteFunctionType >
+		static void readBlock( const char*& cursor, DiscreteFunctionType& function )
+		{
+			const BlockHeader* block = reinterpret_cast< const BlockHeader* >( cursor );
+			cursor += sizeof(BlockHeader);
+			std::memcpy( function.leakPointer(), cursor, block->rows * sizeof(double) );
+			cursor += padded( block->rows * sizeof(double) );
+		}
+
+		const std::string directory_;
+		const uint64_t key_;
+};
+
+} // end namespace Assembler
+} // end namespace Oseen
+} // end namespace Dune
+
+#endif // DUNE_OSEEN_ASSEMBLER_SYSTEM_CACHE_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
@@ -26,7 +26,7 @@ namespace Assembler {
 			SigmaJacobianRangeType;
 		typedef typename Traits::LocalIntersectionCoordinateType
 			LocalIntersectionCoordinateType;
-		typedef DSFe::LocalMatrixProxy<MatrixObjectType>
+		typedef LocalMatrixProxy<MatrixObjectType>
 			LocalMatrixProxyType;
 
         MatrixObjectType& matrix_object_;
@@ -14,8 +14,10 @@
 #include <dune/fem/oseen/defaulttraits.hh>
 #include <dune/fem/oseen/datacontainer.hh>
 #include <dune/fem/oseen/solver/solvercaller.hh>
+#include <dune/fem/oseen/solver/multi_rhs.hh>
 #include <dune/fem/oseen/assembler/all.hh>
 #include <dune/fem/oseen/assembler/factory.hh>
+#include <dune/fem/oseen/assembler/system_cache.hh>
 #include <dune/fem/oseen/runinfo.hh>
 
 #include <dune/stuff/fem/customprojection.hh>
@@ -29,6 +31,10 @@
 #include <dune/stuff/grid/entity.hh>
 #include <dune/stuff/common/profiler.hh>
 
+#include <boost/preprocessor/stringize.hpp>
+
+#include <memory>
+
 namespace Dune {
 
 /**
@@ -122,41 +128,151 @@ class OseenLDGMethod
             auto h3_integrator = typename Factory::H3_IntegratorType(*H3rhs);
             DSC_PROFILER.stopTiming("Pass_init");
 
-#ifndef STOKES_CONV_ONLY
-            if ( do_oseen_discretization_ )
+            // the key walks the whole grid, so it is only built if the cache is used
+            std::unique_ptr< const Oseen::Assembler::SystemCache > system_cache;
+            if ( DSC_CONFIG_GET( "system_cache", false ) )
+                system_cache.reset( new Oseen::Assembler::SystemCache( DSC_CONFIG_GET( "system_cache_dir", std::string("system_cache") ),
+                                                                       systemCacheKey() ) );
+            if ( system_cache && system_cache->load( *MInversMatrix, *Wmatrix, *Xmatrix, *Ymatrix, *Omatrix,
+                                                     *Zmatrix, *Ematrix, *Rmatrix, *H1rhs, *H2rhs, *H3rhs ) )
             {
-                Oseen::Assembler::Coordinator< Traits, typename Factory::OseenIntegratorTuple >
+                DSC_LOG_INFO << "loaded assembled system from " << system_cache->filename() << std::endl;
+            }
+            else {
+#ifndef STOKES_CONV_ONLY
+                if ( do_oseen_discretization_ )
+                {
+                    Oseen::Assembler::Coordinator< Traits, typename Factory::OseenIntegratorTuple >
+                            coordinator ( discreteModel_, gridPart_, velocitySpace_, pressureSpace_, sigmaSpace_  );
+
+                    auto tuple = std::make_tuple(	m_integrator, w_integrator, x_integrator, y_integrator,
+                                            o_integrator, z_integrator, e_integrator, r_integrator,
+                                            h1_integrator, h2_integrator,h2_o_integrator, h3_integrator );
+                    coordinator.apply( tuple );
+                }
+                else
+                {
+                    Oseen::Assembler::Coordinator< Traits, typename Factory::StokesIntegratorTuple >
+                            coordinator ( discreteModel_, gridPart_, velocitySpace_, pressureSpace_, sigmaSpace_  );
+
+                    typename Factory::StokesIntegratorTuple tuple(	m_integrator, w_integrator, x_integrator, y_integrator,
+                                            z_integrator, e_integrator, r_integrator,
+                                            h1_integrator, h2_integrator,h3_integrator );
+                    coordinator.apply( tuple );
+                }
+#else
+                Oseen::Assembler::Coordinator< Traits, typename Factory::ConvIntegratorTuple >
                         coordinator ( discreteModel_, gridPart_, velocitySpace_, pressureSpace_, sigmaSpace_  );
 
-                auto tuple = std::make_tuple(	m_integrator, w_integrator, x_integrator, y_integrator,
-                                        o_integrator, z_integrator, e_integrator, r_integrator,
-                                        h1_integrator, h2_integrator,h2_o_integrator, h3_integrator );
+                typename Factory::ConvIntegratorTuple tuple(	o_integrator, h2_integrator, h2_o_integrator );
                 coordinator.apply( tuple );
+#endif
+                if ( system_cache )
+                    system_cache->save( *MInversMatrix, *Wmatrix, *Xmatrix, *Ymatrix, *Omatrix,
+                                       *Zmatrix, *Ematrix, *Rmatrix, *H1rhs, *H2rhs, *H3rhs );
             }
-            else
-            {
-                Oseen::Assembler::Coordinator< Traits, typename Factory::StokesIntegratorTuple >
+            // the Uzawa CG preconditions its outer iteration with M_p / mu, only Stokes is covered by that equivalence,
+            // the augmented Lagrangian solver needs M_p for Oseen too
+            const bool uzawa_mass = !do_oseen_discretization_ && DSC_CONFIG_GET( "outerPrecond_mass", false );
+            const bool al_mass = DSC_CONFIG_GET( "saddlepoint_solver", std::string( "" ) ) == "al"
+                    || ( do_oseen_discretization_ && DSC_CONFIG_GET( "autotune", false ) );
+            typename Factory::MpmatrixInternalType Mpmatrix;
+            if ( uzawa_mass || al_mass ) {
+                Mpmatrix = Factory::matrix( pressureSpace_, pressureSpace_ );
+                auto mp_integrator = typename Factory::MpmatrixIntegratorType(*Mpmatrix);
+                Oseen::Assembler::Coordinator< Traits, typename Factory::PressureMassIntegratorTuple >
                         coordinator ( discreteModel_, gridPart_, velocitySpace_, pressureSpace_, sigmaSpace_  );
-
-                typename Factory::StokesIntegratorTuple tuple(	m_integrator, w_integrator, x_integrator, y_integrator,
-                                        z_integrator, e_integrator, r_integrator,
-                                        h1_integrator, h2_integrator,h3_integrator );
+                typename Factory::PressureMassIntegratorTuple tuple( mp_integrator );
                 coordinator.apply( tuple );
+                Mpmatrix->matrix().scale( 1.0 / discreteModel_.viscosity() );
             }
-#else
-            Oseen::Assembler::Coordinator< Traits, typename Factory::ConvIntegratorTuple >
-                    coordinator ( discreteModel_, gridPart_, velocitySpace_, pressureSpace_, sigmaSpace_  );
-
-            typename Factory::ConvIntegratorTuple tuple(	o_integrator, h2_integrator, h2_o_integrator );
-            coordinator.apply( tuple );
-#endif
             // do the actual lgs solving
             DSC_LOG_INFO << "Solving system with " << dest.discreteVelocity().size() << " + " << dest.discretePressure().size() << " unknowns" << std::endl;
             info_ = Oseen::SolverCallerProxy< ThisType >::call( do_oseen_discretization_, rhs_datacontainer, dest,
                                             arg, *Xmatrix, *MInversMatrix, *Ymatrix, *Omatrix, *Ematrix,
-                                            *Rmatrix, *Zmatrix, *Wmatrix, *H1rhs, *H2rhs, *H3rhs, beta_ );
+                                            *Rmatrix, *Zmatrix, *Wmatrix, *H1rhs, *H2rhs, *H3rhs, beta_, Mpmatrix.get(),
+                                            discreteModel_.viscosity() );
         } // end of apply
 
+        /** \brief solve the same system for several right hand sides
+            The matrices are assembled once with the model passed to the constructor, the right hand sides H1, H2, H3
+            once per entry of rhs_models, so those may only differ in their data functions (force, boundary data).
+            All systems are then solved together by Oseen::MultiRhsSaddlepointInverseOperator.
+            dests[i] receives the solution for rhs_models[i]. There is no rhs datacontainer / reconstruction support.
+            The block solvers reduce locally only, so this is serial only.
+         **/
+        void applyMulti( const std::vector< DiscreteModelType >& rhs_models, std::vector< RangeType* >& dests )
+        {
+            assert( rhs_models.size() == dests.size() );
+            if ( velocitySpace_.grid().comm().size() > 1 )
+                DUNE_THROW( InvalidStateException, "applyMulti is serial only" );
+            DSC_PROFILER.startTiming("Pass_init");
+            typedef Oseen::Assembler::Factory< Traits >
+                Factory;
+            auto MInversMatrix = Factory::matrix( sigmaSpace_, sigmaSpace_ );
+            auto Wmatrix = Factory::matrix( sigmaSpace_, velocitySpace_ );
+            auto Xmatrix = Factory::matrix( velocitySpace_, sigmaSpace_ );
+            auto Ymatrix = Factory::matrix( velocitySpace_, velocitySpace_ );
+            auto Omatrix = Factory::matrix( velocitySpace_, velocitySpace_ );
+            auto Zmatrix = Factory::matrix( velocitySpace_, pressureSpace_ );
+            auto Ematrix = Factory::matrix( pressureSpace_, velocitySpace_ );
+            auto Rmatrix = Factory::matrix( pressureSpace_, pressureSpace_ );
+            auto m_integrator = typename Factory::MmatrixIntegratorType(*MInversMatrix);
+            auto w_integrator = typename Factory::WmatrixIntegratorType(*Wmatrix);
+            auto x_integrator = typename Factory::XmatrixIntegratorType(*Xmatrix);
+            auto y_integrator = typename Factory::YmatrixIntegratorType(*Ymatrix);
+            auto o_integrator = typename Factory::OmatrixIntegratorType(*Omatrix, beta_);
+            auto z_integrator = typename Factory::ZmatrixIntegratorType(*Zmatrix);
+            auto e_integrator = typename Factory::EmatrixIntegratorType(*Ematrix);
+            auto r_integrator = typename Factory::RmatrixIntegratorType(*Rmatrix);
+            DSC_PROFILER.stopTiming("Pass_init");
+
+            if ( do_oseen_discretization_ )
+            {
+                Oseen::Assembler::Coordinator< Traits, typename Factory::OseenMatrixIntegratorTuple >
+                        coordinator ( discreteModel_, gridPart_, velocitySpace_, pressureSpace_, sigmaSpace_  );
+                typename Factory::OseenMatrixIntegratorTuple tuple(	m_integrator, w_integrator, x_integrator, y_integrator,
+                                        o_integrator, z_integrator, e_integrator, r_integrator );
+                coordinator.apply( tuple );
+            }
+            else
+            {
+                Oseen::Assembler::Coordinator< Traits, typename Factory::StokesMatrixIntegratorTuple >
+                        coordinator ( discreteModel_, gridPart_, velocitySpace_, pressureSpace_, sigmaSpace_  );
+                typename Factory::StokesMatrixIntegratorTuple tuple(	m_integrator, w_integrator, x_integrator, y_integrator,
+                                        z_integrator, e_integrator, r_integrator );
+                coordinator.apply( tuple );
+            }
+
+            std::vector< decltype( Factory::rhs( "H1", sigmaSpace_ ) ) > H1rhs;
+            std::vector< decltype( Factory::rhs( "H2", velocitySpace_ ) ) > H2rhs;
+            std::vector< decltype( Factory::rhs( "H3", pressureSpace_ ) ) > H3rhs;
+            std::vector< const typename Traits::DiscreteSigmaFunctionType* > H1ptr;
+            std::vector< const typename Traits::DiscreteVelocityFunctionType* > H2ptr;
+            std::vector< const typename Traits::DiscretePressureFunctionType* > H3ptr;
+            for ( std::size_t i = 0; i < rhs_models.size(); ++i ) {
+                H1rhs.push_back( Factory::rhs( "H1", sigmaSpace_ ) );
+                H2rhs.push_back( Factory::rhs( "H2", velocitySpace_ ) );
+                H3rhs.push_back( Factory::rhs( "H3", pressureSpace_ ) );
+                Oseen::Assembler::Coordinator< Traits, typename Factory::RhsIntegratorTuple >
+                        coordinator ( rhs_models[i], gridPart_, velocitySpace_, pressureSpace_, sigmaSpace_  );
+                typename Factory::RhsIntegratorTuple tuple( typename Factory::H1_IntegratorType(*H1rhs.back()),
+                                                            typename Factory::H2_IntegratorType(*H2rhs.back()),
+                                                            typename Factory::H3_IntegratorType(*H3rhs.back()) );
+                coordinator.apply( tuple );
+                H1ptr.push_back( H1rhs.back().get() );
+                H2ptr.push_back( H2rhs.back().get() );
+                H3ptr.push_back( H3rhs.back().get() );
+            }
+
+            DSC_LOG_INFO << "Solving system with " << velocitySpace_.size() << " + " << pressureSpace_.size()
+                         << " unknowns for " << dests.size() << " right hand sides" << std::endl;
+            const Oseen::MultiRhsSaddlepointInverseOperator< ThisType >
+                    solver( do_oseen_discretization_, *Xmatrix, *MInversMatrix, *Ymatrix, *Omatrix,
+                            *Ematrix, *Rmatrix, *Zmatrix, *Wmatrix );
+            info_ = solver.solve( dests, H1ptr, H2ptr, H3ptr );
+        } // end of applyMulti
+
 		void getRuninfo( DSC::RunInfo& info )
         {
 			info.iterations_inner_avg = int( info_.iterations_inner_avg );
@@ -164,9 +280,64 @@ class OseenLDGMethod
             info.iterations_inner_max = info_.iterations_inner_max;
             info.iterations_outer_total = info_.iterations_outer_total;
             info.max_inner_accuracy = info_.max_inner_accuracy;
+            info.outer_eigenvalue_min = info_.outer_eigenvalue_min;
+            info.outer_eigenvalue_max = info_.outer_eigenvalue_max;
+            info.inner_eigenvalue_min = info_.inner_eigenvalue_min;
+            info.inner_eigenvalue_max = info_.inner_eigenvalue_max;
         }
 
     private:
+        /** identifies the assembled system for Oseen::Assembler::SystemCache
+            Covers the grid geometry, polynomial orders, problem, model coefficients, stabilisation,
+            the assembly related config keys and beta. The data functions are hashed by their values at the element
+            centers (force) and boundary face centers (dirichlet data), so
+            \attention runs whose data only differ away from those points, or depend on anything else not listed here,
+                       get the same key and load each other's system; set a distinct "system_cache_tag" for them.
+         **/
+        uint64_t systemCacheKey() const
+        {
+            Oseen::Assembler::HashBuilder hash;
+            hash << std::string( BOOST_PP_STRINGIZE( PROBLEM_NAMESPACE ) )
+                 << int( Traits::GridType::dimension )
+                 << int( Traits::sigmaSpaceOrder ) << int( Traits::velocitySpaceOrder ) << int( Traits::pressureSpaceOrder )
+                 << do_oseen_discretization_
+                 << discreteModel_.viscosity() << discreteModel_.alpha()
+                 << discreteModel_.convection_scaling() << discreteModel_.pressure_gradient_scaling()
+                 << DSC_CONFIG_GET( "eps", 1.0e-14 ) << DSC_CONFIG_GET( "penalty_form", 1 )
+                 << DSC_CONFIG_GET( "system_cache_tag", std::string() );
+            const StabilizationCoefficients& stabil_coeff = discreteModel_.getStabilizationCoefficients();
+            const char* coefficients[] = { "C11", "C12", "D11", "D12" };
+            for ( int i = 0; i < 4; ++i )
+                hash << stabil_coeff.Factor( coefficients[i] ) << int( stabil_coeff.Power( coefficients[i] ) );
+            const auto& gridView = gridPart_.grid().leafView();
+            typename Traits::VelocityRangeType value( 0.0 );
+            for ( const auto& entity : DSC::viewRange( gridView ) ) {
+                const auto& geometry = entity.geometry();
+                for ( int corner = 0; corner < geometry.corners(); ++corner ) {
+                    const auto coordinate = geometry.corner( corner );
+                    for ( int d = 0; d < int( coordinate.size() ); ++d )
+                        hash << double( coordinate[d] );
+                }
+#if MODEL_PROVIDES_LOCALFUNCTION
+                discreteModel_.forceF().localFunction( entity ).evaluate( geometry.local( geometry.center() ), value );
+#else
+                discreteModel_.force( 0.0, geometry.center(), value );
+#endif
+                hash.add( &value[0], value.size() * sizeof(double) );
+                const typename Traits::IntersectionIteratorType intItEnd = gridView.iend( entity );
+                for ( typename Traits::IntersectionIteratorType intIt = gridView.ibegin( entity ); intIt != intItEnd; ++intIt ) {
+                    const typename Traits::IntersectionIteratorType::Intersection& intersection = *intIt;
+                    if ( intersection.neighbor() || !intersection.boundary() )
+                        continue;
+                    discreteModel_.dirichletData( intersection, 0.0, intersection.geometry().center(), value );
+                    hash.add( &value[0], value.size() * sizeof(double) );
+                }
+            }
+            hash << int( beta_.size() );
+            hash.add( beta_.leakPointer(), beta_.size() * sizeof(double) );
+            return hash.value();
+        }
+
         DiscreteModelType discreteModel_;
 		const typename Traits::GridPartType& gridPart_;
         const typename Traits::DiscreteOseenFunctionSpaceWrapperType& spaceWrapper_;
@@ -14,6 +14,10 @@
 //  Willy D"orfler:
 //     Orthogonale Fehlermethoden
 //
+//  With a LanczosEstimate the step lengths t and direction updates gam are
+//  recorded, which gives extreme eigenvalue estimates of the operator for
+//  free (see Dune::Oseen::LanczosEstimate).
+//
 //                                                 ----------------------------
 //                                                 Christian Badura, Mai 1998
 //
@@ -40,8 +44,9 @@ std::pair < int , double >
 cghs_algo2( const CommunicatorType & comm,
       unsigned int N, const MATRIX &A, const PC_MATRIX& C,
       const double *b, double *x, double eps,
-      bool detailed )
+      bool detailed, Dune::Oseen::LanczosEstimate* spectrum = 0 )
 {
+  if ( spectrum ) spectrum->clear();
   if ( N==0 )
   {
     std::cerr << "WARNING: N = 0 in cghs, file: " << __FILE__ << " line:" << __LINE__ << "\n";
@@ -108,6 +113,7 @@ cghs_algo2( const CommunicatorType & comm,
 
     daxpy(N,-t,p,1,g,1);
     gam=(t*t*rho-tau)/tau;
+    if ( spectrum ) spectrum->add(t,gam);
     dscal(N,gam,r,1);
     daxpy(N,1.,g,1,r,1);
     
@@ -143,9 +149,10 @@ inline
 std::pair < int , double >
 cghs( const CommunicatorType & comm,
       unsigned int N, const MATRIX &A, const PC_MATRIX &C,
-      const double *b, double *x, double eps, bool detailed )
+      const double *b, double *x, double eps, bool detailed,
+      Dune::Oseen::LanczosEstimate* spectrum = 0 )
 {
-  return cghs_algo2<true> (comm,N,A,C,b,x,eps,detailed );
+  return cghs_algo2<true> (comm,N,A,C,b,x,eps,detailed,spectrum );
 }
 
 // cghs without preconditioning
@@ -154,9 +161,10 @@ inline
 std::pair < int , double >
 cghs( const CommunicatorType & comm,
       unsigned int N, const MATRIX &A,
-      const double *b, double *x, double eps, bool detailed )
+      const double *b, double *x, double eps, bool detailed,
+      Dune::Oseen::LanczosEstimate* spectrum = 0 )
 {
-  return cghs_algo2<false> (comm,N,A,A,b,x,eps,detailed );
+  return cghs_algo2<false> (comm,N,A,A,b,x,eps,detailed,spectrum );
 }
 
 #endif // DUNE_STOKES_CGHS_BLAS_H
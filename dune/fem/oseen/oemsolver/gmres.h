@@ -11,217 +11,278 @@
 //                                                 ----------------------------
 //                                                 Christian Badura, Mai 1998
 //
+//  Parallel version: the Arnoldi basis is orthogonalised with classical
+//  Gram-Schmidt applied twice (CGS2, see Giraud, Langou, Rozloznik,
+//  Computers & Mathematics with Applications 50, 1069-1075 (2005)), which is
+//  as stable as modified Gram-Schmidt but needs two global reductions per
+//  iteration instead of j+2. The norm of the new basis vector travels in the
+//  second reduction and is corrected by Pythagoras.
+//  Preconditioning is always from the right, so the minimised residual is
+//  the one of the original system. With flexible the preconditioned vectors
+//  are kept (FGMRES, Saad, SIAM J Sci Comput 14, 461-469 (1993)), which
+//  allows the preconditioner to change between iterations, e.g. inexact
+//  inner solves.
+//  All scratch memory lives in a GMRESWorkspace owned by the caller, so
+//  several solvers can run at the same time.
+//
 // ============================================================================
 
 #include <utility>
+#include <vector>
+#include <cmath>
+#include <iostream>
+#include <cassert>
 #include "cblas.h"
-#include "tmpmem.hh"
-
-static OEMTmpMem gmresMem;
-
 
-template<bool usePC ,
-         class CommunicatorType, 
-         class Matrix , 
-         class PC_Matrix >
-inline
-std::pair<int,double> 
-gmres_algo2 (const CommunicatorType & comm,
-       int m, int n, const Matrix &A, const PC_Matrix & C, 
-       const double *b , double *x, double eps,
-       bool detailed ) 
+//! scratch memory of gmres_algo2, grows to the largest problem seen and is kept between calls
+struct GMRESWorkspace
 {
-  if ( n<=0 )
+  std::vector< double > V;  // Arnoldi basis, n x (m+1), column major
+  std::vector< double > Z;  // preconditioned basis for flexible, n x m
+  std::vector< double > H;  // Hessenberg matrix, (m+1) x m, column major, rotated to triangular
+  std::vector< double > g;  // rotated right hand side of the least squares problem
+  std::vector< double > c;
+  std::vector< double > s;
+  std::vector< double > r;
+  std::vector< double > tmp;
+  std::vector< double > red; // reduction buffer
+
+  void resize( const int n, const int m, const bool flexible )
   {
-    std::cerr << "WARNING: n = " << n << " in gmres_pc, file: " << __FILE__ << " line:" << __LINE__ << "\n";
-    return std::pair<int,double> (-1,0.0);
+    grow( V, std::size_t(n) * (m+1) );
+    if ( flexible )
+      grow( Z, std::size_t(n) * m );
+    grow( H, std::size_t(m+1) * m );
+    grow( g, m+1 );
+    grow( c, m );
+    grow( s, m );
+    grow( r, n );
+    grow( tmp, n );
+    grow( red, m+2 );
   }
 
-  // to make sure it's not used for parallel, because not working yet
-  if( comm.size() > 1 ) 
+private:
+  static void grow( std::vector< double >& v, const std::size_t size )
   {
-    std::cerr << "gmres not working for parallel runs yet! file: " << __FILE__ << " line:" << __LINE__ << "\n";
-    exit(1); 
+    if ( v.size() < size )
+      v.resize( size );
   }
+};
 
-  typedef Mult<Matrix,PC_Matrix,usePC> MultType;
-  typedef typename MultType :: mult_t mult_t;
-  // get appropriate mult method 
-//  mult_t * mult_pc = MultType :: mult_pc;
-
-  typedef double *doubleP;
-#ifdef USE_MEMPROVIDER
-  int memSize = n*(m+1) 
-              + (m*(m+1)/2)
-              + n
-              + (m+1)
-              + m
-              + m;
-
-  gmresMem.resize( memSize );
-  double *V  = gmresMem.getMem(n*(m+1));
-  double *U  = gmresMem.getMem(m*(m+1)/2);
-  double *r  = gmresMem.getMem(n);
-  double *y  = gmresMem.getMem(m+1);
-  double *c  = gmresMem.getMem(m);
-  double *s  = gmresMem.getMem(m);
-#else 
-  double *V  = new double[n*(m+1)];
-  double *U  = new double[m*(m+1)/2];
-  double *r  = new double[n];
-  double *y  = new double[m+1];
-  double *c  = new double[m];
-  double *s  = new double[m];
-#endif
-  double **v = new doubleP[m+1];
-
-  // tmp mem for pc mult 
-  double * tmp = (usePC) ? (new double[n]) : 0; 
-
-  double error = -1.0;
-
-  for ( int i=0; i<=m; ++i ) 
+//! C.precondition for the preconditioned variants, never called otherwise
+template <bool usePC>
+struct GMRESPreconditioner
+{
+  template <class PC_Matrix>
+  static void apply( const PC_Matrix& C, const double* arg, double* dest )
   {
-    v[i]=V+i*n;
+    C.precondition(arg,dest);
   }
+};
 
-  int its=-1;
-
+template <>
+struct GMRESPreconditioner<false>
+{
+  template <class PC_Matrix>
+  static void apply( const PC_Matrix&, const double*, double* )
   {
-    double beta, h, rd, dd, nrm2b;
-    int j, io, uij, u0j;
-    nrm2b = dnrm2(n,b,1);
-    
-    // global sum 
-    nrm2b = comm.sum ( nrm2b );
-
-    IterationInfo info;
-
-    io=0;
-    do  
-    { // "aussere Iteration
-      ++io;
-      info.first = io;
-      info.second = std::pair<double,double>(0.0,std::abs(y[j]));
-      MultType::mult_pc(A,C,x,r,tmp, info);
-
-      daxpy(n,-1.,b,1,r,1);
-      beta = dnrm2(n,r,1);
-
-      // global sum 
-      beta = comm.sum( beta );
-      
-      dcopy(n,r,1,v[0],1);
-      dscal(n,1./beta,v[0],1);
-
-      y[0]=beta;
-      j=0;
-      uij=0;
-      do 
-      { // innere Iteration j=0,...,m-1
-        u0j=uij;
-
-        MultType::mult_pc(A,C,v[j],v[j+1],tmp,info);
-        dgemv(DuneCBlas::Transpose,n,j+1,1.,V,n,v[j+1],1,0.,U+u0j,1);
-
-        // global sum 
-        comm.sum( U+u0j, j+1 );
-        
-        dgemv(DuneCBlas::NoTranspose,n,j+1,-1.,V,n,U+u0j,1,1.,v[j+1],1);
-
-        h = dnrm2(n,v[j+1],1);
-        // global sum 
-        h = comm.sum( h );
-        
-        dscal(n,1./h,v[j+1],1);
-        
-        for ( register int i=0; i<j; ++i ) 
-        { // rotiere neue Spalte
-          double dtmp = c[i]*U[uij]-s[i]*U[uij+1];
-          U[uij+1]   = s[i]*U[uij]+c[i]*U[uij+1];
-          U[uij]     = dtmp;
-          ++uij;
-        }
-        
-        { // berechne neue Rotation
-          rd     = U[uij];
-          dd     = sqrt(rd*rd+h*h);
-          c[j]   = rd/dd;
-          s[j]   = -h/dd;
-          U[uij] = dd;
-          ++uij;
-        }
-        
-        { // rotiere rechte Seite y (vorher: y[j+1]=0)
-          y[j+1] = s[j]*y[j];
-          y[j]   = c[j]*y[j];
-        }
-        ++j;
-        if ( detailed && (comm.rank() == 0))
-        {
-          std::cout<<"gmres("<<m<<")\t"<<io<<"\t"<<j<<"\t"<<std::abs(y[j])<<std::endl;
-        }
-      } 
-      while ( j<m && fabs(y[j])>=eps*nrm2b );
-      { // minimiere bzgl Y
-        dtpsv(UpperTriangle,DuneCBlas::NoTranspose,NotUnitTriangular,j,U,y,1);
-
-        // korrigiere X
-        dgemv(DuneCBlas::NoTranspose,n,j,-1.,V,n,y,1,1.,x,1);
-      }
-    } while ( fabs(y[j])>=eps*nrm2b );
-
-    error = std::abs(y[j]);
-    
-    // R"uckgabe: Zahl der inneren Iterationen
-    its = m*(io-1)+j;
+    assert( false );
   }
+};
 
-  // if right preconditioning then do back solve 
-  MultType :: back_solve(n,C,x,tmp);
-  
-#ifdef USE_MEMPROVIDER
-  gmresMem.reset();
-#else 
-  delete[] V;
-  delete[] U;
-  delete[] r;
-  delete[] y;
-  delete[] c;
-  delete[] s;
-  delete[] v;
-#endif
-
-  if( tmp ) 
+template<bool usePC ,
+         class CommunicatorType,
+         class Matrix ,
+         class PC_Matrix >
+inline
+std::pair<int,double>
+gmres_algo2 (const CommunicatorType & comm,
+       int m, int n, const Matrix &A, const PC_Matrix & C,
+       const double *b , double *x, double eps, int maxIter,
+       bool flexible, bool detailed, GMRESWorkspace& ws )
+{
+  if ( n<=0 )
   {
-    delete[] tmp;
+    std::cerr << "WARNING: n = " << n << " in gmres_pc, file: " << __FILE__ << " line:" << __LINE__ << "\n";
+    return std::pair<int,double> (-1,0.0);
+  }
+  flexible = flexible && usePC;
+  ws.resize( n, m, flexible );
+
+  double *V   = &ws.V[0];
+  double *H   = &ws.H[0];
+  double *g   = &ws.g[0];
+  double *c   = &ws.c[0];
+  double *s   = &ws.s[0];
+  double *r   = &ws.r[0];
+  double *tmp = &ws.tmp[0];
+  double *red = &ws.red[0];
+
+  IterationInfo info;
+  info.first = 0;
+
+  // r = b - A x, ||b|| and ||r|| in one reduction
+  mult(A,x,r,info);
+  for ( int k = 0; k < n; ++k )
+    r[k] = b[k] - r[k];
+  red[0] = ddot(n,b,1,b,1);
+  red[1] = ddot(n,r,1,r,1);
+  comm.sum( red, 2 );
+  const double target = eps * std::sqrt( red[0] );
+  double beta = std::sqrt( red[1] );
+
+  int its = 0;
+  while ( beta > target && its < maxIter )
+  {
+    // "aussere Iteration
+    dcopy(n,r,1,V,1);
+    dscal(n,1./beta,V,1);
+    g[0] = beta;
+
+    int j = 0;
+    double resid = beta;
+    while ( j < m && its < maxIter )
+    { // innere Iteration j=0,...,m-1
+      double *vj = V + std::size_t(j)*n;
+      double *w  = V + std::size_t(j+1)*n;
+      double *hj = H + std::size_t(j)*(m+1);
+      info.first = its+1;
+      info.second = std::pair<double,double>(eps,resid);
+
+      const double *z = vj;
+      if ( usePC )
+      {
+        double *zj = flexible ? &ws.Z[0] + std::size_t(j)*n : tmp;
+        GMRESPreconditioner<usePC>::apply(C,vj,zj);
+        z = zj;
+      }
+      mult(A,z,w,info);
+
+      // first Gram-Schmidt pass
+      dgemv(DuneCBlas::Transpose,n,j+1,1.,V,n,w,1,0.,hj,1);
+      comm.sum( hj, j+1 );
+      dgemv(DuneCBlas::NoTranspose,n,j+1,-1.,V,n,hj,1,1.,w,1);
+
+      // second pass, with ||w||^2 in the same reduction
+      dgemv(DuneCBlas::Transpose,n,j+1,1.,V,n,w,1,0.,red,1);
+      red[j+1] = ddot(n,w,1,w,1);
+      comm.sum( red, j+2 );
+      dgemv(DuneCBlas::NoTranspose,n,j+1,-1.,V,n,red,1,1.,w,1);
+      double corr = 0.0;
+      for ( int i = 0; i <= j; ++i )
+      {
+        hj[i] += red[i];
+        corr += red[i]*red[i];
+      }
+      double hh = red[j+1] - corr;
+      // w was close to the span, the Pythagoras update has cancelled
+      if ( hh <= 0.25 * red[j+1] )
+        hh = comm.sum( ddot(n,w,1,w,1) );
+      const double h = std::sqrt( std::max( hh, 0.0 ) );
+      if ( h > 0.0 )
+        dscal(n,1./h,w,1);
+      hj[j+1] = h;
+
+      for ( int i=0; i<j; ++i )
+      { // rotiere neue Spalte
+        const double dtmp = c[i]*hj[i]-s[i]*hj[i+1];
+        hj[i+1] = s[i]*hj[i]+c[i]*hj[i+1];
+        hj[i]   = dtmp;
+      }
+      { // berechne neue Rotation
+        const double rd = hj[j];
+        const double dd = std::sqrt(rd*rd+h*h);
+        c[j]  = rd/dd;
+        s[j]  = -h/dd;
+        hj[j] = dd;
+        hj[j+1] = 0.0;
+      }
+      { // rotiere rechte Seite g (vorher: g[j+1]=0)
+        g[j+1] = s[j]*g[j];
+        g[j]   = c[j]*g[j];
+      }
+      ++j;
+      ++its;
+      resid = std::abs(g[j]);
+      if ( detailed && (comm.rank() == 0))
+      {
+        std::cout<<(flexible ? "fgmres(" : "gmres(")<<m<<")\t"<<its<<"\t"<<j<<"\t"<<resid<<std::endl;
+      }
+      // converged, or lucky breakdown: the Krylov space contains the solution
+      if ( resid <= target || h == 0.0 )
+        break;
+    }
+
+    { // minimiere bzgl y: H y = g, H obere Dreiecksmatrix
+      for ( int i = j-1; i >= 0; --i )
+      {
+        double sum = g[i];
+        for ( int k = i+1; k < j; ++k )
+          sum -= H[std::size_t(k)*(m+1)+i] * g[k];
+        g[i] = sum / H[std::size_t(i)*(m+1)+i];
+      }
+    }
+    { // korrigiere x
+      if ( flexible )
+        dgemv(DuneCBlas::NoTranspose,n,j,1.,&ws.Z[0],n,g,1,1.,x,1);
+      else if ( usePC )
+      {
+        dgemv(DuneCBlas::NoTranspose,n,j,1.,V,n,g,1,0.,r,1);
+        GMRESPreconditioner<usePC>::apply(C,r,tmp);
+        daxpy(n,1.,tmp,1,x,1);
+      }
+      else
+        dgemv(DuneCBlas::NoTranspose,n,j,1.,V,n,g,1,1.,x,1);
+    }
+
+    // restart from the true residual
+    mult(A,x,r,info);
+    for ( int k = 0; k < n; ++k )
+      r[k] = b[k] - r[k];
+    beta = std::sqrt( comm.sum( ddot(n,r,1,r,1) ) );
   }
 
-  return std::pair<int,double> (its,error);
+  return std::pair<int,double> (its,beta);
 }
 
 // ============================================================================
 
-template<class CommunicatorType, 
-         class Matrix > 
-inline 
-std::pair<int,double> 
-gmres( const CommunicatorType & comm, 
-      int m, int n, const Matrix &A, const double *b, double *x, double eps , bool verbose )
+template<class CommunicatorType,
+         class Matrix >
+inline
+std::pair<int,double>
+gmres( const CommunicatorType & comm,
+      int m, int n, const Matrix &A, const double *b, double *x, double eps,
+      int maxIter, bool verbose, GMRESWorkspace& ws )
+{
+  return gmres_algo2<false> (comm,m,n,A,A,b,x,eps,maxIter,false,verbose,ws);
+}
+
+template<class CommunicatorType,
+         class Matrix,
+         class PC_Matrix >
+inline
+std::pair<int,double>
+gmres( const CommunicatorType & comm,
+      int m, int n, const Matrix &A, const PC_Matrix & C ,
+      const double *b, double *x, double eps,
+      int maxIter, bool verbose, GMRESWorkspace& ws )
 {
-  return gmres_algo2<false> (comm,m,n,A,A,b,x,eps,verbose);
+  return gmres_algo2<true> (comm,m,n,A,C,b,x,eps,maxIter,false,verbose,ws);
 }
 
-template<class CommunicatorType, 
+//! flexible GMRES, C may change from one application to the next
+template<class CommunicatorType,
          class Matrix,
-         class PC_Matrix > 
-inline 
-std::pair<int,double> 
-gmres( const CommunicatorType & comm, 
+         class PC_Matrix >
+inline
+std::pair<int,double>
+fgmres( const CommunicatorType & comm,
       int m, int n, const Matrix &A, const PC_Matrix & C ,
-      const double *b, double *x, double eps , bool verbose )
+      const double *b, double *x, double eps,
+      int maxIter, bool verbose, GMRESWorkspace& ws )
 {
-  return gmres_algo2<true> (comm,m,n,A,C,b,x,eps,verbose);
+  return gmres_algo2<true> (comm,m,n,A,C,b,x,eps,maxIter,true,verbose,ws);
 }
 
 // ============================================================================
@@ -3,6 +3,7 @@
 
 //- system includes
 #include <utility>
+#include <vector>
 
 #include <cmake_config.h>
 
@@ -16,6 +17,7 @@
 #include "preconditioning.hh"
 
 #include <dune/fem/solver/pardg.hh>
+#include <dune/fem/oseen/solver/lanczos.hh>
 
 // include BLAS  implementation
 #include "cblas.h"
@@ -270,6 +272,8 @@ mult(A,arg,dest,info);
 #include "cghs.h"
 #include "gmres.h"
 #include "bicgsq.h"
+#include "pipecg.h"
+#include "pipebicgstab.h"
 #undef USE_MEMPROVIDER
 
 
@@ -350,7 +354,9 @@ namespace DuneStokes
       @{
    **/
 
-/** \brief OEM-CG scheme after Hestenes and Stiefel */
+/** \brief OEM-CG scheme after Hestenes and Stiefel
+    spectrum() holds the Lanczos eigenvalue estimates of the last solve
+  **/
 template <class DiscreteFunctionType, class OperatorType >
 class OEMCGOp : public Operator<
       typename DiscreteFunctionType::DomainFieldType,
@@ -366,6 +372,7 @@ private:
   typename DiscreteFunctionType::RangeFieldType epsilon_;
   int maxIter_;
   bool verbose_ ;
+  mutable Dune::Oseen::LanczosEstimate spectrum_;
 
 
   template <class OperatorImp, bool hasPreconditioning>
@@ -375,7 +382,8 @@ private:
     static ReturnValueType call(OperatorImp & op,
                      const DiscreteFunctionImp & arg,
                      DiscreteFunctionImp & dest,
-                     double eps, bool verbose)
+                     double eps, bool verbose,
+                     Dune::Oseen::LanczosEstimate* spectrum)
     {
       // use communication class of grid
       // see dune-common/common/collectivecommunication.hh
@@ -390,18 +398,18 @@ private:
 			  op.preconditionMatrix().precondition( arg.leakPointer(), precond_arg.leakPointer() );
 			  return StokesOEMSolver::cghs(arg.space().grid().comm(),
 						size,op.systemMatrix(),op.preconditionMatrix(),
-						precond_arg.leakPointer(),dest.leakPointer(),eps,verbose );
+						precond_arg.leakPointer(),dest.leakPointer(),eps,verbose,spectrum );
 		  }
 		  else
 			  return StokesOEMSolver::cghs(arg.space().grid().comm(),
 						size,op.systemMatrix(),op.preconditionMatrix(),
-						arg.leakPointer(),dest.leakPointer(),eps,verbose );
+						arg.leakPointer(),dest.leakPointer(),eps,verbose,spectrum );
 	  }
       else
       {
 		return StokesOEMSolver::cghs(arg.space().grid().comm(),
                   size,op.systemMatrix(),
-                  arg.leakPointer(),dest.leakPointer(),eps,verbose );
+                  arg.leakPointer(),dest.leakPointer(),eps,verbose,spectrum );
       }
     }
   };
@@ -414,7 +422,8 @@ private:
     static ReturnValueType call(OperatorImp & op,
                      const DiscreteFunctionImp & arg,
                      DiscreteFunctionImp & dest,
-                     double eps, bool verbose)
+                     double eps, bool verbose,
+                     Dune::Oseen::LanczosEstimate* spectrum)
     {
       // use communication class of grid
       // see dune-common/common/collectivecommunication.hh
@@ -423,7 +432,7 @@ private:
 	  return StokesOEMSolver::cghs
                 (arg.space().grid().comm(),
                 size,op.systemMatrix(),
-                arg.leakPointer(),dest.leakPointer(),eps,verbose );
+                arg.leakPointer(),dest.leakPointer(),eps,verbose,spectrum );
     }
   };
 
@@ -464,7 +473,7 @@ public:
 				   // StokesOEMSolver::PreconditionInterface
 				   Conversion<OperatorType, StokesOEMSolver::PreconditionInterface > ::exists >::
                      // call solver, see above
-                     call(op_,arg,dest,epsilon_,verbose_);
+                     call(op_,arg,dest,epsilon_,verbose_,&spectrum_);
 
     if( verbose_ && arg.space().grid().comm().rank() == 0 )
     {
@@ -486,7 +495,7 @@ public:
 				   // StokesOEMSolver::PreconditionInterface
 				   Conversion<OperatorType, StokesOEMSolver::PreconditionInterface > ::exists >::
                      // call solver, see above
-                     call(op_,arg,dest,epsilon_,verbose_);
+                     call(op_,arg,dest,epsilon_,verbose_,&spectrum_);
 
     if( verbose_ && arg.space().grid().comm().rank() == 0 )
     {
@@ -511,6 +520,11 @@ public:
   {
     epsilon_ = abs;
   }
+
+  const Dune::Oseen::LanczosEstimate& spectrum() const
+  {
+    return spectrum_;
+  }
 };
 
 /** \brief BiCG-stab solver */
@@ -734,7 +748,9 @@ public:
 };
 
 
-/** \brief GMRES solver */
+/** \brief restarted GMRES solver, right preconditioned, parallel
+    Unlike the classic OEM solvers this honours maxIter. Each instance owns its scratch memory.
+**/
 template <class DiscreteFunctionType, class OperatorType>
 class OEMGMRESOp : public Operator<
       typename DiscreteFunctionType::DomainFieldType,
@@ -753,6 +769,7 @@ private:
   typename DiscreteFunctionType::RangeFieldType epsilon_;
   int maxIter_;
   bool verbose_ ;
+  mutable StokesOEMSolver :: GMRESWorkspace workspace_;
 
   template <class OperatorImp, bool hasPreconditioning>
   struct SolverCaller
@@ -761,30 +778,17 @@ private:
     static ReturnValueType call(OperatorImp & op,
                      const DiscreteFunctionImp & arg,
                      DiscreteFunctionImp & dest,
-                     int inner, double eps, bool verbose)
+                     int inner, double eps, int maxIter, bool verbose,
+                     StokesOEMSolver :: GMRESWorkspace& workspace)
     {
       int size = arg.space().size();
       if(op.hasPreconditionMatrix())
       {
 		return StokesOEMSolver::gmres(arg.space().grid().comm(),
 				  inner, size,op.systemMatrix(),op.preconditionMatrix(),
-				  arg.leakPointer(),dest.leakPointer(),eps,verbose );
-      }
-      // in parallel case we need special treatment, if no preconditoner exist
-      else if( arg.space().grid().comm().size() > 1 )
-      {
-		StokesOEMSolver::SolverInterfaceImpl<OperatorImp> opSolve(op);
-        FakeConditionerType preConditioner(size,opSolve);
-		return StokesOEMSolver::gmres(arg.space().grid().comm(),
-                 inner,size,op.systemMatrix(),preConditioner,
-                 arg.leakPointer(),dest.leakPointer(),eps,verbose);
-      }
-      else
-      {
-		return StokesOEMSolver::gmres(arg.space().grid().comm(),
-                 inner,size,op.systemMatrix(),
-                 arg.leakPointer(),dest.leakPointer(),eps,verbose);
+				  arg.leakPointer(),dest.leakPointer(),eps,maxIter,verbose,workspace );
       }
+      return SolverCaller<OperatorImp,false>::call(op,arg,dest,inner,eps,maxIter,verbose,workspace);
     }
   };
 
@@ -796,22 +800,24 @@ private:
     static ReturnValueType call(OperatorImp & op,
                      const DiscreteFunctionImp & arg,
                      DiscreteFunctionImp & dest,
-                     int inner, double eps, bool verbose)
+                     int inner, double eps, int maxIter, bool verbose,
+                     StokesOEMSolver :: GMRESWorkspace& workspace)
     {
       int size = arg.space().size();
+      // in parallel the fake conditioner drops the copies of other processes' dofs
       if( arg.space().grid().comm().size() > 1 )
       {
 		StokesOEMSolver::SolverInterfaceImpl<OperatorImp> opSolve(op);
         FakeConditionerType preConditioner(size,opSolve);
 		return StokesOEMSolver::gmres(arg.space().grid().comm(),
                  inner,size,op.systemMatrix(),preConditioner,
-                 arg.leakPointer(),dest.leakPointer(),eps,verbose);
+                 arg.leakPointer(),dest.leakPointer(),eps,maxIter,verbose,workspace);
       }
       else
       {
 		return StokesOEMSolver::gmres(arg.space().grid().comm(),
                  inner,size,op.systemMatrix(),
-                 arg.leakPointer(),dest.leakPointer(),eps,verbose);
+                 arg.leakPointer(),dest.leakPointer(),eps,maxIter,verbose,workspace);
       }
     }
   };
@@ -842,6 +848,12 @@ public:
       \param[out] dest solution
   */
   void apply( const DiscreteFunctionType& arg, DiscreteFunctionType& dest ) const
+  {
+    ReturnValueType val;
+    apply( arg, dest, val );
+  }
+
+  void apply( const DiscreteFunctionType& arg, DiscreteFunctionType& dest, ReturnValueType& ret  ) const
   {
     // prepare operator
     prepare ( arg, dest );
@@ -849,54 +861,179 @@ public:
     int size = arg.space().size();
     int inner = (size > 20) ? 20 : size;
 
-    ReturnValueType val =
+    ret =
       SolverCaller<OperatorType,
                    // check wheter operator has precondition methods
                    // to enable preconditioning derive your operator from
 				   // StokesOEMSolver::PreconditionInterface
 				   Conversion<OperatorType, StokesOEMSolver::PreconditionInterface > ::exists >::
                      // call solver, see above
-                     call(op_,arg,dest,inner,epsilon_,verbose_);
+                     call(op_,arg,dest,inner,epsilon_,maxIter_,verbose_,workspace_);
 
     if( verbose_ && arg.space().grid().comm().rank() == 0)
     {
-      std::cout << "OEM-GMRES: " << val.first << " iterations! Error: " << val.second << "\n";
+      std::cout << "OEM-GMRES: " << ret.first << " iterations! Error: " << ret.second << "\n";
     }
 
     // finalize operator
     finalize ();
   }
-  void apply( const DiscreteFunctionType& arg, DiscreteFunctionType& dest, ReturnValueType& ret  ) const
+
+  /** \brief solve the system
+      \param[in] arg right hand side
+      \param[out] dest solution
+  */
+  void operator ()( const DiscreteFunctionType& arg, DiscreteFunctionType& dest ) const
   {
-    // prepare operator
-    prepare ( arg, dest );
+    apply(arg,dest);
+  }
 
-    int size = arg.space().size();
-    int inner = (size > 20) ? 20 : size;
+  void setAbsoluteLimit( const typename DiscreteFunctionType::RangeFieldType abs )
+  {
+    epsilon_ = abs;
+  }
+};
 
-    ReturnValueType val =
-      SolverCaller<OperatorType,
-                   // check wheter operator has precondition methods
-                   // to enable preconditioning derive your operator from
-				   // StokesOEMSolver::PreconditionInterface
-				   Conversion<OperatorType, StokesOEMSolver::PreconditionInterface > ::exists >::
-                     // call solver, see above
-                     call(op_,arg,dest,inner,epsilon_,verbose_);
+//! kernel policies of OEMPipelinedOp
+struct PipeCGKernel
+{
+  static const char* name() { return "OEM-PIPECG"; }
 
-    if( verbose_ && arg.space().grid().comm().rank() == 0)
+  template <class CommunicatorType, class MATRIX, class PC_MATRIX>
+  static std::pair<int,double> call( const CommunicatorType& comm, int size, const MATRIX& A, const PC_MATRIX& C,
+                                     const double* b, double* x, double eps, int maxIter, bool verbose )
+  {
+    return StokesOEMSolver::pipecg(comm,size,A,C,b,x,eps,maxIter,verbose);
+  }
+
+  template <class CommunicatorType, class MATRIX>
+  static std::pair<int,double> call( const CommunicatorType& comm, int size, const MATRIX& A,
+                                     const double* b, double* x, double eps, int maxIter, bool verbose )
+  {
+    return StokesOEMSolver::pipecg(comm,size,A,b,x,eps,maxIter,verbose);
+  }
+};
+
+struct PipeBICGSTABKernel
+{
+  static const char* name() { return "OEM-PIPEBICGstab"; }
+
+  template <class CommunicatorType, class MATRIX, class PC_MATRIX>
+  static std::pair<int,double> call( const CommunicatorType& comm, int size, const MATRIX& A, const PC_MATRIX& C,
+                                     const double* b, double* x, double eps, int maxIter, bool verbose )
+  {
+    return StokesOEMSolver::pipebicgstab(comm,size,A,C,b,x,eps,maxIter,verbose);
+  }
+
+  template <class CommunicatorType, class MATRIX>
+  static std::pair<int,double> call( const CommunicatorType& comm, int size, const MATRIX& A,
+                                     const double* b, double* x, double eps, int maxIter, bool verbose )
+  {
+    return StokesOEMSolver::pipebicgstab(comm,size,A,b,x,eps,maxIter,verbose);
+  }
+};
+
+/** \brief pipelined Krylov solvers, one global reduction per iteration (CG) or two (BiCGstab)
+    Unlike the other OEM solvers these honour maxIter.
+    A left preconditioner is applied to the right hand side here, the kernels then iterate on C A.
+**/
+template <class DiscreteFunctionType, class OperatorType, class Kernel>
+class OEMPipelinedOp : public Operator<
+      typename DiscreteFunctionType::DomainFieldType,
+      typename DiscreteFunctionType::RangeFieldType,
+            DiscreteFunctionType,DiscreteFunctionType> {
+
+public:
+    typedef std::pair < int , double > ReturnValueType;
+
+private:
+  OperatorType &op_;
+  typename DiscreteFunctionType::RangeFieldType epsilon_;
+  int maxIter_;
+  bool verbose_ ;
+
+  template <class OperatorImp, bool hasPreconditioning>
+  struct SolverCaller
+  {
+    template <class DiscreteFunctionImp>
+    static ReturnValueType call(OperatorImp & op,
+                     const DiscreteFunctionImp & arg,
+                     DiscreteFunctionImp & dest,
+                     double eps, int maxIter, bool verbose)
     {
-      std::cout << "OEM-GMRES: " << val.first << " iterations! Error: " << val.second << "\n";
+      int size = arg.space().size();
+      if(op.hasPreconditionMatrix())
+      {
+        if( !op.preconditionMatrix().rightPrecondition() )
+        {
+          DiscreteFunctionImp precond_arg( "precond_arg", arg.space() );
+          op.preconditionMatrix().precondition( arg.leakPointer(), precond_arg.leakPointer() );
+          return Kernel::call(arg.space().grid().comm(),
+                    size,op.systemMatrix(),op.preconditionMatrix(),
+                    precond_arg.leakPointer(),dest.leakPointer(),eps,maxIter,verbose );
+        }
+        return Kernel::call(arg.space().grid().comm(),
+                  size,op.systemMatrix(),op.preconditionMatrix(),
+                  arg.leakPointer(),dest.leakPointer(),eps,maxIter,verbose );
+      }
+      return Kernel::call(arg.space().grid().comm(),
+                size,op.systemMatrix(),
+                arg.leakPointer(),dest.leakPointer(),eps,maxIter,verbose );
     }
+  };
 
-    // finalize operator
-    finalize ();
-    ret = val;
+  //! without any preconditioning
+  template <class OperatorImp>
+  struct SolverCaller<OperatorImp,false>
+  {
+    template <class DiscreteFunctionImp>
+    static ReturnValueType call(OperatorImp & op,
+                     const DiscreteFunctionImp & arg,
+                     DiscreteFunctionImp & dest,
+                     double eps, int maxIter, bool verbose)
+    {
+      int size = arg.space().size();
+      return Kernel::call(arg.space().grid().comm(),
+                size,op.systemMatrix(),
+                arg.leakPointer(),dest.leakPointer(),eps,maxIter,verbose );
+    }
+  };
+
+public:
+  /** \brief constructor
+      \param[in] op Operator to invert
+      \param[in] redEps realative tolerance for residual
+      \param[in] absLimit absolut solving tolerance for residual
+      \param[in] maxIter maximal number of iterations performed
+      \param[in] verbose verbosity
+  */
+  OEMPipelinedOp( OperatorType & op , double  /*redEps*/ , double absLimit , int maxIter , bool verbose ) :
+        op_(op), epsilon_ ( absLimit ) ,
+        maxIter_ (maxIter ) , verbose_ ( verbose ) {
   }
 
   /** \brief solve the system
       \param[in] arg right hand side
       \param[out] dest solution
   */
+  void apply( const DiscreteFunctionType& arg, DiscreteFunctionType& dest ) const
+  {
+    ReturnValueType val;
+    apply( arg, dest, val );
+  }
+
+  void apply( const DiscreteFunctionType& arg, DiscreteFunctionType& dest, ReturnValueType& ret ) const
+  {
+    ret = SolverCaller<OperatorType,
+                   Conversion<OperatorType, StokesOEMSolver::PreconditionInterface > ::exists >::
+                     call(op_,arg,dest,epsilon_,maxIter_,verbose_);
+
+    if( verbose_ && arg.space().grid().comm().rank() == 0 )
+    {
+      std::cout << Kernel::name() << ": " << ret.first << " iterations! Error: " << ret.second << "\n";
+    }
+  }
+
   void operator ()( const DiscreteFunctionType& arg, DiscreteFunctionType& dest ) const
   {
     apply(arg,dest);
@@ -908,6 +1045,26 @@ public:
   }
 };
 
+/** \brief pipelined CG after Ghysels and Vanroose */
+template <class DiscreteFunctionType, class OperatorType>
+class OEMPIPECGOp : public OEMPipelinedOp< DiscreteFunctionType, OperatorType, PipeCGKernel >
+{
+public:
+  OEMPIPECGOp( OperatorType & op , double redEps , double absLimit , int maxIter , bool verbose )
+    : OEMPipelinedOp< DiscreteFunctionType, OperatorType, PipeCGKernel >( op, redEps, absLimit, maxIter, verbose )
+  {}
+};
+
+/** \brief pipelined BiCGstab after Cools and Vanroose */
+template <class DiscreteFunctionType, class OperatorType>
+class OEMPIPEBICGSTABOp : public OEMPipelinedOp< DiscreteFunctionType, OperatorType, PipeBICGSTABKernel >
+{
+public:
+  OEMPIPEBICGSTABOp( OperatorType & op , double redEps , double absLimit , int maxIter , bool verbose )
+    : OEMPipelinedOp< DiscreteFunctionType, OperatorType, PipeBICGSTABKernel >( op, redEps, absLimit, maxIter, verbose )
+  {}
+};
+
 /**
    @}
 **/
@@ -0,0 +1,251 @@
+#ifndef DUNE_OSEEN_PIPEBICGSTAB_BLAS_H
+#define DUNE_OSEEN_PIPEBICGSTAB_BLAS_H
+
+// ============================================================================
+//
+//  pipelined BICGstab
+//
+//  siehe
+//  S. Cools, W. Vanroose
+//     The communication-hiding pipelined BiCGStab method for the parallel
+//     solution of large unsymmetric linear systems
+//     Parallel Computing 65, 1-20 (2017)
+//
+//  Two reductions per iteration (bicgstab needs three), each accumulated in
+//  the sweep updating the vectors, communicated with one comm.sum and issued
+//  after the independent product with A. Every 20 iterations the residual
+//  and the recursively updated products are recomputed (residual replacement),
+//  convergence is confirmed with the true residual.
+//  Same operator/preconditioner conventions as bicgstab.
+//
+// ============================================================================
+
+#include <utility>
+#include <vector>
+#include <iostream>
+
+template<bool usePC,
+         class CommunicatorType,
+         class MATRIX ,
+         class PC_MATRIX >
+inline
+std::pair<int,double>
+pipebicgstab_algo2( const CommunicatorType & comm,
+    unsigned int N, const MATRIX &A, const PC_MATRIX & C,
+	  const double *rhs, double *x, double eps, int maxIter, bool detailed )
+{
+  if(N == 0)
+  {
+    std::cerr << "WARNING: N = 0 in pipebicgstab, file: " << __FILE__ << " line:" << __LINE__ << "\n";
+    return std::pair<int,double> (-1,0.0);
+  }
+  typedef Mult<MATRIX,PC_MATRIX,usePC> MultType;
+
+  std::vector< double > mem( usePC ? 11*N : 10*N, 0.0 );
+  double *r  = &mem[0];
+  double *rT = r  + N;
+  double *w  = rT + N;
+  double *t  = w  + N;
+  double *p  = t  + N;
+  double *s  = p  + N;
+  double *z  = s  + N;
+  double *v  = z  + N;
+  double *q  = v  + N;
+  double *y  = q  + N;
+  double *tmp = usePC ? y + N : 0;
+
+  const double bicgeps = 1e-40;
+
+  // the recursively updated residual drifts away from rhs - A x, so convergence is confirmed
+  // with the true residual and the iteration restarted from x if that check fails
+  const int maxRestarts = 10;
+  const int replaceInterval = 20;
+
+  IterationInfo info;
+  int its=0;
+  double err = 0.0;
+  double rTr = 0.0;
+  double lastTrueRes = 0.0;
+
+  for ( int restart = 0; restart <= maxRestarts; ++restart )
+  {
+    // r = rhs - A x, rT = r, w = A r
+    MultType :: mult_pc(A,C,x,r,tmp,info);
+    for ( unsigned int k = 0; k < N; ++k )
+    {
+      r[k] = rhs[k] - r[k];
+      rT[k] = r[k];
+      p[k] = s[k] = z[k] = v[k] = 0.0;
+    }
+    MultType :: mult_pc(A,C,r,w,tmp,info);
+
+    // (rT,r), (rT,w), (rhs,rhs)
+    double initVal[3] = { 0.0, 0.0, 0.0 };
+    for ( unsigned int k = 0; k < N; ++k )
+    {
+      initVal[0] += rT[k] * r[k];
+      initVal[1] += rT[k] * w[k];
+      initVal[2] += rhs[k] * rhs[k];
+    }
+    // t = A w, overlaps the reduction
+    MultType :: mult_pc(A,C,w,t,tmp,info);
+    comm.sum( initVal, 3 );
+
+    err = eps * eps * initVal[2];
+    rTr = initVal[0];
+    if ( rTr <= err || its >= maxIter || ( restart > 0 && rTr >= lastTrueRes ) )
+      break;
+    lastTrueRes = rTr;
+    double rTh = initVal[0];
+    if ( fabs( initVal[1] ) <= bicgeps )
+      break;
+    double alpha = rTh / initVal[1];
+    double beta = 0.0;
+    double omega = 0.0;
+
+    // (q,y), (y,y)
+    double qyVal[2];
+    // (rT,r), (rT,w), (rT,s), (rT,z), (r,r)
+    double rtVal[5];
+
+    while( rTr>err && its < maxIter )
+    {
+      info.first = its+1;
+      info.second = std::pair<double,double>(eps,sqrt(rTr));
+
+      qyVal[0] = qyVal[1] = 0.0;
+      for ( unsigned int k = 0; k < N; ++k )
+      {
+        p[k] = r[k] + beta * ( p[k] - omega * s[k] );
+        s[k] = w[k] + beta * ( s[k] - omega * z[k] );
+        z[k] = t[k] + beta * ( z[k] - omega * v[k] );
+        q[k] = r[k] - alpha * s[k];
+        y[k] = w[k] - alpha * z[k];
+        qyVal[0] += q[k] * y[k];
+        qyVal[1] += y[k] * y[k];
+      }
+      // v = A z, overlaps the reduction
+      MultType :: mult_pc(A,C,z,v,tmp,info);
+      comm.sum( qyVal, 2 );
+
+      omega = ( fabs( qyVal[1] ) < bicgeps ) ? 0.0 : qyVal[0] / qyVal[1];
+
+      for ( int i = 0; i < 5; ++i )
+        rtVal[i] = 0.0;
+      for ( unsigned int k = 0; k < N; ++k )
+      {
+        x[k] += alpha * p[k] + omega * q[k];
+        r[k] = q[k] - omega * y[k];
+        w[k] = y[k] - omega * ( t[k] - alpha * v[k] );
+        rtVal[0] += rT[k] * r[k];
+        rtVal[1] += rT[k] * w[k];
+        rtVal[2] += rT[k] * s[k];
+        rtVal[3] += rT[k] * z[k];
+        rtVal[4] += r[k] * r[k];
+      }
+      if ( (its+1) % replaceInterval == 0 )
+      {
+        // residual replacement, recompute r and the recursively updated products from x and p
+        MultType :: mult_pc(A,C,x,r,tmp,info);
+        for ( unsigned int k = 0; k < N; ++k )
+          r[k] = rhs[k] - r[k];
+        MultType :: mult_pc(A,C,r,w,tmp,info);
+        MultType :: mult_pc(A,C,p,s,tmp,info);
+        MultType :: mult_pc(A,C,s,z,tmp,info);
+        MultType :: mult_pc(A,C,z,v,tmp,info);
+        for ( int i = 0; i < 5; ++i )
+          rtVal[i] = 0.0;
+        for ( unsigned int k = 0; k < N; ++k )
+        {
+          rtVal[0] += rT[k] * r[k];
+          rtVal[1] += rT[k] * w[k];
+          rtVal[2] += rT[k] * s[k];
+          rtVal[3] += rT[k] * z[k];
+          rtVal[4] += r[k] * r[k];
+        }
+      }
+      // t = A w, overlaps the reduction
+      MultType :: mult_pc(A,C,w,t,tmp,info);
+      comm.sum( rtVal, 5 );
+
+      rTr = rtVal[4];
+      ++its;
+
+      if ( detailed && (comm.rank() == 0) )
+      {
+        std::cout<<"pipebicgstab "<<its<<"\t  tol: " << err << "   err: "<<rTr<< std::endl;
+      }
+
+      // stagnation, r is q and cannot be improved along y
+      if ( omega == 0.0 || fabs( rTh ) <= bicgeps )
+        break;
+      beta = ( alpha / omega ) * ( rtVal[0] / rTh );
+      rTh = rtVal[0];
+      const double denom = rtVal[1] + beta * rtVal[2] - beta * omega * rtVal[3];
+      if ( fabs( denom ) <= bicgeps )
+        break;
+      alpha = rTh / denom;
+    }
+  }
+
+  // if right preconditioning then do back solve
+  MultType :: back_solve(N,C,x,tmp);
+
+  return std::pair<int,double> (its,sqrt(rTr));
+}
+
+// pipebicgstab without pc matrix
+template<class CommunicatorType,
+         class MATRIX>
+inline
+std::pair<int,double>
+pipebicgstab( const CommunicatorType & comm,
+    unsigned int N, const MATRIX &A,
+	  const double *b, double *x, double eps, int maxIter, bool verbose )
+{
+  return pipebicgstab_algo2<false>(comm,N,A,A,b,x,eps,maxIter,verbose);
+}
+
+// pipebicgstab with pc matrix
+template<class CommunicatorType,
+         class MATRIX,
+         class PC_MATRIX>
+inline
+std::pair<int,double>
+pipebicgstab( const CommunicatorType & comm,
+    unsigned int N, const MATRIX &A, const PC_MATRIX & C,
+	  const double *b,double *x, double eps, int maxIter, bool verbose )
+{
+  return pipebicgstab_algo2<true>(comm,N,A,C,b,x,eps,maxIter,verbose);
+}
+
+#endif // DUNE_OSEEN_PIPEBICGSTAB_BLAS_H
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
@@ -0,0 +1,202 @@
+#ifndef DUNE_OSEEN_PIPECG_BLAS_H
+#define DUNE_OSEEN_PIPECG_BLAS_H
+
+// ============================================================================
+//
+//  pipelined CG
+//
+//  siehe
+//  P. Ghysels, W. Vanroose
+//     Hiding global synchronization latency in the preconditioned
+//     Conjugate Gradient algorithm
+//     Parallel Computing 40, 224-238 (2014)
+//
+//  Both inner products of an iteration are accumulated in the same sweep
+//  that updates the vectors and communicated with a single comm.sum.
+//  The product q = A w does not depend on them and is issued before that
+//  sum, which is where a nonblocking reduction would be overlapped.
+//  Every 20 iterations the residual is recomputed from x to stop the
+//  recursively updated vectors from drifting (residual replacement).
+//  Same operator/preconditioner conventions as cghs.
+//
+// ============================================================================
+
+#include <utility>
+#include <vector>
+#include <iostream>
+
+template< bool usePC,
+          class CommunicatorType,
+          class MATRIX ,
+          class PC_MATRIX >
+inline
+std::pair < int , double >
+pipecg_algo2( const CommunicatorType & comm,
+      unsigned int N, const MATRIX &A, const PC_MATRIX& C,
+      const double *b, double *x, double eps,
+      int maxIter, bool detailed )
+{
+  if ( N==0 )
+  {
+    std::cerr << "WARNING: N = 0 in pipecg, file: " << __FILE__ << " line:" << __LINE__ << "\n";
+    return std::pair<int,double> (-1,0.0);
+  }
+
+  typedef Mult<MATRIX,PC_MATRIX,usePC> MultType;
+
+  std::vector< double > mem( usePC ? 7*N : 6*N, 0.0 );
+  double *r = &mem[0];
+  double *w = r + N;
+  double *z = w + N;
+  double *s = z + N;
+  double *p = s + N;
+  double *q = p + N;
+  double *tmp = usePC ? q + N : 0;
+
+  IterationInfo info;
+
+  // r = b - A x
+  MultType :: mult_pc(A,C,x,r,tmp,info);
+  for ( unsigned int k = 0; k < N; ++k )
+    r[k] = b[k] - r[k];
+  // w = A r
+  MultType :: mult_pc(A,C,r,w,tmp,info);
+
+  // local parts of (r,r), (w,r) and, first time only, (b,b)
+  double red[3] = { 0.0, 0.0, 0.0 };
+  for ( unsigned int k = 0; k < N; ++k )
+  {
+    red[0] += r[k] * r[k];
+    red[1] += w[k] * r[k];
+    red[2] += b[k] * b[k];
+  }
+
+  const int replaceInterval = 20;
+  int its = 0;
+  double err = 0.0;
+  double gamma = 0.0;
+  double gamma_old = 0.0;
+  double alpha = 0.0;
+
+  while ( true )
+  {
+    info.first = its+1;
+    info.second = std::pair<double,double>(eps,sqrt(gamma));
+    // q = A w, overlaps the reduction
+    MultType :: mult_pc(A,C,w,q,tmp,info);
+
+    comm.sum( red, ( its == 0 ) ? 3 : 2 );
+    if ( its == 0 )
+      err = eps * eps * red[2];
+    gamma = red[0];
+    const double delta = red[1];
+    if ( gamma <= err || its >= maxIter )
+      break;
+
+    double beta = 0.0;
+    double denom = delta;
+    if ( its > 0 )
+    {
+      beta = gamma / gamma_old;
+      denom = delta - beta * gamma / alpha;
+    }
+    // breakdown, (w,r) = (Ar,r) vanished
+    if ( denom == 0.0 )
+      break;
+    alpha = gamma / denom;
+
+    red[0] = red[1] = 0.0;
+    for ( unsigned int k = 0; k < N; ++k )
+    {
+      z[k] = q[k] + beta * z[k];
+      s[k] = w[k] + beta * s[k];
+      p[k] = r[k] + beta * p[k];
+      x[k] += alpha * p[k];
+      r[k] -= alpha * s[k];
+      w[k] -= alpha * z[k];
+      red[0] += r[k] * r[k];
+      red[1] += w[k] * r[k];
+    }
+    if ( (its+1) % replaceInterval == 0 )
+    {
+      // residual replacement, r and the recursively updated products drift in finite precision
+      MultType :: mult_pc(A,C,x,r,tmp,info);
+      for ( unsigned int k = 0; k < N; ++k )
+        r[k] = b[k] - r[k];
+      MultType :: mult_pc(A,C,r,w,tmp,info);
+      MultType :: mult_pc(A,C,p,s,tmp,info);
+      MultType :: mult_pc(A,C,s,z,tmp,info);
+      red[0] = red[1] = 0.0;
+      for ( unsigned int k = 0; k < N; ++k )
+      {
+        red[0] += r[k] * r[k];
+        red[1] += w[k] * r[k];
+      }
+    }
+    gamma_old = gamma;
+
+    if ( detailed && (comm.rank() == 0) )
+    {
+      std::cout<<"pipecg "<<its<<"\t"<<sqrt(gamma)<< std::endl;
+    }
+    ++its;
+  }
+
+  // if right preconditioning then do back solve
+  MultType :: back_solve(N,C,x,tmp);
+
+  return std::pair<int,double> (its,sqrt(gamma));
+}
+
+// pipecg with preconditioning
+template<class CommunicatorType, class MATRIX, class PC_MATRIX >
+inline
+std::pair < int , double >
+pipecg( const CommunicatorType & comm,
+      unsigned int N, const MATRIX &A, const PC_MATRIX &C,
+      const double *b, double *x, double eps, int maxIter, bool detailed )
+{
+  return pipecg_algo2<true> (comm,N,A,C,b,x,eps,maxIter,detailed );
+}
+
+// pipecg without preconditioning
+template<class CommunicatorType, class MATRIX>
+inline
+std::pair < int , double >
+pipecg( const CommunicatorType & comm,
+      unsigned int N, const MATRIX &A,
+      const double *b, double *x, double eps, int maxIter, bool detailed )
+{
+  return pipecg_algo2<false> (comm,N,A,A,b,x,eps,maxIter,detailed );
+}
+
+#endif // DUNE_OSEEN_PIPECG_BLAS_H
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
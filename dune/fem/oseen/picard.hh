@@ -0,0 +1,296 @@
+#ifndef DUNE_OSEEN_PICARD_HH
+#define DUNE_OSEEN_PICARD_HH
+
+#include <cmake_config.h>
+
+#include <dune/fem/oseen/ldg_method.hh>
+#include <dune/fem/oseen/runinfo.hh>
+#include <dune/stuff/common/logging.hh>
+#include <dune/stuff/common/parameter/configcontainer.hh>
+#include <dune/common/exceptions.hh>
+
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+
+namespace Dune {
+namespace Oseen {
+
+//! what PicardIteration::solve did
+struct PicardInfo {
+	//! Oseen solves over all continuation stages
+	int iterations;
+	//! ||G(u) - u|| / ||G(u)|| of the last iterate
+	double residual;
+	bool converged;
+
+	PicardInfo()
+		: iterations( 0 ),
+		  residual( -1.0 ),
+		  converged( false )
+	{}
+};
+
+/** \brief Navier-Stokes as a fixed point of Oseen problems: u_{k+1} = G(u_k), G(u) the velocity of the OseenLDGMethod
+	solution with beta = u. Plain Picard converges linearly with a rate that degrades with the Reynolds number, so the
+	velocity iterates are Anderson accelerated (Walker/Ni, SIAM J Numer Anal 49, 1715-1735 (2011)): with the last
+	picard_anderson_depth differences of residuals f = G(u) - u and of G(u),
+	\f$ u_{k+1} = G(u_k) - \Delta G \gamma - (1 - \beta) ( f_k - \Delta F \gamma ) \f$, \f$ \gamma \f$ minimising
+	\f$ \| f_k - \Delta F \gamma \| \f$, \f$ \beta \f$ = picard_damping. Depth 0 is plain (damped) Picard.
+	Whenever ||f|| grows by more than picard_restart_factor the history is dropped, which keeps Anderson from stagnating
+	where plain Picard converges; the residuals of accelerated iterates are not monotone, so the factor should exceed 1.
+	Reynolds continuation: with picard_viscosity_start above the target viscosity the viscosity is lowered geometrically
+	in picard_continuation_steps stages, each solved to picard_continuation_tolerance, only the last to picard_tolerance.
+	Every Oseen solve starts from the current iterate (velocity and pressure, warm_start is set for the duration).
+	The model for a given viscosity comes from ModelFactory, model_factory( viscosity ) has to return a DiscreteModelType
+	with convection scaling 1; the force may depend on the viscosity.
+  **/
+template < class OseenLDGMethodType >
+class PicardIteration
+{
+	public:
+		typedef typename OseenLDGMethodType::Traits
+			Traits;
+		typedef typename OseenLDGMethodType::DiscreteModelType
+			DiscreteModelType;
+		typedef typename OseenLDGMethodType::RangeType
+			RangeType;
+		typedef typename Traits::DiscreteVelocityFunctionType
+			DiscreteVelocityFunctionType;
+		typedef typename Traits::GridPartType
+			GridPartType;
+		typedef typename Traits::DiscreteOseenFunctionSpaceWrapperType
+			SpaceWrapperType;
+
+		struct Parameters {
+			double tolerance;
+			int max_iterations;
+			int anderson_depth;
+			double damping;
+			double viscosity_start;
+			int continuation_steps;
+			double continuation_tolerance;
+			double restart_factor;
+
+			Parameters()
+				: tolerance( DSC_CONFIG_GET( "picard_tolerance", 1e-8 ) ),
+				max_iterations( DSC_CONFIG_GET( "picard_max_iterations", 50 ) ),
+				anderson_depth( DSC_CONFIG_GET( "picard_anderson_depth", 5 ) ),
+				damping( DSC_CONFIG_GET( "picard_damping", 1.0 ) ),
+				viscosity_start( DSC_CONFIG_GET( "picard_viscosity_start", 0.0 ) ),
+				continuation_steps( DSC_CONFIG_GET( "picard_continuation_steps", 1 ) ),
+				continuation_tolerance( DSC_CONFIG_GET( "picard_continuation_tolerance", 1e-3 ) ),
+				restart_factor( DSC_CONFIG_GET( "picard_restart_factor", 2.0 ) )
+			{
+				if ( anderson_depth < 0 || damping <= 0.0 || damping > 1.0 || continuation_steps < 1 )
+					DUNE_THROW( InvalidStateException, "picard: need picard_anderson_depth >= 0, 0 < picard_damping <= 1 "
+								"and picard_continuation_steps >= 1" );
+			}
+		};
+
+		PicardIteration( GridPartType& gridPart, SpaceWrapperType& spaceWrapper, const Parameters& parameters = Parameters() )
+			: gridPart_( gridPart ),
+			  spaceWrapper_( spaceWrapper ),
+			  parameters_( parameters )
+		{}
+
+		/** \param solution initial guess on entry (zero velocity makes the first step a Stokes solve), result on exit
+			\param rhs_datacontainer if given, filled by the last Oseen solve
+			\param run_info if given, gets the solver statistics of the last Oseen solve (OseenLDGMethod::getRuninfo)
+		  **/
+		template < class ModelFactory >
+		PicardInfo solve( const ModelFactory& model_factory, const double viscosity, RangeType& solution,
+						  RhsDatacontainer< Traits >* rhs_datacontainer = nullptr, DSC::RunInfo* run_info = nullptr )
+		{
+			//warm_start is restored however we leave, a failing Oseen solve throws
+			struct WarmStartGuard {
+				const bool warm_start;
+				~WarmStartGuard() { DSC_CONFIG.set( "warm_start", warm_start ); }
+			} const guard = { DSC_CONFIG_GET( "warm_start", false ) };
+			DSC_CONFIG.set( "warm_start", true );
+			PicardInfo info;
+			const bool continuation = parameters_.viscosity_start > viscosity;
+			const int stages = continuation ? parameters_.continuation_steps : 1;
+			for ( int stage = 1; stage <= stages; ++stage ) {
+				const double stage_viscosity = continuation
+						? parameters_.viscosity_start * std::pow( viscosity / parameters_.viscosity_start, double( stage ) / stages )
+						: viscosity;
+				const double tolerance = stage == stages ? parameters_.tolerance : parameters_.continuation_tolerance;
+				DSC_LOG_INFO << "picard: viscosity " << stage_viscosity << ", stage " << stage << "/" << stages << std::endl;
+				const bool converged = iterate( model_factory( stage_viscosity ), tolerance, solution,
+												stage == stages ? rhs_datacontainer : nullptr, run_info, info );
+				if ( !converged && stage < stages )
+					DSC_LOG_INFO << "picard: continuation stage not converged, going on" << std::endl;
+				info.converged = converged;
+			}
+			return info;
+		}
+
+	private:
+		typedef std::unique_ptr< DiscreteVelocityFunctionType >
+			VelocityPtr;
+
+		//! Anderson accelerated fixed point iteration for one viscosity, the history starts empty
+		bool iterate( const DiscreteModelType& model, const double tolerance, RangeType& solution,
+					  RhsDatacontainer< Traits >* rhs_datacontainer, DSC::RunInfo* run_info, PicardInfo& info )
+		{
+			const int depth = parameters_.anderson_depth;
+			std::vector< VelocityPtr > delta_f;
+			std::vector< VelocityPtr > delta_g;
+			const auto& velocity_space = solution.discreteVelocity().space();
+			DiscreteVelocityFunctionType f( "picard_f", velocity_space );
+			DiscreteVelocityFunctionType f_last( "picard_f_last", velocity_space );
+			DiscreteVelocityFunctionType g_last( "picard_g_last", velocity_space );
+			RangeType next( "picard_", spaceWrapper_, gridPart_ );
+			double f_last_norm = 0.0;
+			for ( int k = 0; k < parameters_.max_iterations; ++k ) {
+				// g = G(u_k), starting from u_k
+				next.assign( solution );
+				OseenLDGMethodType oseen( model, gridPart_, spaceWrapper_, solution.discreteVelocity(), true );
+				oseen.apply( solution, next, rhs_datacontainer );
+				if ( run_info )
+					oseen.getRuninfo( *run_info );
+				++info.iterations;
+				DiscreteVelocityFunctionType& g = next.discreteVelocity();
+				f.assign( g );
+				f -= solution.discreteVelocity();
+				const double g_norm = std::sqrt( g.scalarProductDofs( g ) );
+				info.residual = std::sqrt( f.scalarProductDofs( f ) ) / ( g_norm > 0.0 ? g_norm : 1.0 );
+				DSC_LOG_INFO << "picard: iteration " << k + 1 << ", residual " << info.residual << std::endl;
+
+				// the accelerated step made things worse: restart the history, the next step is a plain one
+				const double f_norm = std::sqrt( f.scalarProductDofs( f ) );
+				if ( k > 0 && f_norm > parameters_.restart_factor * f_last_norm ) {
+					delta_f.clear();
+					delta_g.clear();
+				}
+				else if ( depth > 0 && k > 0 ) {
+					if ( int( delta_f.size() ) == depth ) {
+						// oldest column is recycled
+						std::rotate( delta_f.begin(), delta_f.begin() + 1, delta_f.end() );
+						std::rotate( delta_g.begin(), delta_g.begin() + 1, delta_g.end() );
+					}
+					else {
+						delta_f.push_back( VelocityPtr( new DiscreteVelocityFunctionType( "picard_delta_f", velocity_space ) ) );
+						delta_g.push_back( VelocityPtr( new DiscreteVelocityFunctionType( "picard_delta_g", velocity_space ) ) );
+					}
+					delta_f.back()->assign( f );
+					*delta_f.back() -= f_last;
+					delta_g.back()->assign( g );
+					*delta_g.back() -= g_last;
+				}
+				if ( info.residual <= tolerance ) {
+					solution.assign( next );
+					return true;
+				}
+				f_last.assign( f );
+				g_last.assign( g );
+				f_last_norm = f_norm;
+
+				// u_{k+1} = g - dG gamma - (1 - beta) ( f - dF gamma )
+				const std::vector< double > gamma = leastSquares( delta_f, f );
+				solution.discretePressure().assign( next.discretePressure() );
+				DiscreteVelocityFunctionType& u = solution.discreteVelocity();
+				u.assign( g );
+				u.axpy( -( 1.0 - parameters_.damping ), f );
+				for ( std::size_t i = 0; i < gamma.size(); ++i ) {
+					u.axpy( -gamma[i], *delta_g[i] );
+					u.axpy( ( 1.0 - parameters_.damping ) * gamma[i], *delta_f[i] );
+				}
+			}
+			return false;
+		}
+
+		/** gamma minimising ||f - dF gamma|| from the normal equations, the history is short and Cholesky is cheap,
+			columns making the Gram matrix singular to working precision are left out (gamma_i = 0)
+		  **/
+		static std::vector< double > leastSquares( const std::vector< VelocityPtr >& delta_f, const DiscreteVelocityFunctionType& f )
+		{
+			const std::size_t m = delta_f.size();
+			std::vector< double > gram( m * m );
+			std::vector< double > gamma( m );
+			for ( std::size_t i = 0; i < m; ++i ) {
+				for ( std::size_t j = 0; j <= i; ++j )
+					gram[ i * m + j ] = gram[ j * m + i ] = delta_f[i]->scalarProductDofs( *delta_f[j] );
+				gamma[i] = delta_f[i]->scalarProductDofs( f );
+			}
+			// in place Cholesky, lower triangle
+			std::vector< bool > active( m, true );
+			for ( std::size_t j = 0; j < m; ++j ) {
+				double diagonal = gram[ j * m + j ];
+				for ( std::size_t k = 0; k < j; ++k )
+					if ( active[k] )
+						diagonal -= gram[ j * m + k ] * gram[ j * m + k ];
+				if ( diagonal <= 1e-12 * gram[ j * m + j ] || diagonal <= 0.0 ) {
+					active[j] = false;
+					continue;
+				}
+				gram[ j * m + j ] = std::sqrt( diagonal );
+				for ( std::size_t i = j + 1; i < m; ++i ) {
+					double sum = gram[ i * m + j ];
+					for ( std::size_t k = 0; k < j; ++k )
+						if ( active[k] )
+							sum -= gram[ i * m + k ] * gram[ j * m + k ];
+					gram[ i * m + j ] = sum / gram[ j * m + j ];
+				}
+			}
+			for ( std::size_t i = 0; i < m; ++i ) {
+				if ( !active[i] ) {
+					gamma[i] = 0.0;
+					continue;
+				}
+				for ( std::size_t k = 0; k < i; ++k )
+					if ( active[k] )
+						gamma[i] -= gram[ i * m + k ] * gamma[k];
+				gamma[i] /= gram[ i * m + i ];
+			}
+			for ( std::size_t i = m; i-- > 0; ) {
+				if ( !active[i] )
+					continue;
+				for ( std::size_t k = i + 1; k < m; ++k )
+					if ( active[k] )
+						gamma[i] -= gram[ k * m + i ] * gamma[k];
+				gamma[i] /= gram[ i * m + i ];
+			}
+			return gamma;
+		}
+
+		GridPartType& gridPart_;
+		SpaceWrapperType& spaceWrapper_;
+		const Parameters parameters_;
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_PICARD_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
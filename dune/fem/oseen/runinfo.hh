@@ -40,6 +40,8 @@ struct RunInfo
 	int iterations_inner_max;
 	int iterations_outer_total;
 	double max_inner_accuracy;
+	//! Lanczos eigenvalue estimates of the outer (Schur complement) and inner (A) CG operators, -1 if unknown
+	double outer_eigenvalue_min, outer_eigenvalue_max, inner_eigenvalue_min, inner_eigenvalue_max;
 	std::string problemIdentifier;
 	double current_time, delta_t, viscosity, reynolds, alpha;
 	std::string algo_id;
@@ -53,6 +55,7 @@ struct RunInfo
 		bfg_tau = max_inner_accuracy = grid_width
 				= solver_accuracy = run_time = cumulative_run_time
 				= alpha = inner_solver_accuracy = -1.0;
+		outer_eigenvalue_min = outer_eigenvalue_max = inner_eigenvalue_min = inner_eigenvalue_max = -1.0;
 		gridname = problemIdentifier = "UNSET";
 		extra_info = "none";
 		delta_t = 0.1;
@@ -72,7 +75,7 @@ struct RunInfo
     template < class StreamPtr >
     void tableLine( StreamPtr& stream ) const
 	{
-		static boost::format line("%e,%d,%e,%d,%d,%d,%d,%d,%s,%e,%e,%e,%s,%d,%d,%d,%d,%e,%s,%e,%e,%e,%e,%e,%s,%e");
+		static boost::format line("%e,%d,%e,%d,%d,%d,%d,%d,%s,%e,%e,%e,%s,%d,%d,%d,%d,%e,%s,%e,%e,%e,%e,%e,%s,%e,%e,%e,%e,%e");
 		static boost::format single(",%e");
         *stream << line %
 				  grid_width%
@@ -97,7 +100,8 @@ struct RunInfo
 				  problemIdentifier%
 				  current_time%  delta_t%  viscosity%  reynolds%  alpha%
 				  algo_id%
-				  cumulative_run_time;
+				  cumulative_run_time%
+				  outer_eigenvalue_min% outer_eigenvalue_max% inner_eigenvalue_min% inner_eigenvalue_max;
         for( double err : L2Errors ) {
             *stream << 	single % err ;
 		}
@@ -109,7 +113,7 @@ struct RunInfo
     template < class StreamPtr >
     void tableHeader( StreamPtr& stream ) const
 	{
-		static boost::format line("%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s");
+		static boost::format line("%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s");
         *stream << line %
 				  "grid_width"%
 				  "refine_level"%
@@ -133,7 +137,8 @@ struct RunInfo
 				  "problemIdentifier"%
 				  "current_time"%  "delta_t"%  "viscosity"%  "reynolds"%  "alpha"%
 				  "algo_id"%
-				  "cumulative_run_time";
+				  "cumulative_run_time"%
+				  "outer_eigenvalue_min"% "outer_eigenvalue_max"% "inner_eigenvalue_min"% "inner_eigenvalue_max";
 		static boost::format err(",%s_%d");
 		for( size_t i = 0; i < L2Errors.size(); ++i ) {
             *stream << 	err % "L2" % i;
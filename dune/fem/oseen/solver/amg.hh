@@ -0,0 +1,490 @@
+#ifndef DUNE_OSEEN_SOLVERS_AMG_HH
+#define DUNE_OSEEN_SOLVERS_AMG_HH
+
+#include <cmake_config.h>
+
+#include <dune/fem/oseen/assembler/compressed_rowstorage.hh>
+#include <dune/fem/oseen/solver/block_smoother.hh>
+#include <dune/stuff/common/logging.hh>
+#include <dune/stuff/common/parameter/configcontainer.hh>
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace Dune {
+namespace Oseen {
+
+/** \brief smoothed aggregation AMG, applied as one V-cycle per preconditioner call
+	Aggregates are built from whole diagonal blocks (one DG element on the finest level) using the
+	block-Frobenius strength of connection, so element dofs are never split. The near null space is not known
+	algebraically for a DG basis, it is approximated by test vectors: ones plus pseudo random vectors, relaxed
+	with the block Jacobi smoother on A x = 0 (adaptive SA). Per aggregate these are orthonormalised into the
+	tentative prolongator, the coarse test vectors are the R factors, so every coarse block has one dof per
+	test vector. The prolongator is smoothed with one damped point Jacobi step. Smoothers are damped block Jacobi
+	(threaded with USE_OMP), pre and post smoothing are the same, so the cycle is symmetric for symmetric A.
+	The coarsest level is solved with a dense LU.
+  **/
+class AggregationAMG
+{
+	public:
+		struct Parameters {
+			int block_size;
+			int test_vectors;
+			int test_sweeps;
+			double strength;
+			int max_levels;
+			int coarse_size;
+			int smoothing_steps;
+			double smoother_damping;
+			bool smooth_prolongation;
+
+			Parameters( const int block_size_in = 1 )
+				: block_size( block_size_in ),
+				test_vectors( DSC_CONFIG_GET( "amg_test_vectors", 3 ) ),
+				test_sweeps( DSC_CONFIG_GET( "amg_test_sweeps", 10 ) ),
+				strength( DSC_CONFIG_GET( "amg_strength", 0.08 ) ),
+				max_levels( DSC_CONFIG_GET( "amg_max_levels", 10 ) ),
+				coarse_size( DSC_CONFIG_GET( "amg_coarse_size", 500 ) ),
+				smoothing_steps( DSC_CONFIG_GET( "amg_smoothing_steps", 1 ) ),
+				smoother_damping( DSC_CONFIG_GET( "amg_smoother_damping", 0.7 ) ),
+				smooth_prolongation( DSC_CONFIG_GET( "amg_smooth_prolongation", true ) )
+			{}
+		};
+
+		AggregationAMG( const CompressedRowStorage& matrix, const Parameters& parameters )
+			: parameters_( parameters )
+		{
+			levels_.push_back( Level() );
+			levels_.back().a = matrix;
+			int block_size = parameters_.block_size;
+			if ( block_size < 1 || matrix.rows() % block_size != 0 )
+				block_size = 1;
+			std::vector< double > test_vectors;
+			while ( true ) {
+				Level& fine = levels_.back();
+				fine.smoother.assign( fine.a, block_size );
+				const int n = fine.a.rows();
+				if ( levels_.size() == 1 )
+					initTestVectors( fine, test_vectors );
+				if ( n <= parameters_.coarse_size || int( levels_.size() ) >= parameters_.max_levels )
+					break;
+				std::vector< double > coarse_test_vectors;
+				const int coarse_n = buildProlongation( fine, test_vectors, coarse_test_vectors );
+				if ( coarse_n == 0 || coarse_n > 0.8 * n ) {
+					fine.p.clear();
+					break;
+				}
+				transpose( fine.p, fine.r );
+				CompressedRowStorage ap;
+				multiply( fine.a, fine.p, ap );
+				levels_.push_back( Level() );
+				Level& coarse = levels_.back();
+				multiply( levels_[ levels_.size() - 2 ].r, ap, coarse.a );
+				test_vectors.swap( coarse_test_vectors );
+				block_size = parameters_.test_vectors;
+			}
+			for ( std::size_t l = 0; l < levels_.size(); ++l ) {
+				const int n = levels_[l].a.rows();
+				levels_[l].x.assign( n, 0.0 );
+				levels_[l].b.assign( n, 0.0 );
+				levels_[l].res.assign( n, 0.0 );
+			}
+			factorCoarsest();
+			DSC_LOG_INFO << "AggregationAMG: " << levels_.size() << " levels, " << levels_.back().a.rows()
+						 << " coarse dofs, operator complexity " << operatorComplexity() << std::endl;
+		}
+
+		//! z = V-cycle( r ), zero initial guess
+		void apply( const double* r, double* z ) const
+		{
+			Level& fine = levels_[0];
+			std::copy( r, r + fine.a.rows(), fine.b.begin() );
+			cycle( 0 );
+			std::copy( fine.x.begin(), fine.x.end(), z );
+		}
+
+		int levels() const { return levels_.size(); }
+
+		//! sum of nonzeros on all levels over nonzeros of the finest
+		double operatorComplexity() const
+		{
+			double sum = 0.0;
+			for ( std::size_t l = 0; l < levels_.size(); ++l )
+				sum += levels_[l].a.nonZeros();
+			return levels_[0].a.nonZeros() == 0 ? 1.0 : sum / levels_[0].a.nonZeros();
+		}
+
+	private:
+		struct Level {
+			CompressedRowStorage a;
+			CompressedRowStorage p;
+			CompressedRowStorage r;
+			BlockDiagonalInverse smoother;
+			std::vector< double > x;
+			std::vector< double > b;
+			std::vector< double > res;
+		};
+
+		void cycle( const std::size_t l ) const
+		{
+			Level& level = levels_[l];
+			if ( l + 1 == levels_.size() ) {
+				solveCoarsest( level );
+				return;
+			}
+			// pre smoothing, the first sweep starts from x = 0
+			level.smoother.apply( &level.b[0], &level.x[0], parameters_.smoother_damping );
+			for ( int step = 1; step < parameters_.smoothing_steps; ++step )
+				smooth( level );
+			residual( level );
+			Level& coarse = levels_[ l + 1 ];
+			level.r.mult( &level.res[0], &coarse.b[0] );
+			cycle( l + 1 );
+			level.p.multAdd( &coarse.x[0], &level.x[0] );
+			for ( int step = 0; step < parameters_.smoothing_steps; ++step )
+				smooth( level );
+		}
+
+		void residual( Level& level ) const
+		{
+			const int n = level.a.rows();
+			level.a.mult( &level.x[0], &level.res[0] );
+			for ( int i = 0; i < n; ++i )
+				level.res[i] = level.b[i] - level.res[i];
+		}
+
+		//! x += omega D^{-1} ( b - A x )
+		void smooth( Level& level ) const
+		{
+			residual( level );
+			level.smoother.applyAdd( &level.res[0], &level.x[0], parameters_.smoother_damping );
+		}
+
+		//! ones plus pseudo random vectors, relaxed on A x = 0; stored interleaved, entry i of vector k at [i*m+k]
+		void initTestVectors( Level& level, std::vector< double >& test_vectors ) const
+		{
+			const int n = level.a.rows();
+			const int m = parameters_.test_vectors;
+			test_vectors.assign( std::size_t( n ) * m, 0.0 );
+			unsigned long seed = 12345;
+			std::vector< double > ax( n );
+			std::vector< double > column( n );
+			for ( int k = 0; k < m; ++k ) {
+				for ( int i = 0; i < n; ++i ) {
+					if ( k == 0 )
+						column[i] = 1.0;
+					else {
+						seed = seed * 6364136223846793005ul + 1442695040888963407ul;
+						column[i] = double( ( seed >> 33 ) % 2000001 ) / 1000000.0 - 1.0;
+					}
+				}
+				for ( int sweep = 0; sweep < parameters_.test_sweeps; ++sweep ) {
+					level.a.mult( &column[0], &ax[0] );
+					level.smoother.applyAdd( &ax[0], &column[0], -parameters_.smoother_damping );
+				}
+				for ( int i = 0; i < n; ++i )
+					test_vectors[ std::size_t( i ) * m + k ] = column[i];
+			}
+		}
+
+		/** aggregate whole blocks, orthonormalise the test vectors per aggregate into the tentative prolongator
+			and smooth it. \return number of coarse dofs
+		  **/
+		int buildProlongation( Level& level, const std::vector< double >& test_vectors,
+							   std::vector< double >& coarse_test_vectors ) const
+		{
+			const CompressedRowStorage& a = level.a;
+			const int n = a.rows();
+			const int bs = level.smoother.blockSize();
+			const int blocks = n / bs;
+			const int m = parameters_.test_vectors;
+
+			// block strength graph
+			std::vector< int > graph_start( blocks + 1, 0 );
+			std::vector< int > graph_col;
+			std::vector< double > graph_val;
+			std::vector< double > block_norm( blocks, 0.0 );
+			{
+				std::vector< int > marker( blocks, -1 );
+				for ( int block = 0; block < blocks; ++block ) {
+					const int begin = graph_col.size();
+					for ( int row = block * bs; row < ( block + 1 ) * bs; ++row ) {
+						for ( int pos = a.rowStart( row ); pos < a.rowEnd( row ); ++pos ) {
+							const int other = a.colIndex( pos ) / bs;
+							const double val = a.value( pos ) * a.value( pos );
+							if ( marker[ other ] < begin ) {
+								marker[ other ] = graph_col.size();
+								graph_col.push_back( other );
+								graph_val.push_back( val );
+							}
+							else
+								graph_val[ marker[ other ] ] += val;
+						}
+					}
+					graph_start[ block + 1 ] = graph_col.size();
+					for ( int pos = begin; pos < int( graph_col.size() ); ++pos ) {
+						graph_val[ pos ] = std::sqrt( graph_val[ pos ] );
+						if ( graph_col[ pos ] == block )
+							block_norm[ block ] = graph_val[ pos ];
+					}
+				}
+			}
+			const double theta = parameters_.strength;
+			auto strong = [&]( const int block, const int pos ) {
+				return graph_col[ pos ] != block
+						&& graph_val[ pos ] >= theta * std::sqrt( block_norm[ block ] * block_norm[ graph_col[ pos ] ] );
+			};
+
+			// greedy aggregation (Vanek, Mandel, Brezina)
+			std::vector< int > aggregate( blocks, -1 );
+			int aggregates = 0;
+			for ( int block = 0; block < blocks; ++block ) {
+				if ( aggregate[ block ] >= 0 )
+					continue;
+				bool free_neighbourhood = true;
+				for ( int pos = graph_start[ block ]; pos < graph_start[ block + 1 ]; ++pos )
+					if ( strong( block, pos ) && aggregate[ graph_col[ pos ] ] >= 0 )
+						free_neighbourhood = false;
+				if ( !free_neighbourhood )
+					continue;
+				aggregate[ block ] = aggregates;
+				for ( int pos = graph_start[ block ]; pos < graph_start[ block + 1 ]; ++pos )
+					if ( strong( block, pos ) )
+						aggregate[ graph_col[ pos ] ] = aggregates;
+				++aggregates;
+			}
+			// attach leftovers to the strongest connected aggregate of the first pass
+			std::vector< int > first_pass( aggregate );
+			for ( int block = 0; block < blocks; ++block ) {
+				if ( aggregate[ block ] >= 0 )
+					continue;
+				double best = -1.0;
+				for ( int pos = graph_start[ block ]; pos < graph_start[ block + 1 ]; ++pos ) {
+					if ( strong( block, pos ) && first_pass[ graph_col[ pos ] ] >= 0 && graph_val[ pos ] > best ) {
+						best = graph_val[ pos ];
+						aggregate[ block ] = first_pass[ graph_col[ pos ] ];
+					}
+				}
+			}
+			// whatever is left (no strong connections) forms its own aggregates
+			for ( int block = 0; block < blocks; ++block ) {
+				if ( aggregate[ block ] >= 0 )
+					continue;
+				aggregate[ block ] = aggregates;
+				for ( int pos = graph_start[ block ]; pos < graph_start[ block + 1 ]; ++pos )
+					if ( strong( block, pos ) && aggregate[ graph_col[ pos ] ] < 0 )
+						aggregate[ graph_col[ pos ] ] = aggregates;
+				++aggregates;
+			}
+
+			// tentative prolongator, modified Gram-Schmidt per aggregate
+			std::vector< int > agg_start( aggregates + 1, 0 );
+			for ( int block = 0; block < blocks; ++block )
+				++agg_start[ aggregate[ block ] + 1 ];
+			for ( int agg = 0; agg < aggregates; ++agg )
+				agg_start[ agg + 1 ] += agg_start[ agg ];
+			std::vector< int > agg_blocks( blocks );
+			{
+				std::vector< int > fill( agg_start.begin(), agg_start.end() - 1 );
+				for ( int block = 0; block < blocks; ++block )
+					agg_blocks[ fill[ aggregate[ block ] ]++ ] = block;
+			}
+			const int coarse_n = aggregates * m;
+			coarse_test_vectors.assign( std::size_t( coarse_n ) * m, 0.0 );
+			std::vector< double > q( test_vectors );
+			for ( int agg = 0; agg < aggregates; ++agg ) {
+				for ( int c = 0; c < m; ++c ) {
+					double* r_row = &coarse_test_vectors[ std::size_t( agg * m + c ) * m ];
+					for ( int prev = 0; prev < c; ++prev ) {
+						double proj = 0.0;
+						forAggregateDofs( agg, agg_start, agg_blocks, bs, [&]( const int i ) {
+							proj += q[ std::size_t( i ) * m + prev ] * q[ std::size_t( i ) * m + c ];
+						});
+						forAggregateDofs( agg, agg_start, agg_blocks, bs, [&]( const int i ) {
+							q[ std::size_t( i ) * m + c ] -= proj * q[ std::size_t( i ) * m + prev ];
+						});
+						coarse_test_vectors[ std::size_t( agg * m + prev ) * m + c ] = proj;
+					}
+					double norm = 0.0;
+					forAggregateDofs( agg, agg_start, agg_blocks, bs, [&]( const int i ) {
+						norm += q[ std::size_t( i ) * m + c ] * q[ std::size_t( i ) * m + c ];
+					});
+					norm = std::sqrt( norm );
+					r_row[ c ] = norm;
+					// linearly dependent candidate, its coarse dof stays decoupled
+					const double inv = norm > 1e-12 ? 1.0 / norm : 0.0;
+					forAggregateDofs( agg, agg_start, agg_blocks, bs, [&]( const int i ) {
+						q[ std::size_t( i ) * m + c ] *= inv;
+					});
+				}
+			}
+			std::vector< int > p_start( n + 1, 0 );
+			std::vector< int > p_col( std::size_t( n ) * m );
+			std::vector< double > p_val( std::size_t( n ) * m );
+			for ( int i = 0; i < n; ++i ) {
+				const int agg = aggregate[ i / bs ];
+				p_start[ i + 1 ] = ( i + 1 ) * m;
+				for ( int c = 0; c < m; ++c ) {
+					p_col[ std::size_t( i ) * m + c ] = agg * m + c;
+					p_val[ std::size_t( i ) * m + c ] = q[ std::size_t( i ) * m + c ];
+				}
+			}
+			CompressedRowStorage tentative;
+			tentative.swapIn( n, coarse_n, p_start, p_col, p_val );
+			if ( !parameters_.smooth_prolongation ) {
+				level.p = tentative;
+				return coarse_n;
+			}
+
+			// P = ( I - 4/3 / rho( D^{-1} A ) D^{-1} A ) P_tent, D the point diagonal
+			std::vector< double > inv_diag( n, 1.0 );
+			for ( int row = 0; row < n; ++row )
+				for ( int pos = a.rowStart( row ); pos < a.rowEnd( row ); ++pos )
+					if ( a.colIndex( pos ) == row && a.value( pos ) != 0.0 )
+						inv_diag[ row ] = 1.0 / a.value( pos );
+			const double rho = estimateSpectralRadius( a, inv_diag );
+			CompressedRowStorage ap;
+			multiply( a, tentative, ap );
+			for ( int row = 0; row < n; ++row )
+				for ( int pos = ap.rowStart( row ); pos < ap.rowEnd( row ); ++pos )
+					ap.value( pos ) *= inv_diag[ row ];
+			add( 1.0, tentative, -( 4.0 / 3.0 ) / rho, ap, level.p );
+			return coarse_n;
+		}
+
+		template < class FunctorType >
+		static void forAggregateDofs( const int agg, const std::vector< int >& agg_start, const std::vector< int >& agg_blocks,
+									  const int bs, FunctorType functor )
+		{
+			for ( int k = agg_start[ agg ]; k < agg_start[ agg + 1 ]; ++k )
+				for ( int i = agg_blocks[k] * bs; i < ( agg_blocks[k] + 1 ) * bs; ++i )
+					functor( i );
+		}
+
+		//! a few power iterations for rho( D^{-1} A )
+		static double estimateSpectralRadius( const CompressedRowStorage& a, const std::vector< double >& inv_diag )
+		{
+			const int n = a.rows();
+			std::vector< double > x( n ), y( n );
+			for ( int i = 0; i < n; ++i )
+				x[i] = 1.0 + ( i % 7 ) * 0.1;
+			double rho = 1.0;
+			for ( int iteration = 0; iteration < 15; ++iteration ) {
+				double norm = 0.0;
+				for ( int i = 0; i < n; ++i )
+					norm += x[i] * x[i];
+				norm = std::sqrt( norm );
+				if ( norm == 0.0 )
+					break;
+				for ( int i = 0; i < n; ++i )
+					x[i] /= norm;
+				a.mult( &x[0], &y[0] );
+				double new_norm = 0.0;
+				for ( int i = 0; i < n; ++i ) {
+					y[i] *= inv_diag[i];
+					new_norm += y[i] * y[i];
+				}
+				rho = std::sqrt( new_norm );
+				x.swap( y );
+			}
+			return rho > 0.0 ? rho : 1.0;
+		}
+
+		//! dense LU with partial pivoting, (numerically) zero pivots decouple their dof
+		void factorCoarsest()
+		{
+			const CompressedRowStorage& a = levels_.back().a;
+			const int n = a.rows();
+			coarse_lu_.assign( std::size_t( n ) * n, 0.0 );
+			coarse_pivot_.resize( n );
+			double scale = 0.0;
+			for ( int row = 0; row < n; ++row )
+				for ( int pos = a.rowStart( row ); pos < a.rowEnd( row ); ++pos ) {
+					coarse_lu_[ std::size_t( row ) * n + a.colIndex( pos ) ] += a.value( pos );
+					scale = std::max( scale, std::fabs( a.value( pos ) ) );
+				}
+			for ( int col = 0; col < n; ++col ) {
+				int pivot = col;
+				for ( int row = col + 1; row < n; ++row )
+					if ( std::fabs( coarse_lu_[ std::size_t( row ) * n + col ] ) > std::fabs( coarse_lu_[ std::size_t( pivot ) * n + col ] ) )
+						pivot = row;
+				coarse_pivot_[ col ] = pivot;
+				if ( pivot != col )
+					for ( int k = 0; k < n; ++k )
+						std::swap( coarse_lu_[ std::size_t( pivot ) * n + k ], coarse_lu_[ std::size_t( col ) * n + k ] );
+				double& diag = coarse_lu_[ std::size_t( col ) * n + col ];
+				if ( std::fabs( diag ) <= 1e-14 * scale ) {
+					diag = 1.0;
+					for ( int row = col + 1; row < n; ++row )
+						coarse_lu_[ std::size_t( row ) * n + col ] = 0.0;
+					continue;
+				}
+				for ( int row = col + 1; row < n; ++row ) {
+					double& factor = coarse_lu_[ std::size_t( row ) * n + col ];
+					if ( factor == 0.0 )
+						continue;
+					factor /= diag;
+					for ( int k = col + 1; k < n; ++k )
+						coarse_lu_[ std::size_t( row ) * n + k ] -= factor * coarse_lu_[ std::size_t( col ) * n + k ];
+				}
+			}
+		}
+
+		void solveCoarsest( Level& level ) const
+		{
+			const int n = level.a.rows();
+			std::vector< double >& x = level.x;
+			std::copy( level.b.begin(), level.b.end(), x.begin() );
+			for ( int col = 0; col < n; ++col )
+				if ( coarse_pivot_[ col ] != col )
+					std::swap( x[ col ], x[ coarse_pivot_[ col ] ] );
+			for ( int row = 0; row < n; ++row )
+				for ( int k = 0; k < row; ++k )
+					x[ row ] -= coarse_lu_[ std::size_t( row ) * n + k ] * x[k];
+			for ( int row = n - 1; row >= 0; --row ) {
+				for ( int k = row + 1; k < n; ++k )
+					x[ row ] -= coarse_lu_[ std::size_t( row ) * n + k ] * x[k];
+				x[ row ] /= coarse_lu_[ std::size_t( row ) * n + row ];
+			}
+		}
+
+		const Parameters parameters_;
+		mutable std::vector< Level > levels_;
+		std::vector< double > coarse_lu_;
+		std::vector< int > coarse_pivot_;
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVERS_AMG_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
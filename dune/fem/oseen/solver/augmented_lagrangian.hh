@@ -0,0 +1,368 @@
+#ifndef DUNE_OSEEN_SOLVERS_AUGMENTED_LAGRANGIAN_HH
+#define DUNE_OSEEN_SOLVERS_AUGMENTED_LAGRANGIAN_HH
+
+#include <dune/fem/oseen/solver/monolithic.hh>
+#include <dune/fem/oseen/solver/block_smoother.hh>
+#include <dune/fem/oseen/solver/direct.hh>
+#include <dune/fem/oseen/assembler/compressed_rowstorage.hh>
+#include <dune/stuff/common/logging.hh>
+#include <dune/stuff/common/parameter/configcontainer.hh>
+#include <dune/common/exceptions.hh>
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <memory>
+
+namespace Dune {
+namespace Oseen {
+
+/** \brief SaddlepointSystem with the grad-div penalty \f$ \gamma B W B^T \f$ added to the velocity rows
+	\f$ K_\gamma = \begin{pmatrix} A_\gamma & B_\gamma \\ B^T & -C \end{pmatrix} \f$ with
+	\f$ A_\gamma = A - \gamma Z W E \f$, \f$ B_\gamma = Z - \gamma Z W R \f$ and the velocity right hand side
+	\f$ f + \gamma Z W H_3 \f$, i.e. \f$ \gamma B W \f$ times the pressure rows was added to the velocity rows,
+	which leaves the solution unchanged. W is the inverse of the (block diagonal) DG pressure mass matrix.
+  **/
+class AugmentedSaddlepointSystem
+{
+	public:
+		AugmentedSaddlepointSystem( const SaddlepointSystem& system, const CompressedRowStorage& mass_inverse,
+									const double gamma )
+			: system_( system ),
+			  gamma_( gamma ),
+			  w_( mass_inverse )
+		{
+			CompressedRowStorage a, zw, zwe, zwr;
+			system_.assembleA( a );
+			multiply( system_.matrixZ(), w_, zw );
+			multiply( zw, system_.matrixE(), zwe );
+			multiply( zw, system_.matrixR(), zwr );
+			add( 1.0, a, -gamma_, zwe, a_gamma_ );
+			add( 1.0, system_.matrixZ(), -gamma_, zwr, b_gamma_ );
+			w_h3_.resize( pressureSize() );
+		}
+
+		int velocitySize() const { return system_.velocitySize(); }
+		int pressureSize() const { return system_.pressureSize(); }
+		int size() const { return system_.size(); }
+
+		//! ret = K_gamma x
+		void apply( const double* x, double* ret ) const
+		{
+			const double* u = x;
+			const double* p = x + velocitySize();
+			double* ret_p = ret + velocitySize();
+			a_gamma_.mult( u, ret );
+			b_gamma_.multAdd( p, ret );
+			// B^T u - C p = -( E u + R p )
+			system_.matrixE().mult( u, ret_p );
+			system_.matrixR().multAdd( p, ret_p );
+			for ( int i = 0; i < pressureSize(); ++i )
+				ret_p[i] = -ret_p[i];
+		}
+
+		//! ret = B_gamma p
+		void applyB( const double* p, double* ret ) const { b_gamma_.mult( p, ret ); }
+
+		//! ret = factor * W r
+		void applyMassInverse( const double* r, double* ret, const double factor ) const
+		{
+			w_.mult( r, ret );
+			for ( int i = 0; i < pressureSize(); ++i )
+				ret[i] *= factor;
+		}
+
+		//! b = ( H2 - X M^{-1} H1 + gamma Z W H3, H3 )
+		void rightHandSide( const double* h1, const double* h2, const double* h3, double* b ) const
+		{
+			system_.rightHandSide( h1, h2, h3, b );
+			w_.mult( h3, &w_h3_[0] );
+			for ( int i = 0; i < pressureSize(); ++i )
+				w_h3_[i] *= gamma_;
+			system_.matrixZ().multAdd( &w_h3_[0], b );
+		}
+
+		const CompressedRowStorage& matrixA() const { return a_gamma_; }
+
+	private:
+		const SaddlepointSystem& system_;
+		const double gamma_;
+		const CompressedRowStorage w_;
+		CompressedRowStorage a_gamma_;
+		CompressedRowStorage b_gamma_;
+		mutable std::vector< double > w_h3_;
+};
+
+/** \brief block triangular preconditioner \f$ P = \begin{pmatrix} \hat A_\gamma & B_\gamma \\ 0 & -\hat S \end{pmatrix} \f$
+	for AugmentedSaddlepointSystem with \f$ \hat S^{-1} = ( \nu + \gamma ) M_p^{-1} \f$, which approximates the
+	Schur complement of the augmented system the better the larger gamma, independently of the viscosity
+	(Benzi, Olshanskii, SIAM J Sci Comput 28, 2095-2113 (2006)). The price is a harder velocity block:
+	\f$ \hat A_\gamma^{-1} \f$ is SparseDirectSolver if the factors fit into direct_max_memory (bytes),
+	otherwise at most inner_iterations steps of FGMRES preconditioned with symmetric block Gauss-Seidel on
+	velocity_block_size element blocks, reducing the residual by inner_reduction. The penalty couples the
+	velocity components only within an element's neighbourhood, so the element blocks stay the right ones.
+  **/
+class AugmentedLagrangianPreconditioner
+{
+	class A_Operator {
+		public:
+			A_Operator( const CompressedRowStorage& matrix ) : matrix_( matrix ) {}
+			void apply( const double* x, double* ret ) const { matrix_.mult( x, ret ); }
+		private:
+			const CompressedRowStorage& matrix_;
+	};
+
+	public:
+		AugmentedLagrangianPreconditioner( const AugmentedSaddlepointSystem& system,
+										   const double viscosity,
+										   const double gamma,
+										   const int velocity_block_size,
+										   const double direct_max_memory,
+										   const int inner_iterations,
+										   const double inner_reduction )
+			: system_( system ),
+			  schur_factor_( viscosity + gamma ),
+			  inner_iterations_( inner_iterations ),
+			  inner_reduction_( inner_reduction ),
+			  a_rhs_( system.velocitySize() ),
+			  a_sol_( system.velocitySize() ),
+			  applications_( 0 ),
+			  inner_total_( 0 ),
+			  inner_min_( std::numeric_limits< int >::max() ),
+			  inner_max_( 0 )
+		{
+			direct_.reset( new SparseDirectSolver( system_.matrixA(), direct_max_memory ) );
+			if ( direct_->factored() )
+				DSC_LOG_INFO << "augmented Lagrangian: velocity block factored, "
+							 << direct_->memoryEstimate() / ( 1024.0 * 1024.0 ) << " MB" << std::endl;
+			else {
+				DSC_LOG_INFO << "augmented Lagrangian: velocity block factors need an estimated "
+							 << direct_->memoryEstimate() / ( 1024.0 * 1024.0 )
+							 << " MB (al_direct_max_memory), using block Gauss-Seidel preconditioned FGMRES" << std::endl;
+				direct_.reset();
+				smoother_.reset( new SymmetricBlockGaussSeidel( system_.matrixA(), velocity_block_size ) );
+			}
+		}
+
+		//! z = P^{-1} r
+		void apply( const double* r, double* z ) const
+		{
+			++applications_;
+			const int nu = system_.velocitySize();
+			const double* r_u = r;
+			const double* r_p = r + nu;
+			double* z_u = z;
+			double* z_p = z + nu;
+			system_.applyMassInverse( r_p, z_p, -schur_factor_ );
+			system_.applyB( z_p, &a_rhs_[0] );
+			for ( int i = 0; i < nu; ++i )
+				a_rhs_[i] = r_u[i] - a_rhs_[i];
+			solveA( z_u );
+		}
+
+		void fill( SaddlepointInverseOperatorInfo& info ) const
+		{
+			if ( direct_ || applications_ == 0 )
+				return;
+			info.iterations_inner_avg = inner_total_ / double( applications_ );
+			info.iterations_inner_min = inner_min_;
+			info.iterations_inner_max = inner_max_;
+			info.max_inner_accuracy = inner_reduction_;
+		}
+
+	private:
+		//! dest = \hat A_gamma^{-1} a_rhs_
+		void solveA( double* dest ) const
+		{
+			if ( direct_ ) {
+				direct_->apply( &a_rhs_[0], dest );
+				return;
+			}
+			std::fill( a_sol_.begin(), a_sol_.end(), 0.0 );
+			const A_Operator a_op( system_.matrixA() );
+			const int iterations = Monolithic::fgmres( a_op, *smoother_, a_rhs_, a_sol_, inner_reduction_, 0.0,
+													   inner_iterations_, inner_iterations_, false );
+			std::copy( a_sol_.begin(), a_sol_.end(), dest );
+			inner_total_ += iterations;
+			inner_min_ = std::min( inner_min_, iterations );
+			inner_max_ = std::max( inner_max_, iterations );
+		}
+
+		const AugmentedSaddlepointSystem& system_;
+		const double schur_factor_;
+		const int inner_iterations_;
+		const double inner_reduction_;
+		std::unique_ptr< SparseDirectSolver > direct_;
+		std::unique_ptr< SymmetricBlockGaussSeidel > smoother_;
+		mutable std::vector< double > a_rhs_;
+		mutable std::vector< double > a_sol_;
+		mutable int applications_;
+		mutable int inner_total_;
+		mutable int inner_min_;
+		mutable int inner_max_;
+};
+
+/** \brief augmented Lagrangian solver for (low viscosity) Oseen systems
+	Solves AugmentedSaddlepointSystem with FGMRES and AugmentedLagrangianPreconditioner, so the outer iteration
+	counts stay low and nearly flat in the viscosity where the Schur complement BiCGStab of
+	BiCgStabSaddlepointInverseOperator stagnates. Needs the pressure mass matrix as assembled by the LDG method
+	(scaled by 1/viscosity) and the viscosity itself. "al_gamma" is the penalty (O(1) is the usual choice, larger
+	values make the outer iteration faster and the velocity block harder), "al_relLimit", "al_restart" control
+	the outer and "al_inner_iterations", "al_inner_reduction", "al_direct_max_memory" (MB) the inner solves.
+	The CSR copies are process local, so this is for serial runs only.
+  **/
+template < class OseenLDGMethodImp >
+class AugmentedLagrangianSaddlepointInverseOperator
+{
+	typedef OseenLDGMethodImp
+		OseenLDGMethodType;
+	typedef typename OseenLDGMethodType::DomainType
+		DomainType;
+	typedef typename OseenLDGMethodType::RangeType
+		RangeType;
+	typedef typename OseenLDGMethodType::Traits::DiscreteOseenFunctionWrapperType
+		DiscreteOseenFunctionWrapperType;
+	typedef typename DiscreteOseenFunctionWrapperType::DiscretePressureFunctionType
+		PressureDiscreteFunctionType;
+
+	public:
+		//! pressure_mass must not be null, it is M_p / viscosity
+		template < class PressureMassMatrixObjectType >
+		AugmentedLagrangianSaddlepointInverseOperator( const PressureMassMatrixObjectType* pressure_mass,
+													   const double viscosity )
+			: viscosity_( viscosity )
+		{
+			if ( pressure_mass == nullptr )
+				DUNE_THROW( InvalidStateException, "augmented Lagrangian solver needs the pressure mass matrix" );
+			pressure_mass_.assign( pressure_mass->matrix() );
+		}
+
+		template <  class X_MatrixType,
+					class M_invers_matrixType,
+					class Y_MatrixType,
+					class O_MatrixType,
+					class E_MatrixType,
+					class R_MatrixType,
+					class Z_MatrixType,
+					class W_MatrixType,
+					class DiscreteSigmaFunctionType,
+					class DiscreteVelocityFunctionType,
+					class DiscretePressureFunctionType  >
+		SaddlepointInverseOperatorInfo solve( const DomainType& /*arg*/,
+					RangeType& dest,
+					X_MatrixType& Xmatrix,
+					M_invers_matrixType& Mmatrix,
+					Y_MatrixType& Ymatrix,
+					O_MatrixType& Omatrix,
+					E_MatrixType& Ematrix,
+					R_MatrixType& Rmatrix,
+					Z_MatrixType& Zmatrix,
+					W_MatrixType& Wmatrix,
+					const DiscreteSigmaFunctionType& rhs1,
+					const DiscreteVelocityFunctionType& rhs2,
+					const DiscretePressureFunctionType& rhs3 ) const
+		{
+			auto& logInfo = DSC_LOG_INFO;
+			if ( dest.discretePressure().space().grid().comm().size() > 1 )
+				DUNE_THROW( InvalidStateException, "augmented Lagrangian solver only available in serial runs" );
+			const int solverVerbosity = DSC_CONFIG_GET( "solverVerbosity", 0 );
+			const int maxIter = DSC_CONFIG_GET( "maxIter", 500 );
+			const double relLimit = DSC_CONFIG_GET( "al_relLimit", 1e-8 );
+			// absLimit is compared to squared norms by the nested solvers
+			const double absLimit = std::sqrt( DSC_CONFIG_GET( "absLimit", 1e-8 ) );
+			const int restart = DSC_CONFIG_GET( "al_restart", 50 );
+			const double gamma = DSC_CONFIG_GET( "al_gamma", 1.0 );
+			const int inner_iterations = DSC_CONFIG_GET( "al_inner_iterations", 20 );
+			const double inner_reduction = DSC_CONFIG_GET( "al_inner_reduction", 1e-2 );
+			const double direct_max_memory = DSC_CONFIG_GET( "al_direct_max_memory", 512.0 ) * 1024.0 * 1024.0;
+			logInfo << "Begin AugmentedLagrangianSaddlepointInverseOperator (gamma " << gamma << ")" << std::endl;
+
+			// pressure_mass_ is M_p / viscosity, its block inverse times 1 / viscosity is M_p^{-1}
+			BlockDiagonalInverse mass_blocks;
+			mass_blocks.assign( pressure_mass_, dest.discretePressure().space().mapper().maxNumDofs() );
+			CompressedRowStorage mass_inverse;
+			mass_blocks.toMatrix( mass_inverse );
+			for ( int pos = 0; pos < mass_inverse.nonZeros(); ++pos )
+				mass_inverse.value( pos ) /= viscosity_;
+
+			const SaddlepointSystem system( Xmatrix, Mmatrix, Ymatrix, Omatrix, Ematrix, Rmatrix, Zmatrix, Wmatrix );
+			const AugmentedSaddlepointSystem augmented( system, mass_inverse, gamma );
+			const int nu = augmented.velocitySize();
+			const int np = augmented.pressureSize();
+			std::vector< double > b( nu + np );
+			augmented.rightHandSide( rhs1.leakPointer(), rhs2.leakPointer(), rhs3.leakPointer(), &b[0] );
+			std::vector< double > x( nu + np );
+			std::copy( dest.discreteVelocity().leakPointer(), dest.discreteVelocity().leakPointer() + nu, x.begin() );
+			std::copy( dest.discretePressure().leakPointer(), dest.discretePressure().leakPointer() + np, x.begin() + nu );
+
+			const AugmentedLagrangianPreconditioner preconditioner( augmented, viscosity_, gamma,
+																	dest.discreteVelocity().space().mapper().maxNumDofs(),
+																	direct_max_memory, inner_iterations, inner_reduction );
+			SaddlepointInverseOperatorInfo info;
+			info.iterations_outer_total = Monolithic::fgmres( augmented, preconditioner, b, x, relLimit, absLimit,
+															  maxIter, restart, solverVerbosity > 2 );
+			preconditioner.fill( info );
+
+			std::copy( x.begin(), x.begin() + nu, dest.discreteVelocity().leakPointer() );
+			std::copy( x.begin() + nu, x.end(), dest.discretePressure().leakPointer() );
+			removeMeanPressure( dest.discretePressure() );
+
+			if( solverVerbosity > 0 )
+				logInfo << "\n #avg inner iter | #outer iter: "
+						<< info.iterations_inner_avg << " | " << info.iterations_outer_total << std::endl;
+			logInfo << "End AugmentedLagrangianSaddlepointInverseOperator " << std::endl;
+			return info;
+		}
+
+	private:
+		//! same mean value correction as BiCgStabSaddlepointInverseOperator
+		void removeMeanPressure( PressureDiscreteFunctionType& pressure ) const
+		{
+			const double meanPressure_discrete = DSFe::meanValue( pressure, pressure.space() );
+			typedef typename OseenLDGMethodType::Traits::DiscreteModelType::Traits::PressureFunctionSpaceType
+					PressureFunctionSpaceType;
+			PressureFunctionSpaceType pressureFunctionSpace;
+			const DSFe::ConstantFunction<PressureFunctionSpaceType> vol(pressureFunctionSpace, meanPressure_discrete );
+			PressureDiscreteFunctionType tmp( "mean", pressure.space() );
+			DSFe::BetterL2Projection::project( 0.0, vol, tmp );
+			pressure -= tmp;
+		}
+
+		const double viscosity_;
+		CompressedRowStorage pressure_mass_;
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVERS_AUGMENTED_LAGRANGIAN_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
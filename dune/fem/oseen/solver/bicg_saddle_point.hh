@@ -2,17 +2,27 @@
 #define DUNE_OSEEN_SOLVERS_BICG_SADDLE_POINT_HH
 
 #include <dune/fem/oseen/solver/schurkomplement.hh>
+#include <dune/fem/oseen/solver/schur_preconditioner.hh>
+#include <dune/fem/oseen/solver/solver_registry.hh>
 #include <dune/stuff/fem/customprojection.hh>
 #include <dune/stuff/fem/functions/integrals.hh>
 #include <dune/stuff/fem/functions/analytical.hh>
 
+#include <memory>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
 namespace Dune {
 
 	/**
 		\brief Saddlepoint Solver
 		The inner CG iteration is implemented by passing a custom Matrix operator to a given\n
 		Dune solver. The outer iteration is a implementation of the BICGStab algorithm as described in\n
-		van der Vorst: "Iterative Methods for Large Linear Systems" (2000)
+		van der Vorst: "Iterative Methods for Large Linear Systems" (2000)\n
+		or, if constructed flexible, restarted FGMRES (StokesOEMSolver::fgmres). That one hands the outer residual to
+		the Schur complement operator in every step, so with do-bfg the inner tolerances are relaxed as the outer residual
+		drops, and it does not rely on the operator or the preconditioner staying the same between iterations.
 	**/
     template < class OseenLDGMethodImp >
 	class BiCgStabSaddlepointInverseOperator
@@ -38,6 +48,9 @@ namespace Dune {
 
 
 	  public:
+		explicit BiCgStabSaddlepointInverseOperator( const bool flexible = false )
+			: flexible_( flexible )
+		{}
 
 		/** takes raw matrices and right hand sides from pass as input, executes nested cg algorithm and outputs solution
 		*/
@@ -146,10 +159,63 @@ namespace Dune {
 			if ( solverVerbosity > 3 )
 				DSC::printFunctionMinMax( logDebug, schur_f );
 
-            Dune::NewBicgStab< PressureDiscreteFunctionType,Sk_Operator >
-					bicg( sk_op, relLimit, outer_absLimit, maxIter, solverVerbosity );
-			pressure.clear();
-			bicg.apply( schur_f, pressure );
+			/* outerPrecond_type: none, lsc (least squares commutator, see Oseen::LSCPreconditioner)
+			   or ilu / amg on the assembled Schur complement approximation (see Sk_Operator::preconditionMatrix) */
+			std::unique_ptr< Oseen::VectorPreconditionerInterface > schur_precond;
+			const Oseen::VectorPreconditionerInterface* schur_precond_ptr = 0;
+			const std::string precond_type = DSC_CONFIG_GET( "outerPrecond_type", std::string("none") );
+			if ( precond_type == "ilu" || precond_type == "amg" )
+				schur_precond_ptr = &sk_op.preconditionMatrix();
+			else if ( precond_type == "lsc" ) {
+				typedef typename A_InverseOperatorType::A_OperatorType
+					A_OperatorType;
+				VelocityDiscreteFunctionType diag_a( "diag_a", velocity.space() );
+				innerCGSolverWrapper.getOperator().getDiag( diag_a );
+				const std::vector< double > diag_a_dofs( diag_a.leakPointer(), diag_a.leakPointer() + velocity.space().size() );
+				schur_precond.reset( new Oseen::LSCPreconditioner< A_OperatorType >( innerCGSolverWrapper.getOperator(),
+																					diag_a_dofs, e_mat, z_mat,
+																					pressure.space().mapper().maxNumDofs() ) );
+				schur_precond_ptr = schur_precond.get();
+			}
+			else if ( precond_type != "none" )
+				DUNE_THROW( InvalidStateException, "unknown outerPrecond_type: " << precond_type );
+
+			// warm_start: the pressure passed in is the initial guess, e.g. the previous Picard iterate
+			if ( !DSC_CONFIG_GET( "warm_start", false ) )
+				pressure.clear();
+			int outer_iterations = -1;
+			if ( flexible_ ) {
+				// the OEM kernels stop relative to the right hand side
+				const double schur_f_norm = std::sqrt( schur_f.scalarProductDofs( schur_f ) );
+				if ( schur_f_norm > 0.0 ) {
+					const int restart = std::min( DSC_CONFIG_GET( "outer_restart", 30 ), pressure.space().size() );
+					StokesOEMSolver::GMRESWorkspace workspace;
+					const std::pair< int, double > result = schur_precond_ptr
+							? StokesOEMSolver::fgmres( pressure.space().grid().comm(), restart, pressure.space().size(),
+													   sk_op, *schur_precond_ptr, schur_f.leakPointer(), pressure.leakPointer(),
+													   outer_absLimit / schur_f_norm, maxIter, solverVerbosity > 3, workspace )
+							: StokesOEMSolver::gmres( pressure.space().grid().comm(), restart, pressure.space().size(),
+													  sk_op, schur_f.leakPointer(), pressure.leakPointer(),
+													  outer_absLimit / schur_f_norm, maxIter, solverVerbosity > 3, workspace );
+					outer_iterations = result.first;
+					logInfo << cg_name << ": FGMRES(" << restart << ") " << result.first << " iterations, residual "
+							<< result.second << std::endl;
+				}
+			}
+			// the OEM solver named by outer_solver (default OUTER_SOLVER from CMake), e.g. the pipelined PIPEBICGSTAB
+			else if ( DSC_CONFIG_GET( "outer_oem_solver", false ) ) {
+				if ( schur_precond_ptr )
+					DUNE_THROW( InvalidStateException, "outer_oem_solver does not support outerPrecond_type " << precond_type );
+				Oseen::RuntimeOEMSolver< PressureDiscreteFunctionType, Sk_Operator >
+						outer_solver( DSC_CONFIG_GET( "outer_solver", std::string( OUTER_SOLVER_NAME ) ),
+									  sk_op, relLimit, outer_absLimit, maxIter, solverVerbosity > 3 );
+				outer_solver.apply( schur_f, pressure );
+			}
+			else {
+				Dune::NewBicgStab< PressureDiscreteFunctionType,Sk_Operator >
+						bicg( sk_op, relLimit, outer_absLimit, maxIter, solverVerbosity, schur_precond_ptr );
+				bicg.apply( schur_f, pressure );
+			}
 			//pressure mw correction
             const double meanPressure_discrete = DSFe::meanValue( pressure, pressure.space() );
             typedef typename OseenLDGMethodType::Traits::DiscreteModelType::Traits::PressureFunctionSpaceType
@@ -163,15 +229,25 @@ namespace Dune {
 			v_tmp.assign(F);
 			z_mat.apply( pressure, tmp1 );
 			v_tmp-=tmp1; // F ^= rhs2 - B * p
+			// the bfg relaxation of the fgmres path leaves the last, loosened limit behind
+			innerCGSolverWrapper.setAbsoluteLimit( inner_absLimit );
 			innerCGSolverWrapper.apply(v_tmp,velocity);
 			logInfo << cg_name << ": End BICG SaddlePointInverseOperator " << std::endl;
 
 			SaddlepointInverseOperatorInfo info; //left blank in case of no bfg
+			info.iterations_outer_total = outer_iterations;
+			innerCGSolverWrapper.fillInfo( info );
+			if( solverVerbosity > 0 && info.inner_projected_solves > 0 )
+				logInfo << cg_name << ": inner projection: " << info.inner_projected_solves << " solves, residual reduction "
+						<< info.inner_projection_reduction_avg << ", ~" << info.iterations_inner_saved << " iterations saved" << std::endl;
 			// ***************************
 			return info;
 
 		} //end BiCgStabSaddlepointInverseOperator::solve
 
+	  private:
+		const bool flexible_;
+
 	  };//end class BiCgStabBiCgStabSaddlepointInverseOperator
 
 
@@ -0,0 +1,439 @@
+#ifndef DUNE_OSEEN_SOLVER_BLOCK_KRYLOV_HH
+#define DUNE_OSEEN_SOLVER_BLOCK_KRYLOV_HH
+
+#include <cmake_config.h>
+
+#include <dune/fem/oseen/solver/block_smoother.hh>
+#include <dune/stuff/common/logging.hh>
+
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+namespace Dune {
+namespace Oseen {
+
+/** \brief count vectors of equal length stored interleaved
+	entry i of vector k lives at data()[i * count + k], which is the layout CompressedRowStorage::multBlock expects.
+  **/
+class MultiVector
+{
+	public:
+		MultiVector( const int size, const int count )
+			: size_( size ),
+			count_( count ),
+			data_( size * count, 0.0 )
+		{}
+
+		int size() const { return size_; }
+		int count() const { return count_; }
+		double* data() { return &data_[0]; }
+		const double* data() const { return &data_[0]; }
+
+		double& operator()( const int i, const int k ) { return data_[ i * count_ + k ]; }
+		double operator()( const int i, const int k ) const { return data_[ i * count_ + k ]; }
+
+		void clear() { std::fill( data_.begin(), data_.end(), 0.0 ); }
+
+		void assign( const MultiVector& other )
+		{
+			assert( other.size_ == size_ && other.count_ == count_ );
+			data_ = other.data_;
+		}
+
+		void setColumn( const int k, const double* column )
+		{
+			for ( int i = 0; i < size_; ++i )
+				data_[ i * count_ + k ] = column[ i ];
+		}
+
+		void getColumn( const int k, double* column ) const
+		{
+			for ( int i = 0; i < size_; ++i )
+				column[ i ] = data_[ i * count_ + k ];
+		}
+
+		void clearColumn( const int k )
+		{
+			for ( int i = 0; i < size_; ++i )
+				data_[ i * count_ + k ] = 0.0;
+		}
+
+		//! columnwise scalar products, result[k] = <this_k, other_k>
+		void dots( const MultiVector& other, std::vector< double >& result ) const
+		{
+			assert( other.size_ == size_ && other.count_ == count_ );
+			result.assign( count_, 0.0 );
+			for ( int i = 0; i < size_; ++i )
+				for ( int k = 0; k < count_; ++k )
+					result[ k ] += data_[ i * count_ + k ] * other.data_[ i * count_ + k ];
+		}
+
+		//! this_k += factor[k] * other_k for all k with active[k]
+		void axpy( const std::vector< double >& factor, const MultiVector& other, const std::vector< bool >& active )
+		{
+			for ( int i = 0; i < size_; ++i )
+				for ( int k = 0; k < count_; ++k )
+					if ( active[ k ] )
+						data_[ i * count_ + k ] += factor[ k ] * other.data_[ i * count_ + k ];
+		}
+
+	private:
+		int size_;
+		int count_;
+		std::vector< double > data_;
+};
+
+//! per right hand side outcome of blockCG / lockstepBiCGStab
+struct BlockKrylovInfo
+{
+	//! iterations needed by each column
+	std::vector< int > iterations;
+	//! final squared residual norm of each column
+	std::vector< double > residuals;
+	//! number of (block) operator applications
+	int sweeps;
+
+	BlockKrylovInfo()
+		: sweeps( 0 )
+	{}
+
+	int maxIterations() const { return iterations.empty() ? 0 : *std::max_element( iterations.begin(), iterations.end() ); }
+	int minIterations() const { return iterations.empty() ? 0 : *std::min_element( iterations.begin(), iterations.end() ); }
+};
+
+namespace BlockKrylov {
+	inline bool anyActive( const std::vector< bool >& active )
+	{
+		return std::find( active.begin(), active.end(), true ) != active.end();
+	}
+
+	//! G = A^T B for the a columns of A and the b columns of B, G row major a x b
+	inline void gram( const MultiVector& a, const MultiVector& b, std::vector< double >& g )
+	{
+		assert( a.size() == b.size() );
+		const int ca = a.count();
+		const int cb = b.count();
+		g.assign( ca * cb, 0.0 );
+		for ( int i = 0; i < a.size(); ++i ) {
+			const double* ai = a.data() + i * ca;
+			const double* bi = b.data() + i * cb;
+			for ( int k = 0; k < ca; ++k )
+				for ( int l = 0; l < cb; ++l )
+					g[ k * cb + l ] += ai[ k ] * bi[ l ];
+		}
+	}
+
+	//! y_l += sum_k x_k c[k][l] for the columns l with active[l], c row major x.count() x y.count()
+	inline void multAdd( const MultiVector& x, const std::vector< double >& c, MultiVector& y, const std::vector< bool >& active )
+	{
+		assert( x.size() == y.size() );
+		const int cx = x.count();
+		const int cy = y.count();
+		for ( int i = 0; i < x.size(); ++i ) {
+			const double* xi = x.data() + i * cx;
+			double* yi = y.data() + i * cy;
+			for ( int l = 0; l < cy; ++l ) {
+				if ( !active[ l ] )
+					continue;
+				double sum = 0.0;
+				for ( int k = 0; k < cx; ++k )
+					sum += xi[ k ] * c[ k * cy + l ];
+				yi[ l ] += sum;
+			}
+		}
+	}
+
+	/** orthonormal basis of the columns of z (modified Gram-Schmidt, applied twice)
+		Columns that are (numerically) dependent on the previous ones are dropped, so the result may have fewer columns.
+	  **/
+	inline MultiVector orthonormalize( const MultiVector& z )
+	{
+		const int n = z.size();
+		std::vector< std::vector< double > > basis;
+		std::vector< double > column( n );
+		for ( int k = 0; k < z.count(); ++k ) {
+			z.getColumn( k, &column[0] );
+			double norm = 0.0;
+			for ( int i = 0; i < n; ++i )
+				norm += column[ i ] * column[ i ];
+			const double original = std::sqrt( norm );
+			if ( original == 0.0 )
+				continue;
+			for ( int pass = 0; pass < 2; ++pass ) {
+				for ( std::size_t b = 0; b < basis.size(); ++b ) {
+					double dot = 0.0;
+					for ( int i = 0; i < n; ++i )
+						dot += basis[ b ][ i ] * column[ i ];
+					for ( int i = 0; i < n; ++i )
+						column[ i ] -= dot * basis[ b ][ i ];
+				}
+			}
+			norm = 0.0;
+			for ( int i = 0; i < n; ++i )
+				norm += column[ i ] * column[ i ];
+			norm = std::sqrt( norm );
+			if ( norm <= 1e-10 * original )
+				continue;
+			for ( int i = 0; i < n; ++i )
+				column[ i ] /= norm;
+			basis.push_back( column );
+		}
+		MultiVector q( n, basis.size() );
+		for ( std::size_t b = 0; b < basis.size(); ++b )
+			q.setColumn( b, &basis[ b ][0] );
+		return q;
+	}
+
+	//! inverse of the small dense matrix g (size x size), false if singular
+	inline bool invert( std::vector< double > g, std::vector< double >& inverse, const int size )
+	{
+		inverse.assign( size * size, 0.0 );
+		for ( int k = 0; k < size; ++k )
+			inverse[ k * size + k ] = 1.0;
+		return size == 0 || BlockDiagonalInverse::invert( g, &inverse[0], size );
+	}
+}
+
+/** \brief block CG for count right hand sides sharing one symmetric positive definite operator
+	All columns search in one common Krylov space: the search block P spans the residuals of every unconverged column,
+	and every column takes its step from the whole block (O'Leary 1980). With s right hand sides this converges in
+	fewer iterations than s separate CGs, each iteration being one operator.multBlock() on the current block width.
+	P is re-orthonormalised every iteration and directions that became dependent are dropped, which is the
+	breakdown free variant (Ji and Li 2017); converged columns leave the block.
+	Convergence is tested per column on the squared residual norm, like the outer loop of SaddlepointInverseOperator.
+	OperatorType needs void multBlock( const double* x, double* ret, int count ) const on interleaved data.
+  **/
+template < class OperatorType >
+BlockKrylovInfo blockCG( const OperatorType& op,
+						 const MultiVector& rhs,
+						 MultiVector& x,
+						 const double absLimit,
+						 const int maxIter,
+						 const bool verbose = false )
+{
+	const int n = rhs.size();
+	const int count = rhs.count();
+	BlockKrylovInfo info;
+	info.iterations.assign( count, 0 );
+
+	MultiVector r( n, count );
+	op.multBlock( x.data(), r.data(), count );
+	++info.sweeps;
+	for ( int i = 0; i < n * count; ++i )
+		r.data()[ i ] = rhs.data()[ i ] - r.data()[ i ];
+	std::vector< double > delta;
+	r.dots( r, delta );
+	std::vector< bool > active( count );
+	for ( int k = 0; k < count; ++k )
+		active[ k ] = delta[ k ] > absLimit;
+
+	std::vector< double > pq, pq_inverse, pr, alpha, qz, beta;
+	MultiVector p = BlockKrylov::orthonormalize( r );
+	for ( int iteration = 1; iteration <= maxIter && BlockKrylov::anyActive( active ); ++iteration ) {
+		const int width = p.count();
+		if ( width == 0 )
+			break;
+		MultiVector q( n, width );
+		op.multBlock( p.data(), q.data(), width );
+		++info.sweeps;
+		BlockKrylov::gram( p, q, pq );
+		if ( !BlockKrylov::invert( pq, pq_inverse, width ) ) {
+			DSC_LOG_ERROR << "blockCG: P^T A P singular, operator not positive definite?" << std::endl;
+			break;
+		}
+		// alpha = ( P^T A P )^{-1} P^T R
+		BlockKrylov::gram( p, r, pr );
+		alpha.assign( width * count, 0.0 );
+		for ( int k = 0; k < width; ++k )
+			for ( int j = 0; j < width; ++j )
+				for ( int l = 0; l < count; ++l )
+					alpha[ k * count + l ] += pq_inverse[ k * width + j ] * pr[ j * count + l ];
+		BlockKrylov::multAdd( p, alpha, x, active );
+		for ( std::size_t k = 0; k < alpha.size(); ++k )
+			alpha[ k ] = -alpha[ k ];
+		BlockKrylov::multAdd( q, alpha, r, active );
+
+		r.dots( r, delta );
+		int still_active = 0;
+		for ( int k = 0; k < count; ++k ) {
+			if ( !active[ k ] )
+				continue;
+			++info.iterations[ k ];
+			active[ k ] = delta[ k ] > absLimit;
+			still_active += active[ k ];
+		}
+		if ( verbose )
+			DSC_LOG_INFO << "\t blockCG " << iteration << " block width " << width << " max residuum: "
+						 << *std::max_element( delta.begin(), delta.end() ) << std::endl;
+		if ( still_active == 0 )
+			break;
+
+		// P = orth( Z - P ( P^T A P )^{-1} Q^T Z ), Z the residuals of the active columns
+		MultiVector z( n, still_active );
+		std::vector< double > column( n );
+		for ( int k = 0, c = 0; k < count; ++k ) {
+			if ( !active[ k ] )
+				continue;
+			r.getColumn( k, &column[0] );
+			z.setColumn( c++, &column[0] );
+		}
+		BlockKrylov::gram( q, z, qz );
+		beta.assign( width * still_active, 0.0 );
+		for ( int k = 0; k < width; ++k )
+			for ( int j = 0; j < width; ++j )
+				for ( int l = 0; l < still_active; ++l )
+					beta[ k * still_active + l ] -= pq_inverse[ k * width + j ] * qz[ j * still_active + l ];
+		BlockKrylov::multAdd( p, beta, z, std::vector< bool >( still_active, true ) );
+		p = BlockKrylov::orthonormalize( z );
+	}
+	info.residuals = delta;
+	return info;
+}
+
+/** \brief BiCGStab for count right hand sides sharing one operator, run in lockstep
+	Unlike blockCG the columns do not share their Krylov spaces: each one keeps its own scalars and converges
+	exactly like a scalar BiCGStab. Only the operator traffic is shared, two operator.multBlock() per iteration
+	for all unconverged columns. Converged columns are frozen.
+  **/
+template < class OperatorType >
+BlockKrylovInfo lockstepBiCGStab( const OperatorType& op,
+							   const MultiVector& rhs,
+							   MultiVector& x,
+							   const double absLimit,
+							   const int maxIter,
+							   const bool verbose = false )
+{
+	const int n = rhs.size();
+	const int count = rhs.count();
+	BlockKrylovInfo info;
+	info.iterations.assign( count, 0 );
+
+	MultiVector r( n, count );
+	MultiVector r0( n, count );
+	MultiVector p( n, count );
+	MultiVector v( n, count );
+	MultiVector s( n, count );
+	MultiVector t( n, count );
+	std::vector< double > delta, rho, r0v, ts, tt, ss;
+	std::vector< double > last_rho( count, 1.0 ), alpha( count, 1.0 ), omega( count, 1.0 ), factor( count );
+	std::vector< bool > active( count, true );
+
+	op.multBlock( x.data(), v.data(), count );
+	++info.sweeps;
+	r.assign( rhs );
+	std::vector< double > minus_one( count, -1.0 );
+	r.axpy( minus_one, v, active );
+	r0.assign( r );
+	v.clear();
+	r.dots( r, delta );
+	for ( int k = 0; k < count; ++k )
+		active[ k ] = delta[ k ] > absLimit;
+
+	for ( int iteration = 1; iteration <= maxIter && BlockKrylov::anyActive( active ); ++iteration ) {
+		r0.dots( r, rho );
+		for ( int k = 0; k < count; ++k ) {
+			if ( !active[ k ] )
+				continue;
+			if ( rho[ k ] == 0.0 ) {
+				DSC_LOG_ERROR << "lockstepBiCGStab: breakdown in column " << k << std::endl;
+				active[ k ] = false;
+				p.clearColumn( k );
+				continue;
+			}
+			const double beta = ( rho[ k ] / last_rho[ k ] ) * ( alpha[ k ] / omega[ k ] );
+			for ( int i = 0; i < n; ++i )
+				p( i, k ) = r( i, k ) + beta * ( p( i, k ) - omega[ k ] * v( i, k ) );
+		}
+		op.multBlock( p.data(), v.data(), count );
+		++info.sweeps;
+		r0.dots( v, r0v );
+		s.assign( r );
+		for ( int k = 0; k < count; ++k ) {
+			alpha[ k ] = ( active[ k ] && r0v[ k ] != 0.0 ) ? rho[ k ] / r0v[ k ] : 0.0;
+			factor[ k ] = -alpha[ k ];
+		}
+		s.axpy( factor, v, active );
+		x.axpy( alpha, p, active );
+		s.dots( s, ss );
+		for ( int k = 0; k < count; ++k ) {
+			if ( active[ k ] && ss[ k ] <= absLimit ) {
+				// x already holds the half step
+				++info.iterations[ k ];
+				delta[ k ] = ss[ k ];
+				active[ k ] = false;
+				s.clearColumn( k );
+				p.clearColumn( k );
+			}
+		}
+		if ( !BlockKrylov::anyActive( active ) )
+			break;
+		op.multBlock( s.data(), t.data(), count );
+		++info.sweeps;
+		t.dots( s, ts );
+		t.dots( t, tt );
+		for ( int k = 0; k < count; ++k )
+			omega[ k ] = ( active[ k ] && tt[ k ] != 0.0 ) ? ts[ k ] / tt[ k ] : 0.0;
+		x.axpy( omega, s, active );
+		for ( int i = 0; i < n; ++i )
+			for ( int k = 0; k < count; ++k )
+				if ( active[ k ] )
+					r( i, k ) = s( i, k ) - omega[ k ] * t( i, k );
+		last_rho = rho;
+
+		std::vector< double > new_delta;
+		r.dots( r, new_delta );
+		for ( int k = 0; k < count; ++k ) {
+			if ( !active[ k ] )
+				continue;
+			++info.iterations[ k ];
+			delta[ k ] = new_delta[ k ];
+			if ( delta[ k ] <= absLimit || omega[ k ] == 0.0 ) {
+				if ( delta[ k ] > absLimit )
+					DSC_LOG_ERROR << "lockstepBiCGStab: breakdown in column " << k << std::endl;
+				active[ k ] = false;
+				p.clearColumn( k );
+			}
+		}
+		if ( verbose )
+			DSC_LOG_INFO << "\t lockstepBiCGStab " << iteration << " max residuum: "
+						 << *std::max_element( delta.begin(), delta.end() ) << std::endl;
+	}
+	info.residuals = delta;
+	return info;
+}
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVER_BLOCK_KRYLOV_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
@@ -0,0 +1,256 @@
+#ifndef DUNE_OSEEN_SOLVERS_BLOCK_SMOOTHER_HH
+#define DUNE_OSEEN_SOLVERS_BLOCK_SMOOTHER_HH
+
+#include <cmake_config.h>
+
+#include <dune/fem/oseen/assembler/compressed_rowstorage.hh>
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace Dune {
+namespace Oseen {
+
+/** \brief dense inverses of the diagonal blocks of a CSR matrix
+	Blocks are consecutive runs of block_size rows, for DG that is one element's velocity dofs.
+	Singular blocks fall back to the inverted point diagonal, a block size not dividing the row count to point blocks.
+  **/
+class BlockDiagonalInverse
+{
+	public:
+		BlockDiagonalInverse()
+			: block_size_( 1 )
+		{}
+
+		void assign( const CompressedRowStorage& matrix, const int block_size )
+		{
+			block_size_ = ( block_size > 0 && matrix.rows() % block_size == 0 ) ? block_size : 1;
+			const int bs = block_size_;
+			const int blocks = matrix.rows() / bs;
+			inverse_.assign( std::size_t( blocks ) * bs * bs, 0.0 );
+#if USE_OMP
+#pragma omp parallel for schedule(static)
+#endif
+			for ( int block = 0; block < blocks; ++block ) {
+				std::vector< double > lhs( bs * bs, 0.0 );
+				double* inv = &inverse_[ std::size_t( block ) * bs * bs ];
+				for ( int local = 0; local < bs; ++local ) {
+					const int row = block * bs + local;
+					for ( int pos = matrix.rowStart( row ); pos < matrix.rowEnd( row ); ++pos ) {
+						const int col = matrix.colIndex( pos ) - block * bs;
+						if ( col >= 0 && col < bs )
+							lhs[ local * bs + col ] += matrix.value( pos );
+					}
+					inv[ local * bs + local ] = 1.0;
+				}
+				if ( !invert( lhs, inv, bs ) ) {
+					for ( int k = 0; k < bs * bs; ++k )
+						inv[k] = 0.0;
+					for ( int local = 0; local < bs; ++local ) {
+						const double diag = lhs[ local * bs + local ];
+						inv[ local * bs + local ] = diag != 0.0 ? 1.0 / diag : 1.0;
+					}
+				}
+			}
+		}
+
+		//! ret = factor * D^{-1} x
+		void apply( const double* x, double* ret, const double factor = 1.0 ) const
+		{
+			const int bs = block_size_;
+			const int blocks = size() / bs;
+#if USE_OMP
+#pragma omp parallel for schedule(static)
+#endif
+			for ( int block = 0; block < blocks; ++block )
+				applyBlock( block, x + block * bs, ret + block * bs, factor );
+		}
+
+		//! ret += factor * D^{-1} x
+		void applyAdd( const double* x, double* ret, const double factor = 1.0 ) const
+		{
+			const int bs = block_size_;
+			const int blocks = size() / bs;
+#if USE_OMP
+#pragma omp parallel for schedule(static)
+#endif
+			for ( int block = 0; block < blocks; ++block ) {
+				const double* inv = &inverse_[ std::size_t( block ) * bs * bs ];
+				const double* in = x + block * bs;
+				double* out = ret + block * bs;
+				for ( int i = 0; i < bs; ++i ) {
+					double sum = 0.0;
+					for ( int j = 0; j < bs; ++j )
+						sum += inv[ i * bs + j ] * in[j];
+					out[i] += factor * sum;
+				}
+			}
+		}
+
+		//! out = factor * D_block^{-1} in, in and out hold the block_size entries of this block only
+		void applyBlock( const int block, const double* in, double* out, const double factor = 1.0 ) const
+		{
+			const int bs = block_size_;
+			const double* inv = &inverse_[ std::size_t( block ) * bs * bs ];
+			for ( int i = 0; i < bs; ++i ) {
+				double sum = 0.0;
+				for ( int j = 0; j < bs; ++j )
+					sum += inv[ i * bs + j ] * in[j];
+				out[i] = factor * sum;
+			}
+		}
+
+		//! the block inverses as a block diagonal CSR matrix
+		void toMatrix( CompressedRowStorage& matrix ) const
+		{
+			const int bs = block_size_;
+			const int n = size();
+			std::vector< int > row_start( n + 1 );
+			std::vector< int > col( std::size_t( n ) * bs );
+			std::vector< double > values( inverse_ );
+			for ( int row = 0; row < n; ++row ) {
+				row_start[ row + 1 ] = ( row + 1 ) * bs;
+				const int first = ( row / bs ) * bs;
+				for ( int k = 0; k < bs; ++k )
+					col[ std::size_t( row ) * bs + k ] = first + k;
+			}
+			row_start[0] = 0;
+			matrix.swapIn( n, n, row_start, col, values );
+		}
+
+		int blockSize() const { return block_size_; }
+		int size() const { return block_size_ == 0 ? 0 : int( inverse_.size() / block_size_ ); }
+
+		/** Gauss-Jordan with partial pivoting, lhs is destroyed, inv must come in as identity
+			\return false for (numerically) singular lhs
+		  **/
+		static bool invert( std::vector< double >& lhs, double* inv, const int n )
+		{
+			double scale = 0.0;
+			for ( int k = 0; k < n * n; ++k )
+				scale = std::max( scale, std::fabs( lhs[k] ) );
+			if ( scale == 0.0 )
+				return false;
+			for ( int col = 0; col < n; ++col ) {
+				int pivot = col;
+				for ( int row = col + 1; row < n; ++row )
+					if ( std::fabs( lhs[ row * n + col ] ) > std::fabs( lhs[ pivot * n + col ] ) )
+						pivot = row;
+				if ( std::fabs( lhs[ pivot * n + col ] ) < 1e-14 * scale )
+					return false;
+				if ( pivot != col ) {
+					for ( int k = 0; k < n; ++k ) {
+						std::swap( lhs[ pivot * n + k ], lhs[ col * n + k ] );
+						std::swap( inv[ pivot * n + k ], inv[ col * n + k ] );
+					}
+				}
+				const double diag = 1.0 / lhs[ col * n + col ];
+				for ( int k = 0; k < n; ++k ) {
+					lhs[ col * n + k ] *= diag;
+					inv[ col * n + k ] *= diag;
+				}
+				for ( int row = 0; row < n; ++row ) {
+					if ( row == col )
+						continue;
+					const double factor = lhs[ row * n + col ];
+					if ( factor == 0.0 )
+						continue;
+					for ( int k = 0; k < n; ++k ) {
+						lhs[ row * n + k ] -= factor * lhs[ col * n + k ];
+						inv[ row * n + k ] -= factor * inv[ col * n + k ];
+					}
+				}
+			}
+			return true;
+		}
+
+	private:
+		int block_size_;
+		std::vector< double > inverse_;
+};
+
+/** \brief one symmetric block Gauss-Seidel sweep (forward, then backward) from a zero initial guess
+	Uses the same element blocks as BlockDiagonalInverse; the sweeps are inherently sequential,
+	only the dense block solves vectorise. Symmetric for symmetric A.
+  **/
+class SymmetricBlockGaussSeidel
+{
+	public:
+		SymmetricBlockGaussSeidel( const CompressedRowStorage& matrix, const int block_size )
+			: matrix_( matrix )
+		{
+			diagonal_.assign( matrix_, block_size );
+			local_.resize( diagonal_.blockSize() );
+		}
+
+		//! x = ( D + U )^{-1} D ( D + L )^{-1} b
+		void apply( const double* b, double* x ) const
+		{
+			const int blocks = matrix_.rows() / diagonal_.blockSize();
+			std::fill( x, x + matrix_.rows(), 0.0 );
+			for ( int block = 0; block < blocks; ++block )
+				update( block, b, x );
+			for ( int block = blocks - 1; block >= 0; --block )
+				update( block, b, x );
+		}
+
+		int blockSize() const { return diagonal_.blockSize(); }
+
+	private:
+		//! x_block = D_block^{-1} ( b_block - \sum_{j \notin block} A_{block,j} x_j )
+		void update( const int block, const double* b, double* x ) const
+		{
+			const int bs = diagonal_.blockSize();
+			const int first = block * bs;
+			for ( int local = 0; local < bs; ++local ) {
+				const int row = first + local;
+				double sum = b[ row ];
+				for ( int pos = matrix_.rowStart( row ); pos < matrix_.rowEnd( row ); ++pos ) {
+					const int col = matrix_.colIndex( pos );
+					if ( col < first || col >= first + bs )
+						sum -= matrix_.value( pos ) * x[ col ];
+				}
+				local_[ local ] = sum;
+			}
+			diagonal_.applyBlock( block, &local_[0], x + first );
+		}
+
+		const CompressedRowStorage matrix_;
+		BlockDiagonalInverse diagonal_;
+		mutable std::vector< double > local_;
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVERS_BLOCK_SMOOTHER_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
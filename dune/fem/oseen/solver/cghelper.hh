@@ -8,7 +8,16 @@
 
 #include <cmake_config.h>
 #include <dune/fem/oseen/oemsolver/oemsolver.hh>
+#include <dune/fem/oseen/solver/solver_registry.hh>
 #include <dune/fem/oseen/solver/new_bicgstab.hh>
+#include <dune/fem/oseen/solver/amg.hh>
+#include <dune/fem/oseen/solver/block_smoother.hh>
+#include <dune/fem/oseen/solver/chebyshev.hh>
+#include <dune/fem/oseen/solver/solution_projection.hh>
+#include <dune/fem/oseen/solver/direct.hh>
+#include <dune/fem/oseen/solver/multigrid.hh>
+#include <dune/fem/oseen/solver/dg_transfer.hh>
+#include <dune/fem/oseen/assembler/compressed_rowstorage.hh>
 #include <dune/stuff/common/print.hh>
 #include <dune/stuff/common/misc.hh>
 #include <dune/stuff/common/matrix.hh>
@@ -16,6 +25,11 @@
 #include <dune/stuff/common/parameter/configcontainer.hh>
 #include <dune/stuff/fem/matrix_object.hh>
 #include <dune/stuff/fem/functions/transform.hh>
+#include <dune/common/exceptions.hh>
+
+#include <memory>
+#include <cmath>
+#include <string>
 
 namespace Dune {
 
@@ -52,14 +66,73 @@ class MatrixA_Operator : public StokesOEMSolver::PreconditionInterface
 	typedef DiscreteVelocityFunctionType ColDiscreteFunctionType;
 
     public:
+	/** innerPrecond_type selects what innerPrecond applies:
+		jacobi (inverted diagonal of A), block_jacobi (inverted element blocks of A),
+		block_sgs (symmetric block Gauss-Seidel), chebyshev (Oseen::ChebyshevIteration polynomial in block_jacobi),
+		amg (Oseen::AggregationAMG on the explicitly formed A)
+		gmg (Oseen::Multigrid over the grid's refinement hierarchy, serial only)
+		or pmg (Oseen::Multigrid over lower order velocity spaces, optionally continued over the grid hierarchy)
+	  **/
 	class PreconditionMatrix : public PreconditionMatrixBaseType {
 		const ThisType& a_operator_;
+		std::unique_ptr< Oseen::AggregationAMG > amg_;
+		std::unique_ptr< Oseen::BlockDiagonalInverse > block_jacobi_;
+		std::unique_ptr< Oseen::SymmetricBlockGaussSeidel > block_sgs_;
+		std::unique_ptr< Oseen::ChebyshevIteration > chebyshev_;
+		std::unique_ptr< Oseen::Multigrid > multigrid_;
 
 		public:
 			PreconditionMatrix( const ThisType& a_operator)
 				: PreconditionMatrixBaseType( a_operator.space_, a_operator.space_ ),
 				a_operator_( a_operator )
 			{
+				const std::string type = DSC_CONFIG_GET( "innerPrecond_type", std::string("jacobi") );
+				if ( type != "jacobi" && a_operator_.hasPreconditionMatrix() ) {
+					Oseen::CompressedRowStorage a_matrix;
+					a_operator_.assemble( a_matrix );
+					// one DG element's velocity dofs per block
+					const int block_size = a_operator_.space_.mapper().maxNumDofs();
+					if ( type == "amg" )
+						amg_.reset( new Oseen::AggregationAMG( a_matrix, Oseen::AggregationAMG::Parameters( block_size ) ) );
+					else if ( type == "block_jacobi" ) {
+						block_jacobi_.reset( new Oseen::BlockDiagonalInverse() );
+						block_jacobi_->assign( a_matrix, block_size );
+					}
+					else if ( type == "block_sgs" )
+						block_sgs_.reset( new Oseen::SymmetricBlockGaussSeidel( a_matrix, block_size ) );
+					else if ( type == "chebyshev" )
+						chebyshev_.reset( new Oseen::ChebyshevIteration( a_matrix, block_size ) );
+					else if ( type == "gmg" || type == "pmg" ) {
+						typedef typename DiscreteVelocityFunctionType::DiscreteFunctionSpaceType
+							VelocitySpaceType;
+						const int geometric_levels = type == "gmg"
+													 ? DSC_CONFIG_GET( "mg_max_levels", 10 ) - 1
+													 : DSC_CONFIG_GET( "pmg_geometric_levels", 0 );
+						if ( geometric_levels > 0 && a_operator_.space_.grid().comm().size() > 1 )
+							DUNE_THROW( InvalidStateException, "multigrid over the grid hierarchy is serial only" );
+						std::vector< Oseen::CompressedRowStorage > prolongations;
+						std::vector< int > block_sizes( 1, block_size );
+						if ( type == "gmg" )
+							Oseen::PolynomialHierarchy< VelocitySpaceType, -1 >::build( a_operator_.space_, 0, geometric_levels,
+																						prolongations, block_sizes );
+						else
+							Oseen::PolynomialHierarchy< VelocitySpaceType >::build( a_operator_.space_,
+																				   DSC_CONFIG_GET( "pmg_min_order", 1 ),
+																				   geometric_levels,
+																				   prolongations, block_sizes );
+						// e.g. pmg at pmg_min_order == velocity order without geometric levels: A would be its own coarsest level
+						if ( prolongations.empty() ) {
+							DSC_LOG_ERROR << "WARNING: innerPrecond_type " << type << " has no coarse level "
+										  << "(check pmg_min_order / pmg_geometric_levels / the grid hierarchy), using block_sgs" << std::endl;
+							block_sgs_.reset( new Oseen::SymmetricBlockGaussSeidel( a_matrix, block_size ) );
+						}
+						else
+							multigrid_.reset( new Oseen::Multigrid( a_matrix, prolongations, block_sizes ) );
+					}
+					else
+						DUNE_THROW( InvalidStateException, "unknown innerPrecond_type: " << type );
+					return;
+				}
 				DiscreteVelocityFunctionType precondition_diagonal( "diag1", a_operator_.space_ );
                 //!TODO
 				a_operator_.getDiag( precondition_diagonal );
@@ -82,10 +155,28 @@ class MatrixA_Operator : public StokesOEMSolver::PreconditionInterface
 			template <class VecType>
 			void precondition( const VecType* tmp, VecType* dest ) const
 			{
-				PreconditionMatrixBaseType::matrix().multOEM( tmp, dest );
+				if ( amg_ )
+					amg_->apply( tmp, dest );
+				else if ( block_jacobi_ )
+					block_jacobi_->apply( tmp, dest );
+				else if ( block_sgs_ )
+					block_sgs_->apply( tmp, dest );
+				else if ( chebyshev_ )
+					chebyshev_->apply( tmp, dest );
+				else if ( multigrid_ )
+					multigrid_->apply( tmp, dest );
+				else
+					PreconditionMatrixBaseType::matrix().multOEM( tmp, dest );
 			}
 
 			bool rightPrecondition() const { return false; }
+
+			~PreconditionMatrix()
+			{
+				if ( chebyshev_ && chebyshev_->steps() > 0 )
+					DSC_LOG_INFO << "innerPrecond chebyshev: " << chebyshev_->steps() << " steps at "
+								 << chebyshev_->bandwidth() << " GB/s" << std::endl;
+			}
 	};
 
         /** The operator needs the
@@ -164,6 +255,21 @@ class MatrixA_Operator : public StokesOEMSolver::PreconditionInterface
         o_mat_.matrix().addDiag( precondition_diagonal_ );
 	}
 
+	//! form Y + O - X M^{-1} W explicitly, for preconditioners that need matrix entries
+	void assemble( Oseen::CompressedRowStorage& a ) const
+	{
+		Oseen::CompressedRowStorage x, m, w, mw, xmw, y, o, yo;
+		x.assign( x_mat_.matrix() );
+		m.assign( m_mat_.matrix() );
+		w.assign( w_mat_.matrix() );
+		y.assign( y_mat_.matrix() );
+		o.assign( o_mat_.matrix() );
+		Oseen::multiply( m, w, mw );
+		Oseen::multiply( x, mw, xmw );
+		Oseen::add( 1.0, y, 1.0, o, yo );
+		Oseen::add( 1.0, yo, -1.0, xmw, a );
+	}
+
 	protected:
         const WMatType& w_mat_;
         const MMatType& m_mat_;
@@ -198,8 +304,12 @@ class A_InverseOperator {
 									DiscreteVelocityFunctionType>
                 A_OperatorType;
 
-        typedef DuneStokes::INNER_CG_SOLVERTYPE< DiscreteVelocityFunctionType, A_OperatorType >
+        //! inner_solver picks the OEM solver, default INNER_SOLVER from CMake; with CHEBYSHEV it is a CG that stays unused
+        typedef Oseen::RuntimeOEMSolver< DiscreteVelocityFunctionType, A_OperatorType >
             CG_SolverType;
+        //! inner_solver CHEBYSHEV, matrix free on A_OperatorType
+        typedef Oseen::BasicChebyshevIteration< Oseen::OEMChebyshevOperator< A_OperatorType > >
+            ChebyshevType;
         typedef typename CG_SolverType::ReturnValueType
             ReturnValueType;
 
@@ -220,24 +330,73 @@ class A_InverseOperator {
             sig_tmp1( "sig_tmp1", sig_space ),
             sig_tmp2( "sig_tmp2", sig_space ),
             a_op_( w_mat, m_mat, x_mat, y_mat, o_mat, sig_space, space ),
-            cg_solver( a_op_,   relLimit,
+            cg_solver( oemSolverName(),
+                       a_op_,   relLimit,
                                 absLimit,
                                 2000, //inconsequential anyways
-                                verbose )
-        {}
+                                verbose ),
+            projection_( space.size(), DSC_CONFIG_GET( "inner_projection_size", 0 ) ),
+            deflation_( projection_.enabled() && DSC_CONFIG_GET( "inner_deflation", false ) ),
+            abs_limit_( absLimit ),
+            spectrum_steps_( 0 ),
+            spectrum_min_( -1.0 ),
+            spectrum_max_( -1.0 ),
+            residual_( "inner_direct_residual", space ),
+            correction_( "inner_direct_correction", space )
+        {
+			if ( DSC_CONFIG_GET( "inner_direct", false ) )
+				factorize( space );
+			if ( !direct_ && DSC_CONFIG_GET( "inner_solver", std::string( INNER_SOLVER_NAME ) ) == "CHEBYSHEV" )
+				setupChebyshev( space );
+			if ( deflation_ && ( direct_ || chebyshev_ || oemSolverName() != "CG" ) ) {
+				DSC_LOG_INFO << "inner_deflation: replaces the inner CG only, ignored" << std::endl;
+				deflation_ = false;
+			}
+		}
+
+		~A_InverseOperator()
+		{
+			if ( chebyshev_ && chebyshev_->steps() > 0 )
+				DSC_LOG_INFO << "inner chebyshev: " << chebyshev_->steps() << " steps on [" << chebyshev_->lowerBound()
+							 << ", " << chebyshev_->upperBound() << "], " << chebyshev_->bytesMoved() * 1e-9 << " GB at "
+							 << chebyshev_->bandwidth() << " GB/s" << std::endl;
+		}
 
 		/** \brief this signature is called if the CG solver uses non-standard third arg to expose runtime info
 			\see SaddlepointInverseOperator (when compiled with BFG scheme support)
+			With inner_projection_size > 0 the start vector is improved from the previous solutions, see Oseen::SolutionProjection,
+			with inner_deflation as well the inner CG is replaced by SolutionProjection::deflatedCG once solutions are stored
 			**/
 		void apply ( const DiscreteVelocityFunctionType& arg, DiscreteVelocityFunctionType& dest, ReturnValueType& ret )
 		{
-			cg_solver.apply(arg,dest, ret);
+			if ( direct_ ) {
+				applyDirect( arg, dest, ret );
+				return;
+			}
+			if ( !projection_.enabled() ) {
+				applyIterative( arg, dest, ret );
+				return;
+			}
+			std::pair< double, double > residuals;
+			if ( deflation_ && projection_.vectors() > 0 ) {
+				const typename A_OperatorType::PreconditionMatrix* precond
+						= a_op_.hasPreconditionMatrix() ? &a_op_.preconditionMatrix() : 0;
+				ret = projection_.deflatedCG( a_op_, precond, arg.leakPointer(), dest.leakPointer(), abs_limit_,
+											  DSC_CONFIG_GET( "inner_deflation_max_iterations", 2000 ), residuals );
+			}
+			else {
+				residuals = projection_.initialGuess( a_op_, arg.leakPointer(), dest.leakPointer() );
+				applyIterative( arg, dest, ret );
+			}
+			projection_.record( residuals, ret.first, ret.second );
+			projection_.add( a_op_, dest.leakPointer() );
 		}
 
 		//! the standard function call
         void apply ( const DiscreteVelocityFunctionType& arg, DiscreteVelocityFunctionType& dest )
         {
-            cg_solver.apply(arg,dest);
+            ReturnValueType ret;
+            apply(arg,dest,ret);
         }
         //! the standard function call
 
@@ -246,12 +405,136 @@ class A_InverseOperator {
 			**/
         void setAbsoluteLimit( const double abs )
         {
+            abs_limit_ = abs;
             cg_solver.setAbsoluteLimit( abs );
         }
 
 		const A_OperatorType& getOperator() const { return a_op_;}
+		//! true if inner_direct is set and the factors fit into inner_direct_max_memory
+		bool isDirect() const { return bool( direct_ ); }
+		//! true if inner_solver is CHEBYSHEV and inner_direct is not in use
+		bool isChebyshev() const { return bool( chebyshev_ ); }
+		const Oseen::SolutionProjection& projection() const { return projection_; }
+
+		//! copies the projection statistics and the inner Lanczos estimates into a SaddlepointInverseOperatorInfo
+		template < class InfoType >
+		void fillInfo( InfoType& info ) const
+		{
+			if ( spectrum_steps_ > 0 ) {
+				info.inner_eigenvalue_min = spectrum_min_;
+				info.inner_eigenvalue_max = spectrum_max_;
+			}
+			else if ( chebyshev_ ) {
+				info.inner_eigenvalue_min = chebyshev_->lowerBound();
+				info.inner_eigenvalue_max = chebyshev_->upperBound();
+			}
+			if ( !projection_.enabled() )
+				return;
+			info.inner_projected_solves = projection_.projectedSolves();
+			info.inner_projection_reduction_avg = projection_.averageReduction();
+			info.iterations_inner_saved = projection_.iterationsSaved();
+		}
 
     private:
+		static std::string oemSolverName()
+		{
+			const std::string name = DSC_CONFIG_GET( "inner_solver", std::string( INNER_SOLVER_NAME ) );
+			return name == "CHEBYSHEV" ? std::string( "CG" ) : name;
+		}
+
+		void applyIterative( const DiscreteVelocityFunctionType& arg, DiscreteVelocityFunctionType& dest, ReturnValueType& ret )
+		{
+			if ( chebyshev_ ) {
+				// same stopping rule as the OEM solvers: |r| <= abs_limit * |arg|
+				ret = chebyshev_->solve( arg.leakPointer(), dest.leakPointer(), abs_limit_ * norm( arg ),
+										 DSC_CONFIG_GET( "chebyshev_max_iterations", 10000 ) );
+				return;
+			}
+			cg_solver.apply( arg, dest, ret );
+			recordSpectrum();
+		}
+
+		//! keeps the estimate of the longest inner CG run, the inner operator is the same for all of them
+		void recordSpectrum()
+		{
+			const Oseen::LanczosEstimate* spectrum = cg_solver.spectrum();
+			if ( !spectrum || spectrum->steps() <= spectrum_steps_ )
+				return;
+			spectrum_steps_ = spectrum->steps();
+			spectrum_min_ = spectrum->minEigenvalue();
+			spectrum_max_ = spectrum->maxEigenvalue();
+			Oseen::SpectralEstimates::instance().store( "inner", *spectrum );
+		}
+
+		/** A is constant for the whole outer iteration, so with inner_direct it is formed explicitly and factored
+			once (Oseen::SparseDirectSolver), every apply is a pair of triangular solves then.
+			Factors larger than inner_direct_max_memory (MB), as well as parallel runs, keep the iterative solver.
+		  **/
+		void factorize( const typename DiscreteVelocityFunctionType::DiscreteFunctionSpaceType& space )
+		{
+			auto& logInfo = DSC_LOG_INFO;
+			if ( space.grid().comm().size() > 1 ) {
+				logInfo << "inner_direct: only available in serial runs, using the iterative inner solver" << std::endl;
+				return;
+			}
+			const double max_memory = DSC_CONFIG_GET( "inner_direct_max_memory", 1024.0 ) * 1024.0 * 1024.0;
+			Oseen::CompressedRowStorage a_matrix;
+			a_op_.assemble( a_matrix );
+			direct_.reset( new Oseen::SparseDirectSolver( a_matrix, max_memory ) );
+			if ( !direct_->factored() ) {
+				logInfo << "inner_direct: factors need an estimated " << direct_->memoryEstimate() / ( 1024.0 * 1024.0 )
+						<< " MB (inner_direct_max_memory), using the iterative inner solver" << std::endl;
+				direct_.reset();
+				return;
+			}
+			logInfo << "inner_direct: factored A (" << a_matrix.rows() << " dofs, "
+					<< direct_->memoryEstimate() / ( 1024.0 * 1024.0 ) << " MB)" << std::endl;
+		}
+
+		/** inner_solver CHEBYSHEV runs the Chebyshev iteration on a_op_ itself: products by multOEM, the few inner products
+			(bound estimate, one residual check per predicted step count) by ddotOEM, so it is parallel the same way the CG is.
+			A is formed once only to invert its element blocks, the preconditioner is block Jacobi regardless of innerPrecond.
+		  **/
+		void setupChebyshev( const typename DiscreteVelocityFunctionType::DiscreteFunctionSpaceType& space )
+		{
+			Oseen::CompressedRowStorage a_matrix;
+			a_op_.assemble( a_matrix );
+			chebyshev_.reset( new ChebyshevType( Oseen::OEMChebyshevOperator< A_OperatorType >( a_op_, a_matrix ),
+												 a_matrix, space.mapper().maxNumDofs() ) );
+			DSC_LOG_INFO << "inner_solver CHEBYSHEV: spectrum of D^-1 A in [" << chebyshev_->lowerBound() << ", "
+					<< chebyshev_->upperBound() << "]" << std::endl;
+		}
+
+		/** triangular solves plus one step of iterative refinement if the residual misses the limit,
+			which is relative to |arg| like the OEM solvers' one
+		  **/
+		void applyDirect( const DiscreteVelocityFunctionType& arg, DiscreteVelocityFunctionType& dest, ReturnValueType& ret )
+		{
+			direct_->apply( arg.leakPointer(), dest.leakPointer() );
+			ret.first = 0;
+			ret.second = residualNorm( arg, dest );
+			if ( ret.second > abs_limit_ * norm( arg ) ) {
+				direct_->apply( residual_.leakPointer(), correction_.leakPointer() );
+				dest += correction_;
+				ret.first = 1;
+				ret.second = residualNorm( arg, dest );
+			}
+		}
+
+		double norm( const DiscreteVelocityFunctionType& arg ) const
+		{
+			return std::sqrt( a_op_.ddotOEM( arg.leakPointer(), arg.leakPointer() ) );
+		}
+
+		//! residual_ = arg - A dest, returns its norm
+		double residualNorm( const DiscreteVelocityFunctionType& arg, const DiscreteVelocityFunctionType& dest )
+		{
+			a_op_.multOEM( dest.leakPointer(), residual_.leakPointer() );
+			residual_ *= -1;
+			residual_ += arg;
+			return std::sqrt( a_op_.ddotOEM( residual_.leakPointer(), residual_.leakPointer() ) );
+		}
+
 //        const MMatType precond_;
         const WMatType& w_mat_;
         const MMatType& m_mat_;
@@ -261,6 +544,16 @@ class A_InverseOperator {
         mutable DiscreteSigmaFunctionType sig_tmp2;
         A_OperatorType a_op_;
         CG_SolverType cg_solver;
+        Oseen::SolutionProjection projection_;
+        bool deflation_;
+        double abs_limit_;
+        int spectrum_steps_;
+        double spectrum_min_;
+        double spectrum_max_;
+        std::unique_ptr< Oseen::SparseDirectSolver > direct_;
+        std::unique_ptr< ChebyshevType > chebyshev_;
+        DiscreteVelocityFunctionType residual_;
+        DiscreteVelocityFunctionType correction_;
 };
 
 }
@@ -0,0 +1,344 @@
+#ifndef DUNE_OSEEN_SOLVERS_CHEBYSHEV_HH
+#define DUNE_OSEEN_SOLVERS_CHEBYSHEV_HH
+
+#include <cmake_config.h>
+
+#include <dune/fem/oseen/assembler/compressed_rowstorage.hh>
+#include <dune/fem/oseen/solver/block_smoother.hh>
+#include <dune/fem/oseen/solver/lanczos.hh>
+#include <dune/stuff/common/parameter/configcontainer.hh>
+#include <dune/common/exceptions.hh>
+
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <utility>
+#include <algorithm>
+
+namespace Dune {
+namespace Oseen {
+
+struct ChebyshevParameters {
+	int degree;
+	int estimate_steps;
+	double eigenvalue_ratio;
+	double safety;
+
+	ChebyshevParameters()
+		: degree( DSC_CONFIG_GET( "chebyshev_degree", 3 ) ),
+		estimate_steps( DSC_CONFIG_GET( "chebyshev_estimate_steps", 20 ) ),
+		eigenvalue_ratio( DSC_CONFIG_GET( "chebyshev_eigenvalue_ratio", 30.0 ) ),
+		safety( DSC_CONFIG_GET( "chebyshev_safety", 1.1 ) )
+	{
+		if ( degree < 1 || estimate_steps < 1 || !( eigenvalue_ratio > 1.0 ) || !( safety >= 1.0 ) )
+			DUNE_THROW( InvalidStateException, "chebyshev: needs degree, estimate_steps >= 1, eigenvalue_ratio > 1 and safety >= 1" );
+	}
+};
+
+//! bytes one product with the CSR matrix reads and writes
+inline double csrProductBytes( const CompressedRowStorage& matrix )
+{
+	const double n = matrix.rows();
+	return double( matrix.nonZeros() ) * ( sizeof(double) + sizeof(int) ) + ( n + 1 ) * sizeof(int) + 2.0 * n * sizeof(double);
+}
+
+//! products with a (copied) CSR matrix and threaded local scalar products, the serial variant
+class CSRChebyshevOperator
+{
+	public:
+		explicit CSRChebyshevOperator( const CompressedRowStorage& matrix )
+			: matrix_( matrix )
+		{}
+
+		int size() const { return matrix_.rows(); }
+
+		void mult( const double* x, double* y ) const { matrix_.mult( x, y ); }
+
+		double dot( const double* a, const double* b ) const
+		{
+			const int n = matrix_.rows();
+			double sum = 0.0;
+#if USE_OMP
+#pragma omp parallel for schedule(static) reduction(+:sum)
+#endif
+			for ( int i = 0; i < n; ++i )
+				sum += a[i] * b[i];
+			return sum;
+		}
+
+		double productBytes() const { return csrProductBytes( matrix_ ); }
+
+	private:
+		const CompressedRowStorage matrix_;
+};
+
+/** products and scalar products through an OEM operator's multOEM and ddotOEM (e.g. MatrixA_Operator), so the iteration
+	is parallel the same way the OEM solvers on that operator are. The operator is referenced, not copied.
+	The explicitly formed operator only provides the size and the byte count of a product, which for a matrix free
+	operator is a lower bound of what it really moves.
+  **/
+template < class OperatorImp >
+class OEMChebyshevOperator
+{
+	public:
+		OEMChebyshevOperator( const OperatorImp& op, const CompressedRowStorage& assembled )
+			: op_( op ),
+			size_( assembled.rows() ),
+			product_bytes_( csrProductBytes( assembled ) )
+		{}
+
+		int size() const { return size_; }
+
+		void mult( const double* x, double* y ) const { op_.multOEM( x, y ); }
+
+		double dot( const double* a, const double* b ) const { return op_.ddotOEM( a, b ); }
+
+		double productBytes() const { return product_bytes_; }
+
+	private:
+		const OperatorImp& op_;
+		const int size_;
+		const double product_bytes_;
+};
+
+/** \brief Chebyshev iteration for the operator ChebyshevOperatorImp (CSRChebyshevOperator, OEMChebyshevOperator),
+	preconditioned with the inverted element blocks D of the explicitly formed operator
+	The spectrum bounds of D^{-1} A come from estimate_steps block Jacobi CG steps on a fixed start vector (LanczosEstimate),
+	widened by the factor safety. After that the three term recurrence needs no inner products: every step is one
+	matrix product and one threaded sweep fusing the block solve with all vector updates. Meant for the (nearly) symmetric
+	positive definite velocity operator; for strongly convective A use block_sgs.
+	apply() is the smoother, a fixed polynomial of degree steps damping [upper / eigenvalue_ratio, upper] and thus symmetric
+	for symmetric A. solve() iterates on the estimated extremes and computes the residual norm only once the step count
+	predicted from the bounds is done; a slower decay than predicted lowers the lower bound for this and later solves.
+	All scalar products go through the operator's dot(), so they are global exactly if the operator's are.
+	steps(), bytesMoved(), seconds() and bandwidth() describe the reduction free sweeps, bytes are counted from the
+	operator's productBytes() and the vector sizes.
+  **/
+template < class ChebyshevOperatorImp >
+class BasicChebyshevIteration
+{
+	public:
+		typedef ChebyshevParameters
+			Parameters;
+
+		//! blocks is the explicitly formed operator, only its diagonal blocks of size block_size are kept
+		BasicChebyshevIteration( const ChebyshevOperatorImp& op, const CompressedRowStorage& blocks, const int block_size,
+								 const Parameters& parameters = Parameters() )
+			: op_( op ),
+			parameters_( parameters ),
+			steps_( 0 ),
+			bytes_( 0.0 ),
+			seconds_( 0.0 )
+		{
+			diagonal_.assign( blocks, block_size );
+			const int n = op_.size();
+			r_.assign( n, 0.0 );
+			z_.assign( n, 0.0 );
+			d_.assign( n, 0.0 );
+			ad_.assign( n, 0.0 );
+			estimate();
+		}
+
+		//! z = p( D^{-1} A ) D^{-1} r, degree steps from a zero initial guess
+		void apply( const double* r, double* z ) const
+		{
+			std::copy( r, r + op_.size(), r_.begin() );
+			std::fill( z, z + op_.size(), 0.0 );
+			iterate( z, parameters_.degree, upper_ / parameters_.eigenvalue_ratio, upper_ );
+		}
+
+		/** improves x until | b - A x | <= abs_limit or max_iter steps are done
+			\return steps and final residual norm
+		  **/
+		std::pair< int, double > solve( const double* b, double* x, const double abs_limit, const int max_iter ) const
+		{
+			double norm = residual( b, x );
+			int iterations = 0;
+			while ( norm > abs_limit && iterations < max_iter ) {
+				const double root = std::sqrt( upper_ / lower_ );
+				const double sigma = ( root - 1.0 ) / ( root + 1.0 );
+				// the error after k steps is bounded by 2 sigma^k times the initial one
+				const double predicted = std::ceil( std::log( 2.0 * norm / abs_limit ) / -std::log( sigma ) );
+				const int steps = std::max( 1, int( std::min( predicted, double( max_iter - iterations ) ) ) );
+				iterate( x, steps, lower_, upper_ );
+				iterations += steps;
+				const double previous = norm;
+				norm = residual( b, x );
+				if ( !std::isfinite( norm ) )
+					DUNE_THROW( InvalidStateException, "chebyshev: diverged, raise chebyshev_safety or chebyshev_estimate_steps" );
+				if ( norm > previous )
+					upper_ *= parameters_.safety * parameters_.safety;
+				else if ( norm > std::sqrt( 2.0 * std::pow( sigma, steps ) ) * previous )
+					lower_ *= 0.25;
+			}
+			return std::make_pair( iterations, norm );
+		}
+
+		double lowerBound() const { return lower_; }
+		double upperBound() const { return upper_; }
+
+		//! reduction free steps done so far, by apply() and solve()
+		long steps() const { return steps_; }
+		double bytesMoved() const { return bytes_; }
+		double seconds() const { return seconds_; }
+
+		//! GB/s over all reduction free steps, -1 before the first
+		double bandwidth() const
+		{
+			return seconds_ > 0.0 ? bytes_ / seconds_ * 1e-9 : -1.0;
+		}
+
+	private:
+		//! r_ = b - A x, returns | r_ |
+		double residual( const double* b, const double* x ) const
+		{
+			const int n = op_.size();
+			op_.mult( x, &ad_[0] );
+#if USE_OMP
+#pragma omp parallel for schedule(static)
+#endif
+			for ( int i = 0; i < n; ++i )
+				r_[i] = b[i] - ad_[i];
+			return std::sqrt( op_.dot( &r_[0], &r_[0] ) );
+		}
+
+		/** steps of the Chebyshev recurrence on [lower, upper] (Saad, Iterative Methods for Sparse Linear Systems, Alg. 12.1),
+			r_ holds b - A x on entry and is not updated by the last step
+		  **/
+		void iterate( double* x, const int steps, const double lower, const double upper ) const
+		{
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			const int n = op_.size();
+			const int bs = diagonal_.blockSize();
+			const int blocks = n / bs;
+			const double theta = 0.5 * ( upper + lower );
+			const double delta = 0.5 * ( upper - lower );
+			const double sigma = theta / delta;
+			double rho = 1.0 / sigma;
+			diagonal_.apply( &r_[0], &d_[0], 1.0 / theta );
+			for ( int step = 0; step + 1 < steps; ++step ) {
+				op_.mult( &d_[0], &ad_[0] );
+				const double rho_next = 1.0 / ( 2.0 * sigma - rho );
+				const double old_factor = rho_next * rho;
+				const double new_factor = 2.0 * rho_next / delta;
+#if USE_OMP
+#pragma omp parallel for schedule(static)
+#endif
+				for ( int block = 0; block < blocks; ++block ) {
+					const int first = block * bs;
+					for ( int i = first; i < first + bs; ++i ) {
+						x[i] += d_[i];
+						r_[i] -= ad_[i];
+					}
+					diagonal_.applyBlock( block, &r_[ first ], &z_[ first ], new_factor );
+					for ( int i = first; i < first + bs; ++i )
+						d_[i] = old_factor * d_[i] + z_[i];
+				}
+				rho = rho_next;
+			}
+#if USE_OMP
+#pragma omp parallel for schedule(static)
+#endif
+			for ( int i = 0; i < n; ++i )
+				x[i] += d_[i];
+			seconds_ += std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+			steps_ += steps;
+			const double vector_bytes = double( n ) * sizeof(double);
+			// x, r and d read and written, A d read, the inverted block row read
+			const double sweep_bytes = 7.0 * vector_bytes + double( n ) * bs * sizeof(double);
+			bytes_ += ( steps - 1 ) * ( op_.productBytes() + sweep_bytes ) + double( n ) * bs * sizeof(double) + 5.0 * vector_bytes;
+		}
+
+		//! block Jacobi preconditioned CG on A y = f, f fixed and rich in all eigenvectors, fed to a LanczosEstimate
+		void estimate()
+		{
+			const int n = op_.size();
+			std::vector< double > p( n );
+			for ( int i = 0; i < n; ++i )
+				r_[i] = 1.0 + 0.5 * std::sin( 1.0 + i );
+			diagonal_.apply( &r_[0], &z_[0] );
+			std::copy( z_.begin(), z_.end(), p.begin() );
+			double rz = op_.dot( &r_[0], &z_[0] );
+			const double rz_start = rz;
+			LanczosEstimate spectrum;
+			for ( int step = 0; step < parameters_.estimate_steps && rz > 1e-28 * rz_start; ++step ) {
+				op_.mult( &p[0], &ad_[0] );
+				const double alpha = rz / op_.dot( &p[0], &ad_[0] );
+				for ( int i = 0; i < n; ++i )
+					r_[i] -= alpha * ad_[i];
+				diagonal_.apply( &r_[0], &z_[0] );
+				const double rz_next = op_.dot( &r_[0], &z_[0] );
+				const double beta = rz_next / rz;
+				spectrum.add( alpha, beta );
+				for ( int i = 0; i < n; ++i )
+					p[i] = z_[i] + beta * p[i];
+				rz = rz_next;
+			}
+			if ( spectrum.steps() == 0 || !( spectrum.minEigenvalue() > 0.0 ) )
+				DUNE_THROW( InvalidStateException, "chebyshev: D^{-1} A does not look positive definite" );
+			upper_ = parameters_.safety * spectrum.maxEigenvalue();
+			lower_ = std::min( spectrum.minEigenvalue() / parameters_.safety, 0.5 * upper_ );
+		}
+
+		const ChebyshevOperatorImp op_;
+		const Parameters parameters_;
+		BlockDiagonalInverse diagonal_;
+		mutable double lower_;
+		mutable double upper_;
+		mutable long steps_;
+		mutable double bytes_;
+		mutable double seconds_;
+		mutable std::vector< double > r_;
+		mutable std::vector< double > z_;
+		mutable std::vector< double > d_;
+		mutable std::vector< double > ad_;
+};
+
+/** \brief the serial variant on a CSR matrix, with local scalar products
+	Meant as smoother and preconditioner (apply(), multigrid and innerPrecond_type chebyshev), where the only scalar
+	products are the ones of the bound estimate. The parallel inner solver is BasicChebyshevIteration on OEMChebyshevOperator.
+  **/
+class ChebyshevIteration : public BasicChebyshevIteration< CSRChebyshevOperator >
+{
+	typedef BasicChebyshevIteration< CSRChebyshevOperator >
+		BaseType;
+
+	public:
+		ChebyshevIteration( const CompressedRowStorage& matrix, const int block_size, const Parameters& parameters = Parameters() )
+			: BaseType( CSRChebyshevOperator( matrix ), matrix, block_size, parameters )
+		{}
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVERS_CHEBYSHEV_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
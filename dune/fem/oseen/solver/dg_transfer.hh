@@ -0,0 +1,326 @@
+#ifndef DUNE_OSEEN_SOLVERS_DG_TRANSFER_HH
+#define DUNE_OSEEN_SOLVERS_DG_TRANSFER_HH
+
+#include <dune/fem/oseen/assembler/compressed_rowstorage.hh>
+#include <dune/fem/oseen/solver/block_smoother.hh>
+#include <dune/fem/quadrature/elementquadrature.hh>
+#include <dune/common/exceptions.hh>
+
+#include <vector>
+#include <map>
+#include <cmath>
+#include <algorithm>
+
+namespace Dune {
+namespace Oseen {
+
+/** \brief prolongations between nested DG spaces, for Multigrid
+	Does algebraically what the DG RestrictProlongDefault does during adaptation: a coarse function is represented
+	exactly in the finer space (the spaces are nested), element by element
+	\f$ P_e = M_e^{-1} \int_e \varphi^e_i \, \psi_j( x_c ) \f$, with psi the coarse basis and x_c the quadrature point
+	in the coarse element's coordinates.
+	buildGeometric coarsens along the grid hierarchy (x_c from geometryInFather()). Each step replaces only the
+	elements on the current finest level by their fathers and carries the others over unchanged; all children of such
+	a father are in the current set then, so every coarse level is again a partition and the spaces stay nested on
+	locally refined grids too. Its coarse levels number their dofs element by element, element k owning
+	k * numDofs ... (k + 1) * numDofs - 1.
+	buildPolynomial coarsens to a lower order space on the same grid; for the hierarchical (orthonormal) DG bases this
+	is just the injection of the leading basis functions, computed generally anyway.
+  **/
+template < class DiscreteFunctionSpaceImp >
+class DGTransfer
+{
+	typedef DiscreteFunctionSpaceImp
+		DiscreteFunctionSpaceType;
+	typedef typename DiscreteFunctionSpaceType::GridPartType
+		GridPartType;
+	typedef typename GridPartType::GridType
+		GridType;
+	typedef typename DiscreteFunctionSpaceType::IteratorType
+		IteratorType;
+	typedef typename GridType::template Codim< 0 >::Entity
+		EntityType;
+	typedef typename GridType::template Codim< 0 >::EntityPointer
+		EntityPointerType;
+	typedef typename GridType::Traits::LocalIdSet::IdType
+		IdType;
+	typedef typename DiscreteFunctionSpaceType::RangeType
+		RangeType;
+	typedef Dune::ElementQuadrature< GridPartType, 0 >
+		QuadratureType;
+
+	public:
+		/** fills prolongations (finest first) and the element block size of every level
+			\param max_levels number of levels including the finest, stops earlier once all elements are macro elements,
+			on locally refined grids the first levels only coarsen the finest refinement zones
+			\return the number of levels
+		  **/
+		static int buildGeometric( const DiscreteFunctionSpaceType& space, const int max_levels,
+								   std::vector< CompressedRowStorage >& prolongations, std::vector< int >& block_sizes )
+		{
+			const int num_dofs = space.mapper().maxNumDofs();
+			prolongations.clear();
+			block_sizes.assign( 1, num_dofs );
+
+			std::vector< EntityPointerType > elements;
+			std::vector< int > dofs;
+			const IteratorType end = space.end();
+			for ( IteratorType it = space.begin(); it != end; ++it ) {
+				if ( space.baseFunctionSet( *it ).numBaseFunctions() != num_dofs )
+					DUNE_THROW( InvalidStateException, "DGTransfer: needs the same number of dofs on every element" );
+				elements.push_back( EntityPointerType( it ) );
+				for ( int i = 0; i < num_dofs; ++i )
+					dofs.push_back( space.mapToGlobal( *it, i ) );
+			}
+
+			const typename GridType::Traits::LocalIdSet& id_set = space.gridPart().grid().localIdSet();
+			std::vector< double > identity( num_dofs * num_dofs, 0.0 );
+			for ( int i = 0; i < num_dofs; ++i )
+				identity[ i * num_dofs + i ] = 1.0;
+			while ( int( block_sizes.size() ) < max_levels ) {
+				int finest_level = 0;
+				for ( std::size_t k = 0; k < elements.size(); ++k )
+					finest_level = std::max( finest_level, elements[k]->level() );
+				if ( finest_level == 0 )
+					break;
+				std::map< IdType, int > coarse_index;
+				std::vector< EntityPointerType > coarse;
+				std::vector< int > parent( elements.size() );
+				for ( std::size_t k = 0; k < elements.size(); ++k ) {
+					const EntityPointerType father = elements[k]->level() == finest_level ? elements[k]->father() : elements[k];
+					const IdType id = id_set.id( *father );
+					typename std::map< IdType, int >::const_iterator found = coarse_index.find( id );
+					if ( found == coarse_index.end() ) {
+						found = coarse_index.insert( std::make_pair( id, int( coarse.size() ) ) ).first;
+						coarse.push_back( father );
+					}
+					parent[k] = found->second;
+				}
+				if ( coarse.size() == elements.size() )
+					break;
+
+				const int rows = elements.size() * num_dofs;
+				std::vector< int > row_start( rows + 1, 0 );
+				std::vector< int > col( std::size_t( rows ) * num_dofs );
+				std::vector< double > values( std::size_t( rows ) * num_dofs );
+				std::vector< double > local( num_dofs * num_dofs );
+				for ( std::size_t k = 0; k < elements.size(); ++k ) {
+					const EntityType& child = *elements[k];
+					if ( child.level() < finest_level )
+						local = identity;
+					else {
+						const typename EntityType::LocalGeometry in_father = child.geometryInFather();
+						localProjection( space, child, space.baseFunctionSet( *coarse[ parent[k] ] ), num_dofs,
+										 &in_father, 2 * space.order(), local );
+					}
+					for ( int i = 0; i < num_dofs; ++i ) {
+						const std::size_t row = dofs[ k * num_dofs + i ];
+						for ( int j = 0; j < num_dofs; ++j ) {
+							col[ row * num_dofs + j ] = parent[k] * num_dofs + j;
+							values[ row * num_dofs + j ] = local[ i * num_dofs + j ];
+						}
+					}
+				}
+				for ( int row = 0; row < rows; ++row )
+					row_start[ row + 1 ] = ( row + 1 ) * num_dofs;
+				prolongations.push_back( CompressedRowStorage() );
+				prolongations.back().swapIn( rows, coarse.size() * num_dofs, row_start, col, values );
+				block_sizes.push_back( num_dofs );
+
+				elements.swap( coarse );
+				dofs.resize( elements.size() * num_dofs );
+				for ( std::size_t i = 0; i < dofs.size(); ++i )
+					dofs[i] = i;
+			}
+			return block_sizes.size();
+		}
+
+		//! prolongation from coarse_space, a lower order DG space on the same grid part, to space
+		template < class CoarseSpaceType >
+		static void buildPolynomial( const DiscreteFunctionSpaceType& space, const CoarseSpaceType& coarse_space,
+									 CompressedRowStorage& prolongation )
+		{
+			const int num_dofs = space.mapper().maxNumDofs();
+			const int coarse_dofs = coarse_space.mapper().maxNumDofs();
+			std::vector< int > row_start( space.size() + 1, 0 );
+			std::vector< int > col( std::size_t( space.size() ) * coarse_dofs, 0 );
+			std::vector< double > values( col.size(), 0.0 );
+			std::vector< double > local( num_dofs * coarse_dofs );
+			const IteratorType end = space.end();
+			for ( IteratorType it = space.begin(); it != end; ++it ) {
+				localProjection( space, *it, coarse_space.baseFunctionSet( *it ), coarse_dofs,
+								 static_cast< const typename EntityType::LocalGeometry* >( 0 ), 2 * space.order(), local );
+				double scale = 0.0;
+				for ( std::size_t k = 0; k < local.size(); ++k )
+					scale = std::max( scale, std::fabs( local[k] ) );
+				// the injection pattern of hierarchical bases comes out with round-off fill
+				for ( int i = 0; i < num_dofs; ++i ) {
+					const int row = space.mapToGlobal( *it, i );
+					for ( int j = 0; j < coarse_dofs; ++j ) {
+						if ( std::fabs( local[ i * coarse_dofs + j ] ) <= 1e-12 * scale )
+							continue;
+						const std::size_t pos = std::size_t( row ) * coarse_dofs + row_start[ row + 1 ]++;
+						col[ pos ] = coarse_space.mapToGlobal( *it, j );
+						values[ pos ] = local[ i * coarse_dofs + j ];
+					}
+				}
+			}
+			// compact the fixed stride rows
+			std::size_t fill = 0;
+			for ( int row = 0; row < space.size(); ++row ) {
+				const int count = row_start[ row + 1 ];
+				for ( int k = 0; k < count; ++k, ++fill ) {
+					col[ fill ] = col[ std::size_t( row ) * coarse_dofs + k ];
+					values[ fill ] = values[ std::size_t( row ) * coarse_dofs + k ];
+				}
+				row_start[ row + 1 ] = fill;
+			}
+			col.resize( fill );
+			values.resize( fill );
+			prolongation.swapIn( space.size(), coarse_space.size(), row_start, col, values );
+		}
+
+	private:
+		/** local( i, j ) = (M^{-1} \int_e phi_i psi_j)_{ij}, row major, phi the space's basis on e
+			\param in_coarse maps e's coordinates to those of the element psi lives on, 0 for e itself
+		  **/
+		template < class CoarseBaseFunctionSetType >
+		static void localProjection( const DiscreteFunctionSpaceType& space, const EntityType& entity,
+									 const CoarseBaseFunctionSetType& coarse_set, const int coarse_dofs,
+									 const typename EntityType::LocalGeometry* in_coarse, const int order,
+									 std::vector< double >& local )
+		{
+			const int n = space.mapper().maxNumDofs();
+			const typename DiscreteFunctionSpaceType::BaseFunctionSetType fine_set = space.baseFunctionSet( entity );
+			const typename EntityType::Geometry geometry = entity.geometry();
+			std::vector< double > mass( n * n, 0.0 );
+			std::vector< double > mixed( n * coarse_dofs, 0.0 );
+			std::vector< RangeType > phi( n );
+			std::vector< RangeType > psi( coarse_dofs );
+			const QuadratureType quadrature( entity, order );
+			for ( size_t quad = 0; quad < quadrature.nop(); ++quad ) {
+				const typename QuadratureType::CoordinateType x = quadrature.point( quad );
+				const double weight = quadrature.weight( quad ) * geometry.integrationElement( x );
+				const typename QuadratureType::CoordinateType x_coarse = in_coarse ? in_coarse->global( x ) : x;
+				for ( int i = 0; i < n; ++i )
+					fine_set.evaluate( i, x, phi[i] );
+				for ( int j = 0; j < coarse_dofs; ++j )
+					coarse_set.evaluate( j, x_coarse, psi[j] );
+				for ( int i = 0; i < n; ++i ) {
+					for ( int j = 0; j < n; ++j )
+						mass[ i * n + j ] += weight * ( phi[i] * phi[j] );
+					for ( int j = 0; j < coarse_dofs; ++j )
+						mixed[ i * coarse_dofs + j ] += weight * ( phi[i] * psi[j] );
+				}
+			}
+			std::vector< double > inverse( n * n, 0.0 );
+			for ( int i = 0; i < n; ++i )
+				inverse[ i * n + i ] = 1.0;
+			if ( !BlockDiagonalInverse::invert( mass, &inverse[0], n ) )
+				DUNE_THROW( InvalidStateException, "DGTransfer: singular local mass matrix" );
+			local.assign( n * coarse_dofs, 0.0 );
+			for ( int i = 0; i < n; ++i )
+				for ( int k = 0; k < n; ++k ) {
+					const double m = inverse[ i * n + k ];
+					if ( m == 0.0 )
+						continue;
+					for ( int j = 0; j < coarse_dofs; ++j )
+						local[ i * coarse_dofs + j ] += m * mixed[ k * coarse_dofs + j ];
+				}
+		}
+};
+
+//! order and same-kind spaces of other orders for the DG space templates of DiscreteOseenModelDefaultTraits
+template < class DiscreteFunctionSpaceImp >
+struct DGSpaceOrder;
+
+template < class FunctionSpaceImp, class GridPartImp, int polOrd, template< class > class BaseFunctionStorageImp,
+		   template< class, class, int, template< class > class > class GalerkinSpaceImp >
+struct DGSpaceOrder< GalerkinSpaceImp< FunctionSpaceImp, GridPartImp, polOrd, BaseFunctionStorageImp > >
+{
+	static const int order = polOrd;
+
+	template < int newOrder >
+	struct Rebind {
+		typedef GalerkinSpaceImp< FunctionSpaceImp, GridPartImp, newOrder, BaseFunctionStorageImp >
+			Type;
+	};
+};
+
+/** \brief the p-multigrid hierarchy: space, then one instance of every lower order down to min_order,
+	then optionally geometric levels on the lowest order space
+	The lower order spaces only live while their prolongations are built.
+	coarse_order is the order of the next level below space.
+  **/
+template < class DiscreteFunctionSpaceImp, int coarse_order = DGSpaceOrder< DiscreteFunctionSpaceImp >::order - 1 >
+struct PolynomialHierarchy
+{
+	//! appends to prolongations and block_sizes, which must already hold space's block size
+	static void build( const DiscreteFunctionSpaceImp& space, const int min_order, const int geometric_levels,
+					   std::vector< CompressedRowStorage >& prolongations, std::vector< int >& block_sizes )
+	{
+		if ( coarse_order < min_order ) {
+			PolynomialHierarchy< DiscreteFunctionSpaceImp, -1 >::build( space, min_order, geometric_levels, prolongations, block_sizes );
+			return;
+		}
+		typedef typename DGSpaceOrder< DiscreteFunctionSpaceImp >::template Rebind< coarse_order >::Type
+			CoarseSpaceType;
+		const CoarseSpaceType coarse_space( space.gridPart() );
+		prolongations.push_back( CompressedRowStorage() );
+		DGTransfer< DiscreteFunctionSpaceImp >::buildPolynomial( space, coarse_space, prolongations.back() );
+		block_sizes.push_back( coarse_space.mapper().maxNumDofs() );
+		PolynomialHierarchy< CoarseSpaceType, coarse_order - 1 >::build( coarse_space, min_order, geometric_levels,
+																		  prolongations, block_sizes );
+	}
+};
+
+//! lowest order reached, continue geometrically
+template < class DiscreteFunctionSpaceImp >
+struct PolynomialHierarchy< DiscreteFunctionSpaceImp, -1 >
+{
+	static void build( const DiscreteFunctionSpaceImp& space, const int /*min_order*/, const int geometric_levels,
+					   std::vector< CompressedRowStorage >& prolongations, std::vector< int >& block_sizes )
+	{
+		if ( geometric_levels < 1 )
+			return;
+		std::vector< CompressedRowStorage > geometric;
+		std::vector< int > geometric_sizes;
+		DGTransfer< DiscreteFunctionSpaceImp >::buildGeometric( space, geometric_levels + 1, geometric, geometric_sizes );
+		prolongations.insert( prolongations.end(), geometric.begin(), geometric.end() );
+		block_sizes.insert( block_sizes.end(), geometric_sizes.begin() + 1, geometric_sizes.end() );
+	}
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVERS_DG_TRANSFER_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
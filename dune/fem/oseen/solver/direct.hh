@@ -0,0 +1,319 @@
+#ifndef DUNE_OSEEN_SOLVERS_DIRECT_HH
+#define DUNE_OSEEN_SOLVERS_DIRECT_HH
+
+#include <cmake_config.h>
+
+#include <dune/fem/oseen/assembler/compressed_rowstorage.hh>
+#include <dune/common/exceptions.hh>
+
+#ifdef ENABLE_UMFPACK
+#include <umfpack.h>
+#endif
+
+#include <boost/noncopyable.hpp>
+
+#include <vector>
+#include <deque>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+
+namespace Dune {
+namespace Oseen {
+
+/** \brief reverse Cuthill-McKee ordering of the symmetrised sparsity graph of matrix
+	perm[new] = old, every connected component starts at its node of minimal degree
+  **/
+inline void reverseCuthillMcKee( const CompressedRowStorage& matrix, std::vector< int >& perm )
+{
+	const int n = matrix.rows();
+	CompressedRowStorage transposed;
+	transpose( matrix, transposed );
+	std::vector< std::vector< int > > neighbours( n );
+	for ( int row = 0; row < n; ++row ) {
+		for ( int pos = matrix.rowStart( row ); pos < matrix.rowEnd( row ); ++pos )
+			if ( matrix.colIndex( pos ) != row )
+				neighbours[ row ].push_back( matrix.colIndex( pos ) );
+		for ( int pos = transposed.rowStart( row ); pos < transposed.rowEnd( row ); ++pos )
+			if ( transposed.colIndex( pos ) != row )
+				neighbours[ row ].push_back( transposed.colIndex( pos ) );
+		std::sort( neighbours[ row ].begin(), neighbours[ row ].end() );
+		neighbours[ row ].erase( std::unique( neighbours[ row ].begin(), neighbours[ row ].end() ), neighbours[ row ].end() );
+	}
+	std::vector< std::pair< int, int > > by_degree( n );
+	for ( int row = 0; row < n; ++row )
+		by_degree[ row ] = std::make_pair( int( neighbours[ row ].size() ), row );
+	std::sort( by_degree.begin(), by_degree.end() );
+
+	perm.clear();
+	perm.reserve( n );
+	std::vector< bool > visited( n, false );
+	std::vector< std::pair< int, int > > next;
+	for ( int s = 0; s < n; ++s ) {
+		const int start = by_degree[ s ].second;
+		if ( visited[ start ] )
+			continue;
+		visited[ start ] = true;
+		std::deque< int > queue( 1, start );
+		while ( !queue.empty() ) {
+			const int node = queue.front();
+			queue.pop_front();
+			perm.push_back( node );
+			next.clear();
+			for ( std::size_t k = 0; k < neighbours[ node ].size(); ++k ) {
+				const int neighbour = neighbours[ node ][ k ];
+				if ( !visited[ neighbour ] ) {
+					visited[ neighbour ] = true;
+					next.push_back( std::make_pair( int( neighbours[ neighbour ].size() ), neighbour ) );
+				}
+			}
+			std::sort( next.begin(), next.end() );
+			for ( std::size_t k = 0; k < next.size(); ++k )
+				queue.push_back( next[k].second );
+		}
+	}
+	std::reverse( perm.begin(), perm.end() );
+}
+
+/** \brief sparse LU of a square CSR matrix, factored once and applied as often as needed
+	With ENABLE_UMFPACK the factorisation is UMFPACK's (the CSR arrays are handed over as the CSC of A^T
+	and solved with UMFPACK_At), otherwise a banded LU with partial pivoting after a reverse Cuthill-McKee
+	reordering, which is what 2D DG systems of moderate size need.
+	The memory of the factors is estimated before anything is factored, if it exceeds max_memory (bytes)
+	factored() is false and the caller is expected to fall back to an iterative solver.
+  **/
+class SparseDirectSolver : public boost::noncopyable
+{
+	public:
+		SparseDirectSolver( const CompressedRowStorage& matrix, const double max_memory )
+			: n_( matrix.rows() ),
+			  factored_( false ),
+			  singular_( false ),
+			  memory_estimate_( 0.0 ),
+			  kl_( 0 ),
+			  ku_( 0 )
+		{
+#ifdef ENABLE_UMFPACK
+			numeric_ = 0;
+#endif
+			if ( matrix.rows() != matrix.cols() )
+				DUNE_THROW( InvalidStateException, "SparseDirectSolver: matrix is not square" );
+			if ( n_ == 0 )
+				return;
+#ifdef ENABLE_UMFPACK
+			factorUMF( matrix, max_memory );
+#else
+			factorBanded( matrix, max_memory );
+#endif
+		}
+
+		~SparseDirectSolver()
+		{
+#ifdef ENABLE_UMFPACK
+			if ( numeric_ )
+				umfpack_di_free_numeric( &numeric_ );
+#endif
+		}
+
+		//! false if the factors would not fit into max_memory
+		bool factored() const { return factored_; }
+		/** true if the matrix was found (numerically) singular
+			The banded LU replaces zero pivots and still solves consistent systems, UMFPACK's solution is unusable then.
+		  **/
+		bool singular() const { return singular_; }
+		//! (estimated) bytes needed for the factors
+		double memoryEstimate() const { return memory_estimate_; }
+
+		//! x = A^{-1} b
+		void apply( const double* b, double* x ) const
+		{
+			assert( factored_ );
+#ifdef ENABLE_UMFPACK
+			double info[ UMFPACK_INFO ];
+			const int status = umfpack_di_solve( UMFPACK_At, &row_start_[0], &col_[0], &values_[0],
+												 x, b, numeric_, 0, info );
+			if ( status < 0 )
+				DUNE_THROW( InvalidStateException, "SparseDirectSolver: umfpack_di_solve failed with status " << status );
+#else
+			std::vector< double >& y = work_;
+			for ( int i = 0; i < n_; ++i )
+				y[i] = b[ perm_[i] ];
+			// L with the row interchanges in the order they were made
+			for ( int i = 0; i < n_; ++i ) {
+				std::swap( y[i], y[ pivot_[i] ] );
+				const int last = std::min( n_ - 1, i + kl_ );
+				for ( int row = i + 1; row <= last; ++row )
+					y[ row ] -= entry( row, i ) * y[i];
+			}
+			const int width = kl_ + ku_;
+			for ( int i = n_ - 1; i >= 0; --i ) {
+				double sum = y[i];
+				const int last = std::min( n_ - 1, i + width );
+				for ( int col = i + 1; col <= last; ++col )
+					sum -= entry( i, col ) * y[ col ];
+				y[i] = sum / entry( i, i );
+			}
+			for ( int i = 0; i < n_; ++i )
+				x[ perm_[i] ] = y[i];
+#endif
+		}
+
+	private:
+#ifdef ENABLE_UMFPACK
+		void factorUMF( const CompressedRowStorage& matrix, const double max_memory )
+		{
+			// UMFPACK wants sorted indices per column, i.e. per row of the CSR
+			row_start_.assign( n_ + 1, 0 );
+			col_.resize( matrix.nonZeros() );
+			values_.resize( matrix.nonZeros() );
+			std::vector< std::pair< int, double > > row_entries;
+			for ( int row = 0; row < n_; ++row ) {
+				row_entries.clear();
+				for ( int pos = matrix.rowStart( row ); pos < matrix.rowEnd( row ); ++pos )
+					row_entries.push_back( std::make_pair( matrix.colIndex( pos ), matrix.value( pos ) ) );
+				std::sort( row_entries.begin(), row_entries.end() );
+				row_start_[ row + 1 ] = row_start_[ row ] + row_entries.size();
+				for ( std::size_t k = 0; k < row_entries.size(); ++k ) {
+					col_[ row_start_[ row ] + k ] = row_entries[k].first;
+					values_[ row_start_[ row ] + k ] = row_entries[k].second;
+				}
+			}
+			double info[ UMFPACK_INFO ];
+			void* symbolic = 0;
+			int status = umfpack_di_symbolic( n_, n_, &row_start_[0], &col_[0], &values_[0], &symbolic, 0, info );
+			if ( status < 0 )
+				DUNE_THROW( InvalidStateException, "SparseDirectSolver: umfpack_di_symbolic failed with status " << status );
+			memory_estimate_ = info[ UMFPACK_NUMERIC_SIZE_ESTIMATE ] * info[ UMFPACK_SIZE_OF_UNIT ];
+			if ( memory_estimate_ <= max_memory ) {
+				status = umfpack_di_numeric( &row_start_[0], &col_[0], &values_[0], symbolic, &numeric_, 0, info );
+				if ( status < 0 ) {
+					umfpack_di_free_symbolic( &symbolic );
+					DUNE_THROW( InvalidStateException, "SparseDirectSolver: umfpack_di_numeric failed with status " << status );
+				}
+				memory_estimate_ = info[ UMFPACK_NUMERIC_SIZE ] * info[ UMFPACK_SIZE_OF_UNIT ];
+				singular_ = status == UMFPACK_WARNING_singular_matrix;
+				factored_ = true;
+			}
+			umfpack_di_free_symbolic( &symbolic );
+		}
+
+		std::vector< int > row_start_;
+		std::vector< int > col_;
+		std::vector< double > values_;
+		void* numeric_;
+#else
+		/** row i keeps columns [i - kl, i + kl + ku], the upper bandwidth grows by kl through the row interchanges.
+			Entries of L stay where they were computed, like in LAPACK's dgbtrf.
+		  **/
+		double& entry( const int row, const int col ) { return band_[ std::size_t( row ) * width_ + col - row + kl_ ]; }
+		double entry( const int row, const int col ) const { return band_[ std::size_t( row ) * width_ + col - row + kl_ ]; }
+
+		void factorBanded( const CompressedRowStorage& matrix, const double max_memory )
+		{
+			reverseCuthillMcKee( matrix, perm_ );
+			std::vector< int > position( n_ );
+			for ( int i = 0; i < n_; ++i )
+				position[ perm_[i] ] = i;
+			double scale = 0.0;
+			for ( int i = 0; i < n_; ++i ) {
+				const int row = perm_[i];
+				for ( int pos = matrix.rowStart( row ); pos < matrix.rowEnd( row ); ++pos ) {
+					const int j = position[ matrix.colIndex( pos ) ];
+					kl_ = std::max( kl_, i - j );
+					ku_ = std::max( ku_, j - i );
+					scale = std::max( scale, std::fabs( matrix.value( pos ) ) );
+				}
+			}
+			width_ = 2 * kl_ + ku_ + 1;
+			memory_estimate_ = double( n_ ) * width_ * sizeof(double);
+			if ( memory_estimate_ > max_memory )
+				return;
+			if ( scale == 0.0 )
+				scale = 1.0;
+
+			band_.assign( std::size_t( n_ ) * width_, 0.0 );
+			for ( int i = 0; i < n_; ++i ) {
+				const int row = perm_[i];
+				for ( int pos = matrix.rowStart( row ); pos < matrix.rowEnd( row ); ++pos )
+					entry( i, position[ matrix.colIndex( pos ) ] ) += matrix.value( pos );
+			}
+			pivot_.resize( n_ );
+			for ( int i = 0; i < n_; ++i ) {
+				const int last_row = std::min( n_ - 1, i + kl_ );
+				const int last_col = std::min( n_ - 1, i + kl_ + ku_ );
+				int p = i;
+				for ( int row = i + 1; row <= last_row; ++row )
+					if ( std::fabs( entry( row, i ) ) > std::fabs( entry( p, i ) ) )
+						p = row;
+				pivot_[i] = p;
+				if ( p != i )
+					for ( int col = i; col <= last_col; ++col )
+						std::swap( entry( i, col ), entry( p, col ) );
+				// (numerically) singular, e.g. pure Neumann problems, regularise like IncompleteLU0
+				if ( std::fabs( entry( i, i ) ) < 1e-14 * scale ) {
+					entry( i, i ) = scale;
+					singular_ = true;
+				}
+				const double diagonal = entry( i, i );
+				for ( int row = i + 1; row <= last_row; ++row ) {
+					const double factor = entry( row, i ) / diagonal;
+					entry( row, i ) = factor;
+					if ( factor == 0.0 )
+						continue;
+					for ( int col = i + 1; col <= last_col; ++col )
+						entry( row, col ) -= factor * entry( i, col );
+				}
+			}
+			work_.resize( n_ );
+			factored_ = true;
+		}
+
+		int width_;
+		std::vector< double > band_;
+		std::vector< int > perm_;
+		std::vector< int > pivot_;
+		mutable std::vector< double > work_;
+#endif
+
+		const int n_;
+		bool factored_;
+		bool singular_;
+		double memory_estimate_;
+		int kl_;
+		int ku_;
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVERS_DIRECT_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
@@ -0,0 +1,129 @@
+#ifndef DUNE_OSEEN_SOLVERS_ILU_HH
+#define DUNE_OSEEN_SOLVERS_ILU_HH
+
+#include <dune/fem/oseen/assembler/compressed_rowstorage.hh>
+#include <dune/common/exceptions.hh>
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+
+namespace Dune {
+namespace Oseen {
+
+/** \brief ILU(0) of a CSR matrix, L (unit diagonal) and U share the sparsity pattern of the matrix
+	(Numerically) zero pivots are replaced by the largest entry magnitude, so singular systems
+	such as pure Neumann pressure problems still give a usable preconditioner.
+  **/
+class IncompleteLU0
+{
+	public:
+		explicit IncompleteLU0( const CompressedRowStorage& matrix )
+		{
+			const int n = matrix.rows();
+			// copy with ascending columns per row
+			std::vector< int > row_start( n + 1, 0 );
+			std::vector< int > col( matrix.nonZeros() );
+			std::vector< double > values( matrix.nonZeros() );
+			std::vector< std::pair< int, double > > row_entries;
+			double scale = 0.0;
+			for ( int row = 0; row < n; ++row ) {
+				row_entries.clear();
+				for ( int pos = matrix.rowStart( row ); pos < matrix.rowEnd( row ); ++pos ) {
+					row_entries.push_back( std::make_pair( matrix.colIndex( pos ), matrix.value( pos ) ) );
+					scale = std::max( scale, std::fabs( matrix.value( pos ) ) );
+				}
+				std::sort( row_entries.begin(), row_entries.end() );
+				row_start[ row + 1 ] = row_start[ row ] + row_entries.size();
+				for ( std::size_t k = 0; k < row_entries.size(); ++k ) {
+					col[ row_start[ row ] + k ] = row_entries[k].first;
+					values[ row_start[ row ] + k ] = row_entries[k].second;
+				}
+			}
+			factors_.swapIn( n, matrix.cols(), row_start, col, values );
+			if ( scale == 0.0 )
+				scale = 1.0;
+
+			diagonal_.assign( n, -1 );
+			std::vector< int > marker( n, -1 );
+			for ( int row = 0; row < n; ++row ) {
+				for ( int pos = factors_.rowStart( row ); pos < factors_.rowEnd( row ); ++pos )
+					marker[ factors_.colIndex( pos ) ] = pos;
+				for ( int pos = factors_.rowStart( row ); pos < factors_.rowEnd( row ); ++pos ) {
+					const int k = factors_.colIndex( pos );
+					if ( k >= row )
+						break;
+					const double factor = factors_.value( pos ) / factors_.value( diagonal_[k] );
+					factors_.value( pos ) = factor;
+					for ( int k_pos = diagonal_[k] + 1; k_pos < factors_.rowEnd( k ); ++k_pos ) {
+						const int target = marker[ factors_.colIndex( k_pos ) ];
+						if ( target >= factors_.rowStart( row ) )
+							factors_.value( target ) -= factor * factors_.value( k_pos );
+					}
+				}
+				const int diag_pos = marker[ row ] >= factors_.rowStart( row ) ? marker[ row ] : -1;
+				if ( diag_pos < 0 )
+					DUNE_THROW( InvalidStateException, "IncompleteLU0: row " << row << " has no diagonal entry" );
+				diagonal_[ row ] = diag_pos;
+				if ( std::fabs( factors_.value( diag_pos ) ) < 1e-14 * scale )
+					factors_.value( diag_pos ) = scale;
+			}
+		}
+
+		//! y = ( L U )^{-1} x
+		void apply( const double* x, double* y ) const
+		{
+			const int n = factors_.rows();
+			for ( int row = 0; row < n; ++row ) {
+				double sum = x[ row ];
+				for ( int pos = factors_.rowStart( row ); pos < diagonal_[ row ]; ++pos )
+					sum -= factors_.value( pos ) * y[ factors_.colIndex( pos ) ];
+				y[ row ] = sum;
+			}
+			for ( int row = n - 1; row >= 0; --row ) {
+				double sum = y[ row ];
+				for ( int pos = diagonal_[ row ] + 1; pos < factors_.rowEnd( row ); ++pos )
+					sum -= factors_.value( pos ) * y[ factors_.colIndex( pos ) ];
+				y[ row ] = sum / factors_.value( diagonal_[ row ] );
+			}
+		}
+
+	private:
+		CompressedRowStorage factors_;
+		std::vector< int > diagonal_;
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVERS_ILU_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
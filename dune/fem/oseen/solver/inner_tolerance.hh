@@ -0,0 +1,130 @@
+#ifndef DUNE_OSEEN_SOLVERS_INNER_TOLERANCE_HH
+#define DUNE_OSEEN_SOLVERS_INNER_TOLERANCE_HH
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace Dune {
+namespace Oseen {
+
+//! what happened in one outer iteration of an inexact Schur complement solve
+struct OuterStepRecord {
+	//! relative tolerance handed to the inner solver
+	double inner_tolerance;
+	int inner_iterations;
+	//! ||r_{k+1}|| / ||r_k|| of the outer residual
+	double residual_reduction;
+
+	OuterStepRecord( const double tolerance, const int iterations, const double reduction )
+		: inner_tolerance( tolerance ),
+		  inner_iterations( iterations ),
+		  residual_reduction( reduction )
+	{}
+};
+
+/** \brief inner tolerances for the outer CG on the Schur complement, after the relaxation strategies for inexact Krylov
+	methods (Simoncini/Szyld, van den Eshof/Sleijpen)
+	An inner solve to relative accuracy eta perturbs the outer update rho h by roughly eta |rho| ||h||, the sum of these
+	perturbations is the gap between the recursively updated and the true outer residual. The controller keeps that gap
+	below safety * target, target being the outer residual norm that ends the iteration: step k gets
+	\f$ \eta_k = \frac{ safety \cdot target - spent }{ m_k \| r_k \| } \f$, clipped to [eta_min, eta_max], where m_k is the
+	number of steps still expected from the observed convergence rate. So the inner solves get cheaper as the outer residual
+	drops, and what an inner solver over-achieves is left in the budget. spent is charged with the accuracy actually reached.
+	Spending the same share of the budget in every step is what minimises the summed log(1/eta_k), i.e. the inner
+	iterations of solvers converging linearly.
+  **/
+class InnerToleranceController
+{
+	public:
+		InnerToleranceController( const double target, const double eta_min, const double eta_max, const double safety )
+			: target_( target ),
+			  eta_min_( eta_min ),
+			  eta_max_( std::max( eta_min, eta_max ) ),
+			  safety_( safety ),
+			  spent_( 0.0 ),
+			  log_reduction_sum_( 0.0 ),
+			  reductions_( 0 )
+		{}
+
+		//! relative inner tolerance for the step starting at outer residual norm residual
+		double tolerance( const double residual ) const
+		{
+			const double budget = safety_ * target_ - spent_;
+			if ( budget <= 0.0 || residual <= 0.0 )
+				return eta_min_;
+			return std::max( eta_min_, std::min( eta_max_, budget / ( expectedSteps( residual ) * residual ) ) );
+		}
+
+		/** charge a finished step
+			\param achieved relative residual the inner solver reached
+			\param update_norm |rho| ||h||
+		  **/
+		void record( const double tolerance, const double achieved, const double update_norm,
+					 const double residual_before, const double residual_after )
+		{
+			spent_ += std::min( achieved, tolerance ) * update_norm;
+			const double reduction = residual_before > 0.0 ? residual_after / residual_before : 1.0;
+			if ( reduction > 0.0 && reduction < 1.0 ) {
+				log_reduction_sum_ += std::log( reduction );
+				++reductions_;
+			}
+		}
+
+		//! after the outer residual was recomputed from scratch the gap is gone
+		void resetBudget() { spent_ = 0.0; }
+
+		double spent() const { return spent_; }
+
+	private:
+		//! steps from residual down to target at the mean rate seen so far, 10 per decade before anything was seen
+		double expectedSteps( const double residual ) const
+		{
+			if ( residual <= target_ )
+				return 1.0;
+			const double log_rate = reductions_ ? log_reduction_sum_ / reductions_ : std::log( 0.1 ) / 10.0;
+			return std::max( 1.0, std::ceil( std::log( target_ / residual ) / log_rate ) );
+		}
+
+		const double target_;
+		const double eta_min_;
+		const double eta_max_;
+		const double safety_;
+		double spent_;
+		double log_reduction_sum_;
+		int reductions_;
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVERS_INNER_TOLERANCE_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
@@ -0,0 +1,201 @@
+#ifndef DUNE_OSEEN_SOLVERS_LANCZOS_HH
+#define DUNE_OSEEN_SOLVERS_LANCZOS_HH
+
+#include <vector>
+#include <string>
+#include <map>
+#include <cmath>
+#include <algorithm>
+
+namespace Dune {
+namespace Oseen {
+
+/** \brief extreme eigenvalue estimates of the (preconditioned) operator of a CG run, from its coefficients alone
+	CG with step lengths alpha_k and direction updates beta_k = <r_{k+1},z_{k+1}> / <r_k,z_k> is the Lanczos process
+	in disguise, the tridiagonal Lanczos matrix has \f$ T_{kk} = 1/\alpha_k + \beta_{k-1}/\alpha_{k-1} \f$ and
+	\f$ T_{k,k+1} = \sqrt{\beta_k}/\alpha_k \f$ (Saad, Iterative Methods for Sparse Linear Systems, 6.7.3).
+	Its extreme eigenvalues (Ritz values) converge to the operator's from the inside: maxEigenvalue() is a lower bound
+	that is usually good after a few steps, minEigenvalue() an upper bound that needs more, so condition() underestimates.
+	Costs no operator application and no reduction. A non-positive or non-finite alpha (the operator is not SPD,
+	or CG broke down) ends the recording, the steps before it are kept.
+  **/
+class LanczosEstimate
+{
+	public:
+		LanczosEstimate()
+		{
+			clear();
+		}
+
+		void clear()
+		{
+			diag_.clear();
+			offdiag_.clear();
+			last_alpha_ = 0.0;
+			last_beta_ = 0.0;
+			broken_ = false;
+			computed_ = false;
+		}
+
+		//! one CG step, beta is the coefficient that forms the next search direction
+		void add( const double alpha, const double beta )
+		{
+			if ( broken_ || !( alpha > 0.0 ) || !std::isfinite( alpha ) || !( beta >= 0.0 ) || !std::isfinite( beta ) ) {
+				broken_ = true;
+				return;
+			}
+			const double previous = diag_.empty() ? 0.0 : last_beta_ / last_alpha_;
+			diag_.push_back( 1.0 / alpha + previous );
+			offdiag_.push_back( std::sqrt( beta ) / alpha );
+			last_alpha_ = alpha;
+			last_beta_ = beta;
+			computed_ = false;
+		}
+
+		int steps() const { return diag_.size(); }
+
+		double minEigenvalue() const { compute(); return min_; }
+		double maxEigenvalue() const { compute(); return max_; }
+
+		//! max / min, -1 without any step
+		double condition() const
+		{
+			compute();
+			return steps() == 0 || !( min_ > 0.0 ) ? -1.0 : max_ / min_;
+		}
+
+	private:
+		//! number of eigenvalues of T below x, Sturm sequence of the LDL^T pivots
+		int countBelow( const double x ) const
+		{
+			const int n = diag_.size();
+			int count = 0;
+			double pivot = 1.0;
+			for ( int k = 0; k < n; ++k ) {
+				const double off = k > 0 ? offdiag_[ k - 1 ] : 0.0;
+				pivot = diag_[k] - x - ( k > 0 ? off * off / pivot : 0.0 );
+				if ( pivot == 0.0 )
+					pivot = -1e-300;
+				if ( pivot < 0.0 )
+					++count;
+			}
+			return count;
+		}
+
+		//! bisection for the smallest x with at least target eigenvalues below it
+		double bisect( const int target, double lower, double upper ) const
+		{
+			for ( int it = 0; it < 200 && upper - lower > 1e-12 * std::max( std::fabs( lower ), std::fabs( upper ) ); ++it ) {
+				const double mid = 0.5 * ( lower + upper );
+				if ( countBelow( mid ) >= target )
+					upper = mid;
+				else
+					lower = mid;
+			}
+			return 0.5 * ( lower + upper );
+		}
+
+		void compute() const
+		{
+			if ( computed_ )
+				return;
+			computed_ = true;
+			const int n = diag_.size();
+			if ( n == 0 ) {
+				min_ = max_ = -1.0;
+				return;
+			}
+			// Gershgorin interval
+			double lower = diag_[0], upper = diag_[0];
+			for ( int k = 0; k < n; ++k ) {
+				const double radius = ( k > 0 ? offdiag_[ k - 1 ] : 0.0 ) + ( k + 1 < n ? offdiag_[k] : 0.0 );
+				lower = std::min( lower, diag_[k] - radius );
+				upper = std::max( upper, diag_[k] + radius );
+			}
+			lower -= 1e-14 * std::fabs( upper );
+			upper += 1e-14 * std::fabs( upper );
+			min_ = bisect( 1, lower, upper );
+			max_ = bisect( n, lower, upper );
+		}
+
+		std::vector< double > diag_;
+		std::vector< double > offdiag_;
+		double last_alpha_;
+		double last_beta_;
+		bool broken_;
+		mutable bool computed_;
+		mutable double min_;
+		mutable double max_;
+};
+
+/** \brief the latest eigenvalue bounds per operator name, kept for the whole run
+	Refinement sweeps, time steps and Picard iterations solve closely related systems, so bounds from the previous
+	solve are good starting values for parameters of the next (see outer_stopping in SaddlepointInverseOperator).
+  **/
+class SpectralEstimates
+{
+	public:
+		static SpectralEstimates& instance()
+		{
+			static SpectralEstimates estimates;
+			return estimates;
+		}
+
+		//! keeps the estimate if it has at least min_steps steps
+		void store( const std::string& name, const LanczosEstimate& estimate, const int min_steps = 3 )
+		{
+			if ( estimate.steps() < min_steps )
+				return;
+			bounds_[ name ] = std::make_pair( estimate.minEigenvalue(), estimate.maxEigenvalue() );
+		}
+
+		//! false if nothing is known about name yet
+		bool lookup( const std::string& name, double& min_eigenvalue, double& max_eigenvalue ) const
+		{
+			const std::map< std::string, std::pair< double, double > >::const_iterator it = bounds_.find( name );
+			if ( it == bounds_.end() )
+				return false;
+			min_eigenvalue = it->second.first;
+			max_eigenvalue = it->second.second;
+			return true;
+		}
+
+	private:
+		SpectralEstimates() {}
+
+		std::map< std::string, std::pair< double, double > > bounds_;
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVERS_LANCZOS_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
@@ -0,0 +1,720 @@
+#ifndef DUNE_OSEEN_SOLVERS_MONOLITHIC_HH
+#define DUNE_OSEEN_SOLVERS_MONOLITHIC_HH
+
+#include <dune/fem/oseen/solver/schurkomplement.hh>
+#include <dune/fem/oseen/solver/block_krylov.hh>
+#include <dune/fem/oseen/solver/direct.hh>
+#include <dune/fem/oseen/assembler/compressed_rowstorage.hh>
+#include <dune/stuff/fem/customprojection.hh>
+#include <dune/stuff/fem/functions/integrals.hh>
+#include <dune/stuff/fem/functions/analytical.hh>
+#include <dune/stuff/common/logging.hh>
+#include <dune/stuff/common/parameter/configcontainer.hh>
+#include <dune/common/exceptions.hh>
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <memory>
+
+namespace Dune {
+namespace Oseen {
+
+/** \brief CSR copies of the LDG blocks, seen as one system
+	\f$ K = \begin{pmatrix} A & B \\ B^T & -C \end{pmatrix} \f$ with \f$ A = Y + O - X M^{-1} W \f$,
+	\f$ B = Z \f$, \f$ B^T = -E \f$ and \f$ C = R \f$, which is the sign convention SaddlepointInverseOperator
+	uses. For Stokes K is symmetric (indefinite). Unknowns are ordered velocity first, then pressure.
+  **/
+class SaddlepointSystem
+{
+	public:
+		template <  class X_MatrixType,
+					class M_invers_matrixType,
+					class Y_MatrixType,
+					class O_MatrixType,
+					class E_MatrixType,
+					class R_MatrixType,
+					class Z_MatrixType,
+					class W_MatrixType >
+		SaddlepointSystem( const X_MatrixType& Xmatrix,
+						   const M_invers_matrixType& Mmatrix,
+						   const Y_MatrixType& Ymatrix,
+						   const O_MatrixType& Omatrix,
+						   const E_MatrixType& Ematrix,
+						   const R_MatrixType& Rmatrix,
+						   const Z_MatrixType& Zmatrix,
+						   const W_MatrixType& Wmatrix )
+		{
+			x_.assign( Xmatrix.matrix() );
+			m_inv_.assign( Mmatrix.matrix() );
+			y_.assign( Ymatrix.matrix() );
+			o_.assign( Omatrix.matrix() );
+			e_.assign( Ematrix.matrix() );
+			r_.assign( Rmatrix.matrix() );
+			z_.assign( Zmatrix.matrix() );
+			w_.assign( Wmatrix.matrix() );
+			sig_tmp1_.resize( w_.rows() );
+			sig_tmp2_.resize( w_.rows() );
+			CompressedRowStorage w_t;
+			w_t.assignTransposed( Wmatrix.matrix() );
+			CompressedRowStorage z_t;
+			z_t.assignTransposed( Zmatrix.matrix() );
+			computeDiagonalA( w_t );
+			computeDiagonalSchur( z_t );
+		}
+
+		int velocitySize() const { return y_.rows(); }
+		int pressureSize() const { return r_.rows(); }
+		int size() const { return velocitySize() + pressureSize(); }
+
+		//! ret = A u
+		void applyA( const double* u, double* ret ) const
+		{
+			w_.mult( u, &sig_tmp1_[0] );
+			m_inv_.mult( &sig_tmp1_[0], &sig_tmp2_[0] );
+			x_.mult( &sig_tmp2_[0], ret );
+			for ( int i = 0; i < velocitySize(); ++i )
+				ret[i] = -ret[i];
+			y_.multAdd( u, ret );
+			o_.multAdd( u, ret );
+		}
+
+		//! ret = K x
+		void apply( const double* x, double* ret ) const
+		{
+			const double* u = x;
+			const double* p = x + velocitySize();
+			double* ret_u = ret;
+			double* ret_p = ret + velocitySize();
+			applyA( u, ret_u );
+			z_.multAdd( p, ret_u );
+			// B^T u - C p = -( E u + R p )
+			e_.mult( u, ret_p );
+			r_.multAdd( p, ret_p );
+			for ( int i = 0; i < pressureSize(); ++i )
+				ret_p[i] = -ret_p[i];
+		}
+
+		/** form K explicitly, row/column i < velocitySize() is velocity dof i of DiscreteOseenFunctionWrapper,
+			velocitySize() + j is pressure dof j
+			With pin_pressure the first pressure dof is fixed (identity row and column), which removes the
+			constant pressure null space of the pure Dirichlet problem, see MonolithicSaddlepointInverseOperator
+		  **/
+		void assemble( CompressedRowStorage& k, const bool pin_pressure = false ) const
+		{
+			CompressedRowStorage a;
+			assembleA( a );
+			const int nu = velocitySize();
+			const int pinned = pin_pressure ? nu : -1;
+			std::vector< int > row_start( 1, 0 );
+			std::vector< int > col;
+			std::vector< double > values;
+			col.reserve( a.nonZeros() + z_.nonZeros() + e_.nonZeros() + r_.nonZeros() );
+			values.reserve( col.capacity() );
+			for ( int row = 0; row < size(); ++row ) {
+				if ( row == pinned ) {
+					col.push_back( row );
+					values.push_back( 1.0 );
+				}
+				else if ( row < nu ) {
+					appendRow( a, row, 0, 1.0, pinned, col, values );
+					appendRow( z_, row, nu, 1.0, pinned, col, values );
+				}
+				else {
+					// B^T u - C p = -( E u + R p )
+					appendRow( e_, row - nu, 0, -1.0, pinned, col, values );
+					appendRow( r_, row - nu, nu, -1.0, pinned, col, values );
+				}
+				row_start.push_back( col.size() );
+			}
+			k.swapIn( size(), size(), row_start, col, values );
+		}
+
+		//! form A = Y + O - X M^{-1} W explicitly
+		void assembleA( CompressedRowStorage& a ) const
+		{
+			CompressedRowStorage mw, xmw, yo;
+			multiply( m_inv_, w_, mw );
+			multiply( x_, mw, xmw );
+			add( 1.0, y_, 1.0, o_, yo );
+			add( 1.0, yo, -1.0, xmw, a );
+		}
+
+		//! B = Z, B^T = -E and C = R as stored
+		const CompressedRowStorage& matrixZ() const { return z_; }
+		const CompressedRowStorage& matrixE() const { return e_; }
+		const CompressedRowStorage& matrixR() const { return r_; }
+
+		//! ret = B p
+		void applyB( const double* p, double* ret ) const { z_.mult( p, ret ); }
+
+		//! b = ( H2 - X M^{-1} H1, H3 )
+		void rightHandSide( const double* h1, const double* h2, const double* h3, double* b ) const
+		{
+			m_inv_.mult( h1, &sig_tmp1_[0] );
+			x_.mult( &sig_tmp1_[0], b );
+			for ( int i = 0; i < velocitySize(); ++i )
+				b[i] = h2[i] - b[i];
+			std::copy( h3, h3 + pressureSize(), b + velocitySize() );
+		}
+
+		//! |diag( Y + O - X M^{-1} W )|, M^{-1} taken as diagonal, zeros replaced by one, so Jacobi on it is SPD like in LSCPreconditioner
+		const std::vector< double >& diagonalA() const { return diag_a_; }
+
+		/** diag( C + B^T diag(A)^{-1} B ), the cheapest spectrally sensible Schur complement approximation
+			non-positive entries (e.g. from a bad diag(A)) are replaced by one
+		  **/
+		const std::vector< double >& diagonalSchur() const { return diag_s_; }
+
+	private:
+		void computeDiagonalA( const CompressedRowStorage& w_t )
+		{
+			diag_a_.assign( velocitySize(), 0.0 );
+			addDiagonal( y_, diag_a_ );
+			addDiagonal( o_, diag_a_ );
+			std::vector< double > m_diag( m_inv_.rows(), 0.0 );
+			addDiagonal( m_inv_, m_diag );
+			// (X M^{-1} W)_{ii} = \sum_k X_{ik} M^{-1}_{kk} W_{ki}
+			std::vector< double > w_col( w_.rows(), 0.0 );
+			for ( int i = 0; i < velocitySize(); ++i ) {
+				for ( int pos = w_t.rowStart( i ); pos < w_t.rowEnd( i ); ++pos )
+					w_col[ w_t.colIndex( pos ) ] = w_t.value( pos );
+				for ( int pos = x_.rowStart( i ); pos < x_.rowEnd( i ); ++pos )
+					diag_a_[i] -= x_.value( pos ) * m_diag[ x_.colIndex( pos ) ] * w_col[ x_.colIndex( pos ) ];
+				for ( int pos = w_t.rowStart( i ); pos < w_t.rowEnd( i ); ++pos )
+					w_col[ w_t.colIndex( pos ) ] = 0.0;
+				diag_a_[i] = diag_a_[i] != 0.0 ? std::fabs( diag_a_[i] ) : 1.0;
+			}
+		}
+
+		void computeDiagonalSchur( const CompressedRowStorage& z_t )
+		{
+			diag_s_.assign( pressureSize(), 0.0 );
+			addDiagonal( r_, diag_s_ );
+			std::vector< double > z_col( velocitySize(), 0.0 );
+			for ( int i = 0; i < pressureSize(); ++i ) {
+				for ( int pos = z_t.rowStart( i ); pos < z_t.rowEnd( i ); ++pos )
+					z_col[ z_t.colIndex( pos ) ] = z_t.value( pos );
+				// B^T_{ij} B_{ji} = -E_{ij} Z_{ji}
+				for ( int pos = e_.rowStart( i ); pos < e_.rowEnd( i ); ++pos ) {
+					const int j = e_.colIndex( pos );
+					diag_s_[i] -= e_.value( pos ) * z_col[j] / diag_a_[j];
+				}
+				for ( int pos = z_t.rowStart( i ); pos < z_t.rowEnd( i ); ++pos )
+					z_col[ z_t.colIndex( pos ) ] = 0.0;
+				if ( !( diag_s_[i] > 0.0 ) )
+					diag_s_[i] = 1.0;
+			}
+		}
+
+		static void appendRow( const CompressedRowStorage& matrix, const int row, const int col_offset, const double factor,
+							   const int skip_col, std::vector< int >& col, std::vector< double >& values )
+		{
+			for ( int pos = matrix.rowStart( row ); pos < matrix.rowEnd( row ); ++pos ) {
+				const int j = matrix.colIndex( pos ) + col_offset;
+				if ( j == skip_col )
+					continue;
+				col.push_back( j );
+				values.push_back( factor * matrix.value( pos ) );
+			}
+		}
+
+		static void addDiagonal( const CompressedRowStorage& matrix, std::vector< double >& diag )
+		{
+			for ( int row = 0; row < matrix.rows(); ++row )
+				for ( int pos = matrix.rowStart( row ); pos < matrix.rowEnd( row ); ++pos )
+					if ( matrix.colIndex( pos ) == row )
+						diag[row] += matrix.value( pos );
+		}
+
+		CompressedRowStorage x_;
+		CompressedRowStorage m_inv_;
+		CompressedRowStorage y_;
+		CompressedRowStorage o_;
+		CompressedRowStorage e_;
+		CompressedRowStorage r_;
+		CompressedRowStorage z_;
+		CompressedRowStorage w_;
+		std::vector< double > diag_a_;
+		std::vector< double > diag_s_;
+		mutable std::vector< double > sig_tmp1_;
+		mutable std::vector< double > sig_tmp2_;
+};
+
+/** \brief block preconditioners for SaddlepointSystem
+	Diagonal: \f$ P = diag( \hat A, \hat S ) \f$, SPD, usable with MINRES.
+	Triangular: \f$ P = \begin{pmatrix} \hat A & B \\ 0 & -\hat S \end{pmatrix} \f$, with exact A and S
+	P^{-1}K would have the single eigenvalue 1; needs a non-symmetric (FGMRES) outer solver.
+	\f$ \hat S \f$ is diagonalSchur(). \f$ \hat A^{-1} \f$ is Jacobi if inner_iterations is zero, otherwise at most
+	inner_iterations steps of CG (Stokes) / BiCGStab (Oseen) reducing the residual by inner_reduction,
+	which makes the preconditioner nonlinear, so only FGMRES may use that.
+  **/
+class SaddlepointBlockPreconditioner
+{
+	class A_Operator {
+		public:
+			A_Operator( const SaddlepointSystem& system ) : system_( system ) {}
+			void multBlock( const double* x, double* ret, const int count ) const
+			{
+				assert( count == 1 );
+				system_.applyA( x, ret );
+			}
+		private:
+			const SaddlepointSystem& system_;
+	};
+
+	public:
+		enum Type { Diagonal, Triangular };
+
+		SaddlepointBlockPreconditioner( const SaddlepointSystem& system,
+										const Type type,
+										const bool symmetric,
+										const int inner_iterations,
+										const double inner_reduction )
+			: system_( system ),
+			type_( type ),
+			symmetric_( symmetric ),
+			inner_iterations_( inner_iterations ),
+			inner_reduction_( inner_reduction ),
+			a_rhs_( system.velocitySize(), 1 ),
+			a_sol_( system.velocitySize(), 1 ),
+			b_p_( system.velocitySize() ),
+			applications_( 0 ),
+			inner_total_( 0 ),
+			inner_min_( std::numeric_limits< int >::max() ),
+			inner_max_( 0 )
+		{}
+
+		//! z = P^{-1} r
+		void apply( const double* r, double* z ) const
+		{
+			++applications_;
+			const int nu = system_.velocitySize();
+			const int np = system_.pressureSize();
+			const double* r_u = r;
+			const double* r_p = r + nu;
+			double* z_u = z;
+			double* z_p = z + nu;
+			if ( type_ == Diagonal ) {
+				for ( int i = 0; i < np; ++i )
+					z_p[i] = r_p[i] / system_.diagonalSchur()[i];
+				solveA( r_u, z_u );
+			}
+			else {
+				for ( int i = 0; i < np; ++i )
+					z_p[i] = -r_p[i] / system_.diagonalSchur()[i];
+				system_.applyB( z_p, &b_p_[0] );
+				for ( int i = 0; i < nu; ++i )
+					b_p_[i] = r_u[i] - b_p_[i];
+				solveA( &b_p_[0], z_u );
+			}
+		}
+
+		void fill( SaddlepointInverseOperatorInfo& info ) const
+		{
+			if ( inner_iterations_ == 0 || applications_ == 0 )
+				return;
+			info.iterations_inner_avg = inner_total_ / double( applications_ );
+			info.iterations_inner_min = inner_min_;
+			info.iterations_inner_max = inner_max_;
+			info.max_inner_accuracy = inner_reduction_;
+		}
+
+	private:
+		void solveA( const double* rhs, double* dest ) const
+		{
+			const int nu = system_.velocitySize();
+			if ( inner_iterations_ == 0 ) {
+				for ( int i = 0; i < nu; ++i )
+					dest[i] = rhs[i] / system_.diagonalA()[i];
+				return;
+			}
+			a_rhs_.setColumn( 0, rhs );
+			double rhs_norm = 0.0;
+			for ( int i = 0; i < nu; ++i )
+				rhs_norm += rhs[i] * rhs[i];
+			a_sol_.clear();
+			const A_Operator a_op( system_ );
+			const double limit = inner_reduction_ * inner_reduction_ * rhs_norm;
+			const BlockKrylovInfo info = symmetric_
+					? blockCG( a_op, a_rhs_, a_sol_, limit, inner_iterations_ )
+					: lockstepBiCGStab( a_op, a_rhs_, a_sol_, limit, inner_iterations_ );
+			a_sol_.getColumn( 0, dest );
+			inner_total_ += info.maxIterations();
+			inner_min_ = std::min( inner_min_, info.maxIterations() );
+			inner_max_ = std::max( inner_max_, info.maxIterations() );
+		}
+
+		const SaddlepointSystem& system_;
+		const Type type_;
+		const bool symmetric_;
+		const int inner_iterations_;
+		const double inner_reduction_;
+		mutable MultiVector a_rhs_;
+		mutable MultiVector a_sol_;
+		mutable std::vector< double > b_p_;
+		mutable int applications_;
+		mutable int inner_total_;
+		mutable int inner_min_;
+		mutable int inner_max_;
+};
+
+namespace Monolithic {
+	//! local scalar product, the monolithic solver is serial only
+	inline double dot( const std::vector< double >& a, const std::vector< double >& b )
+	{
+		double sum = 0.0;
+		for ( std::size_t i = 0; i < a.size(); ++i )
+			sum += a[i] * b[i];
+		return sum;
+	}
+
+	/** preconditioned MINRES (Elman, Silvester, Wathen, Alg. 2.4), operator and preconditioner must be symmetric,
+		the preconditioner also positive definite. Stops when the preconditioned residual norm dropped below
+		max( relLimit * initial, absLimit ). \return iterations
+	  **/
+	template < class OperatorType, class PreconditionerType >
+	int minres( const OperatorType& op, const PreconditionerType& prec,
+				const std::vector< double >& b, std::vector< double >& x,
+				const double relLimit, const double absLimit, const int maxIter, const bool verbose )
+	{
+		const std::size_t n = b.size();
+		std::vector< double > v_old( n, 0.0 ), v( n ), v_new( n ), z( n ), z_new( n ), az( n );
+		std::vector< double > w_old( n, 0.0 ), w( n, 0.0 ), w_new( n );
+		op.apply( &x[0], &v[0] );
+		for ( std::size_t i = 0; i < n; ++i )
+			v[i] = b[i] - v[i];
+		prec.apply( &v[0], &z[0] );
+		double gamma_old = 1.0;
+		double gamma = std::sqrt( std::max( dot( z, v ), 0.0 ) );
+		double eta = gamma;
+		double s_old = 0.0, s = 0.0, c_old = 1.0, c = 1.0;
+		const double limit = std::max( relLimit * gamma, absLimit );
+		int iteration = 0;
+		while ( std::fabs( eta ) > limit && iteration < maxIter && gamma != 0.0 ) {
+			++iteration;
+			for ( std::size_t i = 0; i < n; ++i )
+				z[i] /= gamma;
+			op.apply( &z[0], &az[0] );
+			const double delta = dot( az, z );
+			for ( std::size_t i = 0; i < n; ++i )
+				v_new[i] = az[i] - ( delta / gamma ) * v[i] - ( gamma / gamma_old ) * v_old[i];
+			prec.apply( &v_new[0], &z_new[0] );
+			const double gamma_new = std::sqrt( std::max( dot( z_new, v_new ), 0.0 ) );
+			const double alpha0 = c * delta - c_old * s * gamma;
+			const double alpha1 = std::sqrt( alpha0 * alpha0 + gamma_new * gamma_new );
+			const double alpha2 = s * delta + c_old * c * gamma;
+			const double alpha3 = s_old * gamma;
+			const double c_new = alpha0 / alpha1;
+			const double s_new = gamma_new / alpha1;
+			for ( std::size_t i = 0; i < n; ++i ) {
+				w_new[i] = ( z[i] - alpha3 * w_old[i] - alpha2 * w[i] ) / alpha1;
+				x[i] += c_new * eta * w_new[i];
+			}
+			eta = -s_new * eta;
+			std::swap( v_old, v );
+			std::swap( v, v_new );
+			std::swap( z, z_new );
+			std::swap( w_old, w );
+			std::swap( w, w_new );
+			gamma_old = gamma;
+			gamma = gamma_new;
+			c_old = c;
+			c = c_new;
+			s_old = s;
+			s = s_new;
+			if ( verbose )
+				DSC_LOG_INFO << "\t MINRES " << iteration << " residuum: " << std::fabs( eta ) << std::endl;
+		}
+		return iteration;
+	}
+
+	/** right preconditioned flexible GMRES(restart) (Saad), the preconditioner may change between iterations
+		Stops when the residual norm dropped below max( relLimit * initial, absLimit ). \return iterations
+	  **/
+	template < class OperatorType, class PreconditionerType >
+	int fgmres( const OperatorType& op, const PreconditionerType& prec,
+				const std::vector< double >& b, std::vector< double >& x,
+				const double relLimit, const double absLimit, const int maxIter, const int restart,
+				const bool verbose )
+	{
+		const std::size_t n = b.size();
+		std::vector< std::vector< double > > v( restart + 1, std::vector< double >( n ) );
+		std::vector< std::vector< double > > z( restart, std::vector< double >( n ) );
+		std::vector< std::vector< double > > h( restart + 1, std::vector< double >( restart, 0.0 ) );
+		std::vector< double > cs( restart ), sn( restart ), g( restart + 1 ), y( restart );
+		std::vector< double > r( n );
+
+		op.apply( &x[0], &r[0] );
+		for ( std::size_t i = 0; i < n; ++i )
+			r[i] = b[i] - r[i];
+		double beta = std::sqrt( dot( r, r ) );
+		const double limit = std::max( relLimit * beta, absLimit );
+		int iteration = 0;
+		while ( beta > limit && iteration < maxIter ) {
+			for ( std::size_t i = 0; i < n; ++i )
+				v[0][i] = r[i] / beta;
+			std::fill( g.begin(), g.end(), 0.0 );
+			g[0] = beta;
+			int j = 0;
+			for ( ; j < restart && iteration < maxIter; ++j ) {
+				++iteration;
+				prec.apply( &v[j][0], &z[j][0] );
+				op.apply( &z[j][0], &v[j + 1][0] );
+				// modified Gram-Schmidt
+				for ( int i = 0; i <= j; ++i ) {
+					h[i][j] = dot( v[j + 1], v[i] );
+					for ( std::size_t k = 0; k < n; ++k )
+						v[j + 1][k] -= h[i][j] * v[i][k];
+				}
+				h[j + 1][j] = std::sqrt( dot( v[j + 1], v[j + 1] ) );
+				if ( h[j + 1][j] != 0.0 )
+					for ( std::size_t k = 0; k < n; ++k )
+						v[j + 1][k] /= h[j + 1][j];
+				for ( int i = 0; i < j; ++i ) {
+					const double tmp = cs[i] * h[i][j] + sn[i] * h[i + 1][j];
+					h[i + 1][j] = -sn[i] * h[i][j] + cs[i] * h[i + 1][j];
+					h[i][j] = tmp;
+				}
+				const double denom = std::sqrt( h[j][j] * h[j][j] + h[j + 1][j] * h[j + 1][j] );
+				cs[j] = denom != 0.0 ? h[j][j] / denom : 1.0;
+				sn[j] = denom != 0.0 ? h[j + 1][j] / denom : 0.0;
+				h[j][j] = denom;
+				h[j + 1][j] = 0.0;
+				g[j + 1] = -sn[j] * g[j];
+				g[j] = cs[j] * g[j];
+				if ( verbose )
+					DSC_LOG_INFO << "\t FGMRES " << iteration << " residuum: " << std::fabs( g[j + 1] ) << std::endl;
+				if ( std::fabs( g[j + 1] ) <= limit ) {
+					++j;
+					break;
+				}
+			}
+			// x += Z y with H y = g
+			for ( int i = j - 1; i >= 0; --i ) {
+				y[i] = g[i];
+				for ( int k = i + 1; k < j; ++k )
+					y[i] -= h[i][k] * y[k];
+				y[i] = h[i][i] != 0.0 ? y[i] / h[i][i] : 0.0;
+			}
+			for ( int i = 0; i < j; ++i )
+				for ( std::size_t k = 0; k < n; ++k )
+					x[k] += y[i] * z[i][k];
+			op.apply( &x[0], &r[0] );
+			for ( std::size_t i = 0; i < n; ++i )
+				r[i] = b[i] - r[i];
+			beta = std::sqrt( dot( r, r ) );
+		}
+		return iteration;
+	}
+}
+
+/** \brief one Krylov iteration on the full velocity/pressure system instead of nested Schur complement solves
+	MINRES with the block diagonal preconditioner (Stokes) or FGMRES with the block triangular one (Oseen),
+	both only need approximations of A^{-1} and S^{-1}, see SaddlepointBlockPreconditioner.
+	"monolithic_method" (auto, minres, fgmres, direct) and "monolithic_precond" (auto, diagonal, triangular) override the choice.
+	direct (or constructing with direct = true, see SolverCallerProxy and direct_solver_max_dofs) assembles K once
+	and solves it with SparseDirectSolver, if K is singular (constant pressure) the first pressure dof is pinned and
+	the mean pressure removed afterwards. Factors above monolithic_direct_max_memory (MB) fall back to the Krylov method.
+	Serial only: the system is the local one and the Krylov methods' scalar products are not reduced.
+  **/
+template < class OseenLDGMethodImp >
+class MonolithicSaddlepointInverseOperator
+{
+	typedef OseenLDGMethodImp
+		OseenLDGMethodType;
+	typedef typename OseenLDGMethodType::DomainType
+		DomainType;
+	typedef typename OseenLDGMethodType::RangeType
+		RangeType;
+	typedef typename OseenLDGMethodType::Traits::DiscreteOseenFunctionWrapperType
+		DiscreteOseenFunctionWrapperType;
+	typedef typename DiscreteOseenFunctionWrapperType::DiscretePressureFunctionType
+		PressureDiscreteFunctionType;
+
+	public:
+		MonolithicSaddlepointInverseOperator( const bool with_oseen_discretization, const bool direct = false )
+			: with_oseen_discretization_( with_oseen_discretization ),
+			  direct_( direct )
+		{}
+
+		template <  class X_MatrixType,
+					class M_invers_matrixType,
+					class Y_MatrixType,
+					class O_MatrixType,
+					class E_MatrixType,
+					class R_MatrixType,
+					class Z_MatrixType,
+					class W_MatrixType,
+					class DiscreteSigmaFunctionType,
+					class DiscreteVelocityFunctionType,
+					class DiscretePressureFunctionType  >
+		SaddlepointInverseOperatorInfo solve( const DomainType& /*arg*/,
+					RangeType& dest,
+					X_MatrixType& Xmatrix,
+					M_invers_matrixType& Mmatrix,
+					Y_MatrixType& Ymatrix,
+					O_MatrixType& Omatrix,
+					E_MatrixType& Ematrix,
+					R_MatrixType& Rmatrix,
+					Z_MatrixType& Zmatrix,
+					W_MatrixType& Wmatrix,
+					const DiscreteSigmaFunctionType& rhs1,
+					const DiscreteVelocityFunctionType& rhs2,
+					const DiscretePressureFunctionType& rhs3 ) const
+		{
+			auto& logInfo = DSC_LOG_INFO;
+			const int solverVerbosity = DSC_CONFIG_GET( "solverVerbosity", 0 );
+			const int maxIter = DSC_CONFIG_GET( "maxIter", 500 );
+			const double relLimit = DSC_CONFIG_GET( "monolithic_relLimit", 1e-8 );
+			// absLimit is compared to squared norms by the nested solvers
+			const double absLimit = std::sqrt( DSC_CONFIG_GET( "absLimit", 1e-8 ) );
+			const int restart = DSC_CONFIG_GET( "monolithic_restart", 50 );
+
+			if ( dest.discretePressure().space().grid().comm().size() > 1 )
+				DUNE_THROW( InvalidStateException, "MonolithicSaddlepointInverseOperator is serial only" );
+
+			std::string method = direct_ ? std::string("direct") : DSC_CONFIG_GET( "monolithic_method", std::string("auto") );
+			if ( method != "auto" && method != "minres" && method != "fgmres" && method != "direct" )
+				DUNE_THROW( InvalidStateException, "unknown monolithic_method: " << method );
+
+			const SaddlepointSystem system( Xmatrix, Mmatrix, Ymatrix, Omatrix, Ematrix, Rmatrix, Zmatrix, Wmatrix );
+			const int nu = system.velocitySize();
+			const int np = system.pressureSize();
+			std::vector< double > b( nu + np );
+			system.rightHandSide( rhs1.leakPointer(), rhs2.leakPointer(), rhs3.leakPointer(), &b[0] );
+			std::vector< double > x( nu + np );
+			std::copy( dest.discreteVelocity().leakPointer(), dest.discreteVelocity().leakPointer() + nu, x.begin() );
+			std::copy( dest.discretePressure().leakPointer(), dest.discretePressure().leakPointer() + np, x.begin() + nu );
+
+			SaddlepointInverseOperatorInfo info;
+			bool pressure_pinned = false;
+			if ( method == "direct" ) {
+				logInfo << "Begin MonolithicSaddlepointInverseOperator (direct)" << std::endl;
+				if ( solveDirect( system, b, x, pressure_pinned ) )
+					info.iterations_outer_total = 0;
+				else
+					method = "auto";
+			}
+			if ( method != "direct" ) {
+				if ( method == "auto" )
+					method = with_oseen_discretization_ ? "fgmres" : "minres";
+				if ( method == "minres" && with_oseen_discretization_ )
+					DUNE_THROW( InvalidStateException, "MINRES needs a symmetric system, use monolithic_method: fgmres for Oseen" );
+				const bool use_minres = method == "minres";
+
+				std::string precond = DSC_CONFIG_GET( "monolithic_precond", std::string("auto") );
+				if ( precond == "auto" )
+					precond = use_minres ? "diagonal" : "triangular";
+				if ( precond == "triangular" && use_minres )
+					DUNE_THROW( InvalidStateException, "MINRES needs a symmetric preconditioner, use monolithic_precond: diagonal" );
+				const SaddlepointBlockPreconditioner::Type precond_type = precond == "triangular"
+						? SaddlepointBlockPreconditioner::Triangular
+						: SaddlepointBlockPreconditioner::Diagonal;
+				// inexact inner solves make the preconditioner nonlinear, MINRES only gets Jacobi
+				const int inner_iterations = use_minres ? 0 : DSC_CONFIG_GET( "monolithic_inner_iterations", 10 );
+				const double inner_reduction = DSC_CONFIG_GET( "monolithic_inner_reduction", 1e-2 );
+
+				logInfo << "Begin MonolithicSaddlepointInverseOperator (" << method << ", " << precond << ")" << std::endl;
+				const SaddlepointBlockPreconditioner preconditioner( system, precond_type, !with_oseen_discretization_,
+																	 inner_iterations, inner_reduction );
+				info.iterations_outer_total = use_minres
+						? Monolithic::minres( system, preconditioner, b, x, relLimit, absLimit, maxIter, solverVerbosity > 2 )
+						: Monolithic::fgmres( system, preconditioner, b, x, relLimit, absLimit, maxIter, restart, solverVerbosity > 2 );
+				preconditioner.fill( info );
+			}
+
+			std::copy( x.begin(), x.begin() + nu, dest.discreteVelocity().leakPointer() );
+			std::copy( x.begin() + nu, x.end(), dest.discretePressure().leakPointer() );
+			if ( with_oseen_discretization_ || pressure_pinned )
+				removeMeanPressure( dest.discretePressure() );
+
+			if( solverVerbosity > 0 )
+				logInfo << "\n #avg inner iter | #outer iter: "
+						<< info.iterations_inner_avg << " | " << info.iterations_outer_total << std::endl;
+			logInfo << "End MonolithicSaddlepointInverseOperator " << std::endl;
+			return info;
+		}
+
+	private:
+		//! \return false if the direct solver is not available for this system, x is untouched then
+		bool solveDirect( const SaddlepointSystem& system, std::vector< double >& b,
+						  std::vector< double >& x, bool& pressure_pinned ) const
+		{
+			auto& logInfo = DSC_LOG_INFO;
+			const double max_memory = DSC_CONFIG_GET( "monolithic_direct_max_memory", 1024.0 ) * 1024.0 * 1024.0;
+			CompressedRowStorage k;
+			system.assemble( k );
+			std::unique_ptr< SparseDirectSolver > direct( new SparseDirectSolver( k, max_memory ) );
+			if ( direct->factored() && direct->singular() && system.pressureSize() > 0 ) {
+				pressure_pinned = true;
+				system.assemble( k, true );
+				direct.reset( new SparseDirectSolver( k, max_memory ) );
+			}
+			if ( !direct->factored() ) {
+				logInfo << "monolithic direct solve: factors need an estimated " << direct->memoryEstimate() / ( 1024.0 * 1024.0 )
+						<< " MB (monolithic_direct_max_memory), using the Krylov method" << std::endl;
+				pressure_pinned = false;
+				return false;
+			}
+			if ( pressure_pinned )
+				b[ system.velocitySize() ] = 0.0;
+			direct->apply( &b[0], &x[0] );
+			logInfo << "monolithic direct solve: " << k.rows() << " dofs, "
+					<< direct->memoryEstimate() / ( 1024.0 * 1024.0 ) << " MB factors"
+					<< ( pressure_pinned ? ", pressure dof 0 pinned" : "" ) << std::endl;
+			return true;
+		}
+
+		//! same mean value correction as BiCgStabSaddlepointInverseOperator
+		void removeMeanPressure( PressureDiscreteFunctionType& pressure ) const
+		{
+			const double meanPressure_discrete = DSFe::meanValue( pressure, pressure.space() );
+			typedef typename OseenLDGMethodType::Traits::DiscreteModelType::Traits::PressureFunctionSpaceType
+					PressureFunctionSpaceType;
+			PressureFunctionSpaceType pressureFunctionSpace;
+			const DSFe::ConstantFunction<PressureFunctionSpaceType> vol(pressureFunctionSpace, meanPressure_discrete );
+			PressureDiscreteFunctionType tmp( "mean", pressure.space() );
+			DSFe::BetterL2Projection::project( 0.0, vol, tmp );
+			pressure -= tmp;
+		}
+
+		const bool with_oseen_discretization_;
+		const bool direct_;
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVERS_MONOLITHIC_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
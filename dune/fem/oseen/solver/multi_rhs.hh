@@ -0,0 +1,309 @@
+#ifndef DUNE_OSEEN_SOLVERS_MULTI_RHS_HH
+#define DUNE_OSEEN_SOLVERS_MULTI_RHS_HH
+
+#include <dune/fem/oseen/solver/schurkomplement.hh>
+#include <dune/fem/oseen/solver/block_krylov.hh>
+#include <dune/fem/oseen/assembler/compressed_rowstorage.hh>
+#include <dune/stuff/fem/customprojection.hh>
+#include <dune/stuff/fem/functions/integrals.hh>
+#include <dune/stuff/fem/functions/analytical.hh>
+#include <dune/stuff/common/logging.hh>
+#include <dune/stuff/common/profiler.hh>
+#include <dune/stuff/common/parameter/configcontainer.hh>
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+namespace Dune {
+namespace Oseen {
+
+/** \brief Saddlepoint solver for many right hand sides of one assembled system
+	Solves the same Schur complement system as SaddlepointInverseOperator (Stokes) resp.
+	BiCgStabSaddlepointInverseOperator (Oseen), but for all right hand sides at once:
+	\f$ (R - E A^{-1} Z) p = -( E A^{-1} F + H_3 ) \f$, \f$ u = A^{-1}( F - Z p ) \f$,
+	with \f$ A = Y + O - X M^{-1} W \f$ and \f$ F = H_2 - X M^{-1} H_1 \f$.
+	The matrices are copied to CompressedRowStorage once, every operator application is a SpMM
+	over all right hand sides and outer and inner solves use blockCG (Stokes, one Krylov space shared by all right hand sides)
+	or lockstepBiCGStab (Oseen, one Krylov space per right hand side, only the operator sweeps are shared).
+	Unlike the scalar solvers this does not modify the passed matrices, so it can be reused.
+  **/
+template < class OseenLDGMethodImp >
+class MultiRhsSaddlepointInverseOperator
+{
+	typedef OseenLDGMethodImp
+		OseenLDGMethodType;
+	typedef typename OseenLDGMethodType::RangeType
+		RangeType;
+	typedef typename OseenLDGMethodType::Traits::DiscreteOseenFunctionWrapperType
+		DiscreteOseenFunctionWrapperType;
+	typedef typename DiscreteOseenFunctionWrapperType::DiscretePressureFunctionType
+		PressureDiscreteFunctionType;
+	typedef typename DiscreteOseenFunctionWrapperType::DiscreteVelocityFunctionType
+		VelocityDiscreteFunctionType;
+
+	//! \f$ A = Y + O - X M^{-1} W \f$ on interleaved velocity blocks
+	class A_BlockOperator {
+		public:
+			A_BlockOperator( const MultiRhsSaddlepointInverseOperator& parent )
+				: parent_( parent )
+			{}
+
+			void multBlock( const double* x, double* ret, const int count ) const
+			{
+				const int sigma_size = parent_.w_.rows();
+				sig_tmp1_.resize( sigma_size * count );
+				sig_tmp2_.resize( sigma_size * count );
+				parent_.w_.multBlock( x, &sig_tmp1_[0], count );
+				parent_.m_inv_.multBlock( &sig_tmp1_[0], &sig_tmp2_[0], count );
+				parent_.x_.multBlock( &sig_tmp2_[0], ret, count );
+				const int size = parent_.y_.rows() * count;
+				for ( int i = 0; i < size; ++i )
+					ret[ i ] = -ret[ i ];
+				parent_.y_.multAddBlock( x, ret, count );
+				parent_.o_.multAddBlock( x, ret, count );
+			}
+
+		private:
+			const MultiRhsSaddlepointInverseOperator& parent_;
+			mutable std::vector< double > sig_tmp1_;
+			mutable std::vector< double > sig_tmp2_;
+	};
+
+	//! \f$ S = R - E A^{-1} Z \f$ on interleaved pressure blocks, every application does one block inner solve
+	class SchurBlockOperator {
+		public:
+			SchurBlockOperator( const MultiRhsSaddlepointInverseOperator& parent )
+				: parent_( parent ),
+				inner_solves_( 0 ),
+				inner_iterations_total_( 0 ),
+				inner_iterations_min_( std::numeric_limits< int >::max() ),
+				inner_iterations_max_( 0 )
+			{}
+
+			void multBlock( const double* x, double* ret, const int count ) const
+			{
+				const int velocity_size = parent_.y_.rows();
+				MultiVector z_x( velocity_size, count );
+				MultiVector a_inv_z_x( velocity_size, count );
+				parent_.z_.multBlock( x, z_x.data(), count );
+				record( parent_.innerSolve( z_x, a_inv_z_x ) );
+				parent_.e_.multBlock( a_inv_z_x.data(), ret, count );
+				const int size = parent_.r_.rows() * count;
+				for ( int i = 0; i < size; ++i )
+					ret[ i ] = -ret[ i ];
+				parent_.r_.multAddBlock( x, ret, count );
+			}
+
+			void record( const BlockKrylovInfo& info ) const
+			{
+				++inner_solves_;
+				inner_iterations_total_ += info.maxIterations();
+				inner_iterations_min_ = std::min( inner_iterations_min_, info.minIterations() );
+				inner_iterations_max_ = std::max( inner_iterations_max_, info.maxIterations() );
+			}
+
+			void fill( SaddlepointInverseOperatorInfo& info ) const
+			{
+				info.iterations_inner_avg = inner_solves_ ? inner_iterations_total_ / double( inner_solves_ ) : 0.0;
+				info.iterations_inner_min = inner_solves_ ? inner_iterations_min_ : 0;
+				info.iterations_inner_max = inner_iterations_max_;
+			}
+
+		private:
+			const MultiRhsSaddlepointInverseOperator& parent_;
+			mutable int inner_solves_;
+			mutable int inner_iterations_total_;
+			mutable int inner_iterations_min_;
+			mutable int inner_iterations_max_;
+	};
+
+	public:
+		template <  class X_MatrixType,
+					class M_invers_matrixType,
+					class Y_MatrixType,
+					class O_MatrixType,
+					class E_MatrixType,
+					class R_MatrixType,
+					class Z_MatrixType,
+					class W_MatrixType >
+		MultiRhsSaddlepointInverseOperator( const bool with_oseen_discretization,
+											const X_MatrixType& Xmatrix,
+											const M_invers_matrixType& Mmatrix,
+											const Y_MatrixType& Ymatrix,
+											const O_MatrixType& Omatrix,
+											const E_MatrixType& Ematrix,
+											const R_MatrixType& Rmatrix,
+											const Z_MatrixType& Zmatrix,
+											const W_MatrixType& Wmatrix )
+			: with_oseen_discretization_( with_oseen_discretization ),
+			inner_absLimit_( DSC_CONFIG_GET( "inner_absLimit", 1e-8 ) ),
+			outer_absLimit_( DSC_CONFIG_GET( "absLimit", 1e-8 ) ),
+			maxIter_( DSC_CONFIG_GET( "maxIter", 500 ) ),
+			inner_maxIter_( DSC_CONFIG_GET( "multi_rhs_inner_maxIter", 2000 ) ),
+			solverVerbosity_( DSC_CONFIG_GET( "solverVerbosity", 0 ) )
+		{
+			DSC::Profiler::ScopedTiming copy_time("multi_rhs_copy");
+			x_.assign( Xmatrix.matrix() );
+			m_inv_.assign( Mmatrix.matrix() );
+			y_.assign( Ymatrix.matrix() );
+			o_.assign( Omatrix.matrix() );
+			e_.assign( Ematrix.matrix() );
+			r_.assign( Rmatrix.matrix() );
+			z_.assign( Zmatrix.matrix() );
+			w_.assign( Wmatrix.matrix() );
+		}
+
+		/** solves for dests[k] with right hand sides rhs1[k], rhs2[k], rhs3[k]
+			all vectors need to have the same length, the initial guess is zero.
+		  **/
+		template <  class DiscreteSigmaFunctionType,
+					class DiscreteVelocityFunctionType,
+					class DiscretePressureFunctionType >
+		SaddlepointInverseOperatorInfo solve( std::vector< RangeType* >& dests,
+											  const std::vector< const DiscreteSigmaFunctionType* >& rhs1,
+											  const std::vector< const DiscreteVelocityFunctionType* >& rhs2,
+											  const std::vector< const DiscretePressureFunctionType* >& rhs3 ) const
+		{
+			DSC::Profiler::ScopedTiming solver_time("multi_rhs_solver");
+			const int count = dests.size();
+			assert( int(rhs1.size()) == count && int(rhs2.size()) == count && int(rhs3.size()) == count );
+			SaddlepointInverseOperatorInfo info;
+			if ( count == 0 )
+				return info;
+			auto& logInfo = DSC_LOG_INFO;
+			logInfo << "Begin MultiRhsSaddlepointInverseOperator with " << count << " right hand sides" << std::endl;
+
+			const int sigma_size = w_.rows();
+			const int velocity_size = y_.rows();
+			const int pressure_size = r_.rows();
+			MultiVector H1( sigma_size, count );
+			MultiVector F( velocity_size, count );
+			MultiVector H3( pressure_size, count );
+			for ( int k = 0; k < count; ++k ) {
+				H1.setColumn( k, rhs1[k]->leakPointer() );
+				F.setColumn( k, rhs2[k]->leakPointer() );
+				H3.setColumn( k, rhs3[k]->leakPointer() );
+			}
+
+			// F = H2 - X M^{-1} H1
+			{
+				MultiVector m_inv_h1( sigma_size, count );
+				MultiVector x_m_inv_h1( velocity_size, count );
+				m_inv_.multBlock( H1.data(), m_inv_h1.data(), count );
+				x_.multBlock( m_inv_h1.data(), x_m_inv_h1.data(), count );
+				F.axpy( std::vector< double >( count, -1.0 ), x_m_inv_h1, std::vector< bool >( count, true ) );
+			}
+
+			// schur_f = - ( E A^{-1} F + H3 )
+			SchurBlockOperator schur_op( *this );
+			MultiVector a_inv_f( velocity_size, count );
+			schur_op.record( innerSolve( F, a_inv_f ) );
+			MultiVector schur_f( pressure_size, count );
+			e_.multBlock( a_inv_f.data(), schur_f.data(), count );
+			schur_f.axpy( std::vector< double >( count, 1.0 ), H3, std::vector< bool >( count, true ) );
+			for ( int i = 0; i < pressure_size * count; ++i )
+				schur_f.data()[i] = -schur_f.data()[i];
+
+			MultiVector pressure( pressure_size, count );
+			const BlockKrylovInfo outer = with_oseen_discretization_
+					? lockstepBiCGStab( schur_op, schur_f, pressure, outer_absLimit_, maxIter_, solverVerbosity_ > 2 )
+					: blockCG( schur_op, schur_f, pressure, outer_absLimit_, maxIter_, solverVerbosity_ > 2 );
+
+			// u = A^{-1} ( F - Z p )
+			MultiVector z_p( velocity_size, count );
+			z_.multBlock( pressure.data(), z_p.data(), count );
+			F.axpy( std::vector< double >( count, -1.0 ), z_p, std::vector< bool >( count, true ) );
+			MultiVector velocity( velocity_size, count );
+			schur_op.record( innerSolve( F, velocity ) );
+
+			for ( int k = 0; k < count; ++k ) {
+				PressureDiscreteFunctionType& dest_pressure = dests[k]->discretePressure();
+				pressure.getColumn( k, dest_pressure.leakPointer() );
+				velocity.getColumn( k, dests[k]->discreteVelocity().leakPointer() );
+				if ( with_oseen_discretization_ )
+					removeMeanPressure( dest_pressure );
+			}
+
+			schur_op.fill( info );
+			info.iterations_outer_total = outer.maxIterations();
+			info.max_inner_accuracy = inner_absLimit_;
+			if( solverVerbosity_ > 0 )
+				logInfo << "\n #avg inner iter | #outer iter (max over rhs) | #outer sweeps: "
+						<< info.iterations_inner_avg << " | " << outer.maxIterations() << " | " << outer.sweeps << std::endl;
+			logInfo << "End MultiRhsSaddlepointInverseOperator " << std::endl;
+			return info;
+		}
+
+	private:
+		BlockKrylovInfo innerSolve( const MultiVector& rhs, MultiVector& dest ) const
+		{
+			const A_BlockOperator a_op( *this );
+			dest.clear();
+			return with_oseen_discretization_
+					? lockstepBiCGStab( a_op, rhs, dest, inner_absLimit_, inner_maxIter_, solverVerbosity_ > 5 )
+					: blockCG( a_op, rhs, dest, inner_absLimit_, inner_maxIter_, solverVerbosity_ > 5 );
+		}
+
+		//! same mean value correction as BiCgStabSaddlepointInverseOperator
+		void removeMeanPressure( PressureDiscreteFunctionType& pressure ) const
+		{
+			const double meanPressure_discrete = DSFe::meanValue( pressure, pressure.space() );
+			typedef typename OseenLDGMethodType::Traits::DiscreteModelType::Traits::PressureFunctionSpaceType
+					PressureFunctionSpaceType;
+			PressureFunctionSpaceType pressureFunctionSpace;
+			const DSFe::ConstantFunction<PressureFunctionSpaceType> vol(pressureFunctionSpace, meanPressure_discrete );
+			PressureDiscreteFunctionType tmp( "mean", pressure.space() );
+			DSFe::BetterL2Projection::project( 0.0, vol, tmp );
+			pressure -= tmp;
+		}
+
+		const bool with_oseen_discretization_;
+		const double inner_absLimit_;
+		const double outer_absLimit_;
+		const int maxIter_;
+		const int inner_maxIter_;
+		const int solverVerbosity_;
+		CompressedRowStorage x_;
+		CompressedRowStorage m_inv_;
+		CompressedRowStorage y_;
+		CompressedRowStorage o_;
+		CompressedRowStorage e_;
+		CompressedRowStorage r_;
+		CompressedRowStorage z_;
+		CompressedRowStorage w_;
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVERS_MULTI_RHS_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
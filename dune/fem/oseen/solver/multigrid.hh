@@ -0,0 +1,241 @@
+#ifndef DUNE_OSEEN_SOLVERS_MULTIGRID_HH
+#define DUNE_OSEEN_SOLVERS_MULTIGRID_HH
+
+#include <cmake_config.h>
+
+#include <dune/fem/oseen/assembler/compressed_rowstorage.hh>
+#include <dune/fem/oseen/solver/block_smoother.hh>
+#include <dune/fem/oseen/solver/chebyshev.hh>
+#include <dune/fem/oseen/solver/direct.hh>
+#include <dune/stuff/common/logging.hh>
+#include <dune/stuff/common/parameter/configcontainer.hh>
+#include <dune/common/exceptions.hh>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <algorithm>
+
+namespace Dune {
+namespace Oseen {
+
+/** \brief multigrid cycle with given prolongations, one cycle per preconditioner call
+	prolongations[l] maps level l + 1 (coarser) to level l, level 0 being the matrix the cycle preconditions.
+	Coarse operators are Galerkin products P^T A P, which for nested DG spaces are the coarse discretisation
+	of the fine bilinear form. Smoothers work on element blocks (block_sizes[l] dofs per element on level l):
+	symmetric block Gauss-Seidel (the robust choice for the convective Oseen A), damped block Jacobi or a
+	ChebyshevIteration polynomial in block Jacobi (threaded and free of inner products), all applied to the residual
+	so they can start from any iterate. The coarsest level is solved with SparseDirectSolver.
+	The hierarchies come from DGTransfer::buildGeometric (grid levels) and PolynomialHierarchy (velocity orders).
+  **/
+class Multigrid
+{
+	public:
+		struct Parameters {
+			std::string smoother;
+			int smoothing_steps;
+			double smoother_damping;
+			//! 1: V-cycle, 2: W-cycle; the Galerkin coarse operators inherit the fine penalty, V-cycles then degrade with the number of levels
+			int cycle_index;
+
+			Parameters()
+				: smoother( DSC_CONFIG_GET( "mg_smoother", std::string("block_sgs") ) ),
+				smoothing_steps( DSC_CONFIG_GET( "mg_smoothing_steps", 1 ) ),
+				smoother_damping( DSC_CONFIG_GET( "mg_smoother_damping", 0.7 ) ),
+				cycle_index( DSC_CONFIG_GET( "mg_cycle_index", 2 ) )
+			{
+				if ( smoother != "block_sgs" && smoother != "block_jacobi" && smoother != "chebyshev" )
+					DUNE_THROW( InvalidStateException, "unknown mg_smoother: " << smoother );
+			}
+		};
+
+		Multigrid( const CompressedRowStorage& matrix,
+				   const std::vector< CompressedRowStorage >& prolongations,
+				   const std::vector< int >& block_sizes,
+				   const Parameters& parameters = Parameters() )
+			: parameters_( parameters )
+		{
+			assert( block_sizes.size() == prolongations.size() + 1 );
+			levels_.resize( prolongations.size() + 1 );
+			levels_[0].a = matrix;
+			for ( std::size_t l = 0; l < levels_.size(); ++l ) {
+				Level& level = levels_[l];
+				if ( l + 1 < levels_.size() ) {
+					level.p = prolongations[l];
+					if ( level.p.rows() != level.a.rows() )
+						DUNE_THROW( InvalidStateException, "Multigrid: prolongation " << l << " does not match the level's matrix" );
+					transpose( level.p, level.r );
+					CompressedRowStorage ap;
+					multiply( level.a, level.p, ap );
+					multiply( level.r, ap, levels_[ l + 1 ].a );
+					if ( parameters_.smoother == "block_sgs" )
+						level.sgs.reset( new SymmetricBlockGaussSeidel( level.a, block_sizes[l] ) );
+					else if ( parameters_.smoother == "chebyshev" )
+						level.chebyshev.reset( new ChebyshevIteration( level.a, block_sizes[l] ) );
+					else
+						level.jacobi.assign( level.a, block_sizes[l] );
+				}
+				const int n = level.a.rows();
+				level.x.assign( n, 0.0 );
+				level.b.assign( n, 0.0 );
+				level.res.assign( n, 0.0 );
+				level.correction.assign( n, 0.0 );
+			}
+			const double max_memory = DSC_CONFIG_GET( "mg_coarse_max_memory", 256.0 ) * 1024.0 * 1024.0;
+			coarse_.reset( new SparseDirectSolver( levels_.back().a, max_memory ) );
+			if ( !coarse_->factored() )
+				DUNE_THROW( InvalidStateException, "Multigrid: coarsest level (" << levels_.back().a.rows()
+							<< " dofs) too large for a direct solve, add levels or raise mg_coarse_max_memory" );
+			DSC_LOG_INFO << "Multigrid: " << levels_.size() << " levels, " << levels_.back().a.rows()
+						 << " coarse dofs, operator complexity " << operatorComplexity() << std::endl;
+		}
+
+		~Multigrid()
+		{
+			double bytes = 0.0;
+			long steps = 0;
+			for ( std::size_t l = 0; l < levels_.size(); ++l ) {
+				if ( !levels_[l].chebyshev )
+					continue;
+				bytes += levels_[l].chebyshev->bytesMoved();
+				steps += levels_[l].chebyshev->steps();
+			}
+			if ( steps > 0 )
+				DSC_LOG_INFO << "Multigrid: " << steps << " chebyshev smoothing steps, " << bytes * 1e-9 << " GB at "
+							 << smootherBandwidth() << " GB/s" << std::endl;
+		}
+
+		//! z = cycle( r ), zero initial guess
+		void apply( const double* r, double* z ) const
+		{
+			Level& fine = levels_[0];
+			std::copy( r, r + fine.a.rows(), fine.b.begin() );
+			cycle( 0 );
+			std::copy( fine.x.begin(), fine.x.end(), z );
+		}
+
+		int levels() const { return levels_.size(); }
+
+		//! sum of nonzeros on all levels over nonzeros of the finest
+		double operatorComplexity() const
+		{
+			double sum = 0.0;
+			for ( std::size_t l = 0; l < levels_.size(); ++l )
+				sum += levels_[l].a.nonZeros();
+			return levels_[0].a.nonZeros() == 0 ? 1.0 : sum / levels_[0].a.nonZeros();
+		}
+
+		//! GB/s of the chebyshev smoothers over all levels, -1 for other smoothers
+		double smootherBandwidth() const
+		{
+			double bytes = 0.0;
+			double seconds = 0.0;
+			for ( std::size_t l = 0; l < levels_.size(); ++l ) {
+				if ( !levels_[l].chebyshev )
+					continue;
+				bytes += levels_[l].chebyshev->bytesMoved();
+				seconds += levels_[l].chebyshev->seconds();
+			}
+			return seconds > 0.0 ? bytes / seconds * 1e-9 : -1.0;
+		}
+
+	private:
+		struct Level {
+			CompressedRowStorage a;
+			CompressedRowStorage p;
+			CompressedRowStorage r;
+			BlockDiagonalInverse jacobi;
+			std::shared_ptr< SymmetricBlockGaussSeidel > sgs;
+			std::shared_ptr< ChebyshevIteration > chebyshev;
+			std::vector< double > x;
+			std::vector< double > b;
+			std::vector< double > res;
+			std::vector< double > correction;
+		};
+
+		//! level.x = cycle( level.b ), zero initial guess
+		void cycle( const std::size_t l ) const
+		{
+			Level& level = levels_[l];
+			if ( l + 1 == levels_.size() ) {
+				coarse_->apply( &level.b[0], &level.x[0] );
+				return;
+			}
+			std::fill( level.x.begin(), level.x.end(), 0.0 );
+			for ( int step = 0; step < parameters_.smoothing_steps; ++step )
+				smooth( level );
+			Level& coarse = levels_[ l + 1 ];
+			const int visits = l + 2 == levels_.size() ? 1 : parameters_.cycle_index;
+			for ( int visit = 0; visit < visits; ++visit ) {
+				residual( level );
+				level.r.mult( &level.res[0], &coarse.b[0] );
+				cycle( l + 1 );
+				level.p.multAdd( &coarse.x[0], &level.x[0] );
+			}
+			for ( int step = 0; step < parameters_.smoothing_steps; ++step )
+				smooth( level );
+		}
+
+		void residual( Level& level ) const
+		{
+			const int n = level.a.rows();
+			level.a.mult( &level.x[0], &level.res[0] );
+			for ( int i = 0; i < n; ++i )
+				level.res[i] = level.b[i] - level.res[i];
+		}
+
+		//! x += S ( b - A x )
+		void smooth( Level& level ) const
+		{
+			residual( level );
+			if ( level.sgs || level.chebyshev ) {
+				if ( level.sgs )
+					level.sgs->apply( &level.res[0], &level.correction[0] );
+				else
+					level.chebyshev->apply( &level.res[0], &level.correction[0] );
+				const int n = level.a.rows();
+				for ( int i = 0; i < n; ++i )
+					level.x[i] += level.correction[i];
+			}
+			else
+				level.jacobi.applyAdd( &level.res[0], &level.x[0], parameters_.smoother_damping );
+		}
+
+		const Parameters parameters_;
+		mutable std::vector< Level > levels_;
+		std::unique_ptr< SparseDirectSolver > coarse_;
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVERS_MULTIGRID_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
@@ -1,6 +1,7 @@
 #ifndef DUNE_OSEEN_NEW_BICGSTAB_HH
 #define DUNE_OSEEN_NEW_BICGSTAB_HH
 
+#include <dune/fem/oseen/solver/schur_preconditioner.hh>
 #include <dune/stuff/common/print.hh>
 #include <dune/stuff/common/logging.hh>
 
@@ -18,16 +19,19 @@ public:
 	typedef std::pair < int , double >
 		ReturnValueType;
 
+	//! preconditioner is applied from the right, if given
     NewBicgStab(const OperatorType& op,
 				const double relLimit,
 				const double absLimit,
 				const unsigned int max_iter,
-                const unsigned int solverVerbosity )
+                const unsigned int solverVerbosity,
+				const Oseen::VectorPreconditionerInterface* preconditioner = 0 )
 		: operator_(op),
 		  relLimit_(relLimit),
 		  absLimit_(absLimit),
 		  max_iter_(max_iter),
-          solverVerbosity_(solverVerbosity)
+          solverVerbosity_(solverVerbosity),
+		  preconditioner_(preconditioner)
 	{}
 
 	//! for bfg interface compliance
@@ -51,6 +55,11 @@ public:
 		PressureDiscreteFunctionType t( "t", dest.space() );
 		PressureDiscreteFunctionType v( "v", dest.space() );
 		PressureDiscreteFunctionType search_direction( "search_direction", dest.space() );
+		PressureDiscreteFunctionType precond_direction( "precond_direction", dest.space() );
+		PressureDiscreteFunctionType precond_s( "precond_s", dest.space() );
+		// the (preconditioned) vectors S is applied to
+		const PressureDiscreteFunctionType& direction = preconditioner_ ? precond_direction : search_direction;
+		const PressureDiscreteFunctionType& s_direction = preconditioner_ ? precond_s : s;
 
 		// r^0 = - S * p^0 + rhs
 		operator_.apply( dest, residuum );
@@ -95,7 +104,9 @@ public:
 				search_direction += residuum;
 			}
 
-			operator_.apply( search_direction, v );//v=S*p
+			if ( preconditioner_ )
+				preconditioner_->precondition( search_direction.leakPointer(), precond_direction.leakPointer() );
+			operator_.apply( direction, v );//v=S*P^{-1}p
 			alpha = rho/ residuum_T.scalarProductDofs( v );
 			assert( !std::isnan(alpha) );
 			assert( std::isfinite(alpha) );
@@ -104,19 +115,21 @@ public:
 			s.axpy( -alpha, v );
 			const double s_norm = std::sqrt( s.scalarProductDofs( s ) );
 			if ( s_norm < absLimit_ ) {
-				dest.axpy( alpha, search_direction );
+				dest.axpy( alpha, direction );
 				logDebug << boost::format( "%s: iter %i\taborted: s: %e") % cg_name % iteration % s_norm << std::endl;
 				break;
 			}
-			operator_.apply( s, t );
+			if ( preconditioner_ )
+				preconditioner_->precondition( s.leakPointer(), precond_s.leakPointer() );
+			operator_.apply( s_direction, t );
 			omega = t.scalarProductDofs( s ) / t.scalarProductDofs( t );
 
 			if ( solverVerbosity_ > 3 )
                 DSC::printFunctionMinMax( logDebug, search_direction );
-			dest.axpy( alpha, search_direction );
+			dest.axpy( alpha, direction );
 			if ( solverVerbosity_ > 3 )
                 DSC::printFunctionMinMax( logDebug, dest );
-			dest.axpy( omega, s );
+			dest.axpy( omega, s_direction );
 
 			residuum.assign( s );
 			residuum.axpy( - omega, t );
@@ -146,6 +159,7 @@ public:
 	const double absLimit_;
 	const unsigned int max_iter_;
 	const unsigned int solverVerbosity_;
+	const Oseen::VectorPreconditionerInterface* preconditioner_;
 };
 
 } //namespace Dune
@@ -2,6 +2,8 @@
 #define DUNE_OSEEN_SOLVERS_SADDLE_POINT_HH
 
 #include <dune/fem/oseen/solver/schurkomplement.hh>
+#include <dune/fem/oseen/solver/block_smoother.hh>
+#include <dune/fem/oseen/solver/lanczos.hh>
 
 namespace Dune {
 
@@ -11,6 +13,12 @@ namespace Dune {
 		Dune solver. The outer iteration is a implementation of the CG algorithm as described in\n
 		Kuhnibert
 		Optionally the BFG scheme as described in YADDA is uesd to control the inner solver tolerance.
+		Given the (1/mu scaled) pressure mass matrix the outer CG is preconditioned with its exact block inverse,
+		for Stokes that makes the outer iteration count independent of the mesh size.
+		The outer CG coefficients give Lanczos estimates of the extreme eigenvalues of the (preconditioned) Schur
+		complement (Oseen::LanczosEstimate), they are reported in the info and kept for later solves. With
+		outer_stopping: error the iteration stops once the estimated error \f$ \|r\|_{S_p^{-1}} / \lambda_{min} \f$
+		instead of the residual drops below sqrt(absLimit), lambda_min taken from the previous solve and the current one.
 		/todo get references in doxygen right
 	**/
 	template < class OseenLDGMethodImp >
@@ -37,6 +45,19 @@ namespace Dune {
 
 
 	  public:
+		SaddlepointInverseOperator()
+			: use_mass_preconditioner_( false )
+		{}
+
+		//! a null pressure_mass leaves the outer CG unpreconditioned
+		template < class PressureMassMatrixObjectType >
+		explicit SaddlepointInverseOperator( const PressureMassMatrixObjectType* pressure_mass )
+			: use_mass_preconditioner_( pressure_mass != nullptr )
+		{
+			if ( use_mass_preconditioner_ )
+				pressure_mass_.assign( pressure_mass->matrix() );
+		}
+
 		/** takes raw matrices and right hand sides from pass as input, executes nested cg algorithm and outputs solution
 		*/
 		template <  class X_MatrixType,
@@ -80,6 +101,14 @@ namespace Dune {
 
 			const double tau = DSC_CONFIG_GET( "bfg-tau", 0.1 );
 			const bool do_bfg = DSC_CONFIG_GET( "do-bfg", true );
+			// budget: Oseen::InnerToleranceController, bfg: the fixed tau rule of the precond. paper
+			const std::string inner_control = DSC_CONFIG_GET( "inner_tolerance_control", std::string("bfg") );
+			if ( inner_control != "budget" && inner_control != "bfg" )
+				DUNE_THROW( InvalidStateException, "unknown inner_tolerance_control: " << inner_control );
+			const bool use_controller = do_bfg && inner_control == "budget";
+			const std::string outer_stopping = DSC_CONFIG_GET( "outer_stopping", std::string("residual") );
+			if ( outer_stopping != "residual" && outer_stopping != "error" )
+				DUNE_THROW( InvalidStateException, "unknown outer_stopping: " << outer_stopping );
 			logInfo.resume();
 			logInfo << "Begin SaddlePointInverseOperator " << std::endl;
 
@@ -92,16 +121,15 @@ namespace Dune {
             const auto& m_inv_mat  = Mmatrix;
             const auto& y_mat      = Ymatrix;
             const auto& o_mat      = Omatrix;
-            const auto& b_t_mat = Ematrix; //! renamed
+            const auto& e_mat = Ematrix; //! B_t = -E, the sign is folded into the updates below
             const auto& c_mat      = Rmatrix; //! renamed
             const auto& b_mat      = Zmatrix; //! renamed
             const auto& w_mat      = Wmatrix;
 
 	/*** making our matrices kuhnibert compatible ****/
 			//rhs1 = M^{-1} * rhs1
-			//B_t = -B_t
+			//E is left untouched, so the caller (e.g. autotune trials) can solve with it again
             const double m_scale = m_inv_mat.matrix()(0,0);
-            b_t_mat.matrix().scale( -1 ); //since B_t = -E
 			DiscreteSigmaFunctionType rhs1 = rhs1_orig;
 			rhs1 *=  m_scale;
 
@@ -124,9 +152,14 @@ namespace Dune {
 				ReturnValueType;
 			ReturnValueType a_solver_info;
 
-			//the bfg scheme uses the outer acc. as a base
-            double current_inner_accuracy = do_bfg ? tau * outer_absLimit : inner_absLimit;
+			//the bfg scheme uses the outer acc. as a base, the controller does the first and last solve at inner_absLimit
+            double current_inner_accuracy = ( do_bfg && !use_controller ) ? tau * outer_absLimit : inner_absLimit;
             double max_inner_accuracy = current_inner_accuracy;
+			// delta and outer_absLimit are squared norms, tau caps the relaxed tolerances
+			Oseen::InnerToleranceController inner_controller( std::sqrt( outer_absLimit ),
+															  DSC_CONFIG_GET( "inner_tolerance_min", 1e-12 ), tau,
+															  DSC_CONFIG_GET( "inner_tolerance_safety", 0.5 ) );
+			std::vector< Oseen::OuterStepRecord > outer_steps;
 
             A_InverseOperatorType innerCGSolverWrapper( w_mat, m_inv_mat, x_mat, y_mat,
 														   o_mat, rhs1.space(),rhs2.space(), relLimit,
@@ -157,41 +190,105 @@ namespace Dune {
 
 			PressureDiscreteFunctionType d( "d", pressure.space() );
 			PressureDiscreteFunctionType h( "h", pressure.space() );
+			// z = S_p^{-1} r, only differs from the residuum with the mass preconditioner
+			PressureDiscreteFunctionType precond_residuum( "precond_residuum", pressure.space() );
+			Oseen::BlockDiagonalInverse mass_inverse;
+			if ( use_mass_preconditioner_ )
+				mass_inverse.assign( pressure_mass_, pressure.space().mapper().maxNumDofs() );
+			const auto precondition = [&]() {
+				if ( use_mass_preconditioner_ )
+					mass_inverse.apply( residuum.leakPointer(), precond_residuum.leakPointer() );
+				else
+					precond_residuum.assign( residuum );
+			};
+
+			const auto computeResiduum = [&]() {
+				// u^0 = A^{-1} ( F - B * p^0 ) (3.95a)
+				F.assign( rhs2 );
+				tmp1.clear();
+				b_mat.apply( pressure, tmp1 );
+				F-=tmp1; // F = rhs2 - X * M^{-1} * rhs1 - B * p
+				innerCGSolverWrapper.apply(F,velocity);
 
-			// u^0 = A^{-1} ( F - B * p^0 ) (3.95a)
-			b_mat.apply( pressure, tmp1 );
-			F-=tmp1; // F = rhs2 - X * M^{-1} * rhs1 - B * p
-			innerCGSolverWrapper.apply(F,velocity);
-
-			// r^0 = G - B_t * u^0 + C * p^0
-			b_t_mat.apply( velocity, tmp2 );
-			residuum -= tmp2;
-			tmp2.clear();
-			c_mat.apply( pressure, tmp2 );
-			residuum += tmp2;
+				// r^0 = G - B_t * u^0 + C * p^0 = G + E * u^0 + C * p^0
+				residuum.assign( rhs3 );
+				tmp2.clear();
+				e_mat.apply( velocity, tmp2 );
+				residuum += tmp2;
+				tmp2.clear();
+				c_mat.apply( pressure, tmp2 );
+				residuum += tmp2;
+			};
+			computeResiduum();
 
-			// d^0 = r^0
-			d.assign( residuum );
+			// d^0 = z^0 = S_p^{-1} r^0
+			precondition();
+			d.assign( precond_residuum );
 
 			delta = residuum.scalarProductDofs( residuum );
-			while( (delta > outer_absLimit ) && (iteration++ < maxIter ) ) {
+			// equals delta without preconditioner
+			double delta_precond = residuum.scalarProductDofs( precond_residuum );
+
+			// the outer CG coefficients, recording stops at a restart since that starts a new Krylov space
+			Oseen::LanczosEstimate outer_spectrum;
+			bool record_spectrum = true;
+			const std::string spectrum_name = use_mass_preconditioner_ ? "uzawa_mass" : "uzawa";
+			double previous_min = -1.0, previous_max = -1.0;
+			const bool have_previous = Oseen::SpectralEstimates::instance().lookup( spectrum_name, previous_min, previous_max );
+			// ||e||_{S_p}^2 <= <r, S_p^{-1} r> / lambda_min^2, the smaller of both estimates is the safer one
+			const auto outerConverged = [&]() {
+				if ( outer_stopping == "residual" )
+					return delta <= outer_absLimit;
+				double lambda_min = have_previous ? previous_min : -1.0;
+				if ( outer_spectrum.steps() >= 5 )
+					lambda_min = lambda_min > 0.0 ? std::min( lambda_min, outer_spectrum.minEigenvalue() )
+												  : outer_spectrum.minEigenvalue();
+				if ( !( lambda_min > 0.0 ) )
+					return delta <= outer_absLimit;
+				return delta_precond <= outer_absLimit * lambda_min * lambda_min;
+			};
+			while( !outerConverged() && (iteration++ < maxIter ) ) {
 				if ( iteration > 1 ) {
-					// gamma_{m+1} = delta_{m+1} / delta_m
-					gamma = delta / gamma;
-					// d_{m+1} = r_{m+1} + gamma_m * d_m
+					// gamma_{m+1} = < r_{m+1}, z_{m+1} > / < r_m, z_m >
+					gamma = delta_precond / gamma;
+					// d_{m+1} = z_{m+1} + gamma_m * d_m
 					d *= gamma;
-					d += residuum;
+					d += precond_residuum;
 				}
 				if ( iteration >=  maxIter && current_adaption < max_adaptions ) {
 					current_adaption++;
 					iteration = 2;//do not execute first step in next iter again
-					outer_absLimit /= 0.01;
-					current_inner_accuracy /= 0.01;
-					innerCGSolverWrapper.setAbsoluteLimit( current_inner_accuracy );
-					logInfo << "\n\t\t Outer CG solver reset, tolerance lowered" << std::endl;
+					if ( use_controller ) {
+						// the gap between the updated and the true residual is what the relaxed inner solves cost,
+						// restart from the true residual instead of loosening the limits
+						innerCGSolverWrapper.setAbsoluteLimit( inner_absLimit );
+						computeResiduum();
+						record_spectrum = false;
+						inner_controller.resetBudget();
+						precondition();
+						d.assign( precond_residuum );
+						delta = residuum.scalarProductDofs( residuum );
+						delta_precond = residuum.scalarProductDofs( precond_residuum );
+						logInfo << "\n\t\t Outer CG solver restarted from the true residual" << std::endl;
+						if ( outerConverged() )
+							break;
+					}
+					else {
+						outer_absLimit /= 0.01;
+						current_inner_accuracy /= 0.01;
+						innerCGSolverWrapper.setAbsoluteLimit( current_inner_accuracy );
+						logInfo << "\n\t\t Outer CG solver reset, tolerance lowered" << std::endl;
+					}
 				}
 
-                if ( do_bfg ) {
+                if ( use_controller ) {
+                    current_inner_accuracy = inner_controller.tolerance( std::sqrt( delta ) );
+                    innerCGSolverWrapper.setAbsoluteLimit( current_inner_accuracy );
+                    max_inner_accuracy = std::max( max_inner_accuracy, current_inner_accuracy );
+                    if( solverVerbosity > 1 )
+                        logInfo << "\t\t\t set inner limit to: " << current_inner_accuracy << "\n";
+                }
+                else if ( do_bfg ) {
                     //the form from the precond. paper
                     current_inner_accuracy = tau * std::min( 1. , outer_absLimit / std::min ( delta , 1.0 ) );
                     innerCGSolverWrapper.setAbsoluteLimit( current_inner_accuracy );
@@ -203,6 +300,7 @@ namespace Dune {
 				tmp1.clear();
 				b_mat.apply( d, tmp1 );
 
+				const double inner_rhs_norm = use_controller ? std::sqrt( tmp1.scalarProductDofs( tmp1 ) ) : 1.0;
 				innerCGSolverWrapper.apply( tmp1, xi, a_solver_info );
 
 				if( solverVerbosity > 1 )
@@ -211,13 +309,13 @@ namespace Dune {
 				min_inner_iterations = std::min( min_inner_iterations, a_solver_info.first );
 				max_inner_iterations = std::max( max_inner_iterations, a_solver_info.first );
 
-				// h = B_t * xi  + C * d
-				b_t_mat.apply( xi, h );
+				// h = B_t * xi  + C * d = C * d - E * xi
+				c_mat.apply( d, h );
 				tmp2.clear();
-				c_mat.apply( d, tmp2 );
-				h += tmp2;
+				e_mat.apply( xi, tmp2 );
+				h -= tmp2;
 
-				rho = delta / d.scalarProductDofs( h );
+				rho = delta_precond / d.scalarProductDofs( h );
 
 				// p_{m+1} = p_m - ( rho_m * d_m )
 				pressure.axpy( -rho, d );
@@ -229,16 +327,30 @@ namespace Dune {
 				residuum.axpy( -rho, h );
 
 				//save old delta for new gamma calc in next iter
-				gamma = delta;
+				gamma = delta_precond;
 
-				// d_{m+1} = < r_{m+1} ,r_{m+1} >
+				// d_{m+1} = < r_{m+1} ,r_{m+1} >, stays the stopping criterion either way
+				const double delta_old = delta;
 				delta = residuum.scalarProductDofs( residuum );
+				outer_steps.push_back( Oseen::OuterStepRecord( current_inner_accuracy, a_solver_info.first,
+															   std::sqrt( delta / delta_old ) ) );
+				if ( use_controller )
+					inner_controller.record( current_inner_accuracy,
+											 inner_rhs_norm > 0.0 ? a_solver_info.second / inner_rhs_norm : 0.0,
+											 std::fabs( rho ) * std::sqrt( h.scalarProductDofs( h ) ),
+											 std::sqrt( delta_old ), std::sqrt( delta ) );
+				precondition();
+				delta_precond = residuum.scalarProductDofs( precond_residuum );
+				if ( record_spectrum )
+					outer_spectrum.add( rho, delta_precond / gamma );
 
 				if( solverVerbosity > 2 )
 					logInfo << "\t" << iteration << " SPcg-Iterationen  " << iteration << " Residuum:" << delta << std::endl;
 			}
 
 			if ( use_velocity_reconstruct ) {
+				if ( use_controller )
+					innerCGSolverWrapper.setAbsoluteLimit( inner_absLimit );
 				// u^0 = A^{-1} ( F - B * p^0 )
 				F.assign(rhs2);
 				tmp1.clear();
@@ -258,9 +370,32 @@ namespace Dune {
 			info.iterations_inner_max = max_inner_iterations;
 			info.iterations_outer_total = iteration;
 			info.max_inner_accuracy = max_inner_accuracy;
+			info.outer_steps.swap( outer_steps );
+			if ( outer_spectrum.steps() > 0 ) {
+				info.outer_eigenvalue_min = outer_spectrum.minEigenvalue();
+				info.outer_eigenvalue_max = outer_spectrum.maxEigenvalue();
+				Oseen::SpectralEstimates::instance().store( spectrum_name, outer_spectrum );
+				if( solverVerbosity > 0 )
+					logInfo << " outer spectrum estimate: [" << info.outer_eigenvalue_min << ", " << info.outer_eigenvalue_max
+							<< "], condition ~ " << outer_spectrum.condition() << std::endl;
+			}
+			if( solverVerbosity > 1 ) {
+				logInfo << " step | inner tolerance | inner iter | residual reduction" << std::endl;
+				for ( std::size_t k = 0; k < info.outer_steps.size(); ++k )
+					logInfo << " " << k + 1 << " | " << info.outer_steps[k].inner_tolerance << " | "
+							<< info.outer_steps[k].inner_iterations << " | " << info.outer_steps[k].residual_reduction << std::endl;
+			}
+			innerCGSolverWrapper.fillInfo( info );
+			if( solverVerbosity > 0 && info.inner_projected_solves > 0 )
+				logInfo << " inner projection: " << info.inner_projected_solves << " solves, residual reduction "
+						<< info.inner_projection_reduction_avg << ", ~" << info.iterations_inner_saved << " iterations saved" << std::endl;
 			return info;
 		} //end SaddlepointInverseOperator::solve
 
+	  private:
+		const bool use_mass_preconditioner_;
+		Oseen::CompressedRowStorage pressure_mass_;
+
 	  };//end class SaddlepointInverseOperator
 
 
@@ -0,0 +1,269 @@
+#ifndef DUNE_OSEEN_SOLVERS_SCHUR_PRECONDITIONER_HH
+#define DUNE_OSEEN_SOLVERS_SCHUR_PRECONDITIONER_HH
+
+#include <cmake_config.h>
+
+#include <dune/fem/oseen/assembler/compressed_rowstorage.hh>
+#include <dune/fem/oseen/solver/amg.hh>
+#include <dune/fem/oseen/solver/ilu.hh>
+#include <dune/stuff/common/logging.hh>
+#include <dune/stuff/common/parameter/configcontainer.hh>
+
+#include <vector>
+#include <cmath>
+#include <memory>
+
+namespace Dune {
+namespace Oseen {
+
+//! preconditioners working on plain dof vectors, see NewBicgStab
+class VectorPreconditionerInterface
+{
+	public:
+		virtual ~VectorPreconditionerInterface() {}
+
+		//! y = P^{-1} x
+		virtual void precondition( const double* x, double* y ) const = 0;
+};
+
+/** \brief least squares commutator preconditioner for the Schur complement \f$ S = R - E A^{-1} Z \f$
+	With \f$ B = Z \f$, \f$ B^T = -E \f$ and \f$ Q = diag(A) \f$:
+	\f$ S^{-1} \approx L^{-1} ( B^T Q^{-1} A Q^{-1} B ) L^{-1} \f$, \f$ L = B^T Q^{-1} B \f$ (Elman et al., scaled BFBt).
+	Only needs Z, E and products with A, so it tracks the convection in A without a pressure convection matrix.
+	L is assembled once and solved with AMG preconditioned CG to lsc_relLimit, so the preconditioner is
+	(nearly) linear and can be used inside the non-flexible NewBicgStab.
+  **/
+template < class A_OperatorImp >
+class LSCPreconditioner : public VectorPreconditionerInterface
+{
+	public:
+		typedef A_OperatorImp
+			A_OperatorType;
+
+		//! diag_a is diag(A), a_op must provide multOEM( const double*, double* ) for A
+		template < class E_MatrixType, class Z_MatrixType >
+		LSCPreconditioner( const A_OperatorType& a_op,
+						   const std::vector< double >& diag_a,
+						   const E_MatrixType& e_mat,
+						   const Z_MatrixType& z_mat,
+						   const int pressure_block_size )
+			: a_op_( a_op ),
+			inv_diag_a_( diag_a.size() ),
+			rel_limit_( DSC_CONFIG_GET( "lsc_relLimit", 1e-6 ) ),
+			max_iter_( DSC_CONFIG_GET( "lsc_maxIter", 200 ) ),
+			velocity_tmp1_( diag_a.size() ),
+			velocity_tmp2_( diag_a.size() ),
+			last_iterations_( 0 )
+		{
+			for ( std::size_t i = 0; i < diag_a.size(); ++i )
+				inv_diag_a_[i] = diag_a[i] != 0.0 ? 1.0 / std::fabs( diag_a[i] ) : 1.0;
+			b_.assign( z_mat.matrix() );
+			b_t_.assign( e_mat.matrix() );
+			for ( int pos = 0; pos < b_t_.nonZeros(); ++pos )
+				b_t_.value( pos ) = -b_t_.value( pos );
+			// L = B^T Q^{-1} B
+			CompressedRowStorage q_inv_b( b_ );
+			for ( int row = 0; row < q_inv_b.rows(); ++row )
+				for ( int pos = q_inv_b.rowStart( row ); pos < q_inv_b.rowEnd( row ); ++pos )
+					q_inv_b.value( pos ) *= inv_diag_a_[ row ];
+			multiply( b_t_, q_inv_b, l_ );
+			l_amg_.reset( new AggregationAMG( l_, AggregationAMG::Parameters( pressure_block_size ) ) );
+			const int np = l_.rows();
+			pressure_tmp_.resize( np );
+			cg_r_.resize( np );
+			cg_z_.resize( np );
+			cg_p_.resize( np );
+			cg_q_.resize( np );
+		}
+
+		void precondition( const double* x, double* y ) const
+		{
+			const int nu = inv_diag_a_.size();
+			solveL( x, &pressure_tmp_[0] );
+			b_.mult( &pressure_tmp_[0], &velocity_tmp1_[0] );
+			for ( int i = 0; i < nu; ++i )
+				velocity_tmp1_[i] *= inv_diag_a_[i];
+			a_op_.multOEM( &velocity_tmp1_[0], &velocity_tmp2_[0] );
+			for ( int i = 0; i < nu; ++i )
+				velocity_tmp2_[i] *= inv_diag_a_[i];
+			b_t_.mult( &velocity_tmp2_[0], &pressure_tmp_[0] );
+			solveL( &pressure_tmp_[0], y );
+		}
+
+		//! L iterations of the last precondition() call
+		int lastIterations() const { return last_iterations_; }
+
+	private:
+		//! AMG preconditioned CG on L y = x from y = 0
+		void solveL( const double* x, double* y ) const
+		{
+			const int n = l_.rows();
+			double rz = 0.0;
+			double rhs_norm = 0.0;
+			for ( int i = 0; i < n; ++i ) {
+				y[i] = 0.0;
+				cg_r_[i] = x[i];
+				rhs_norm += x[i] * x[i];
+			}
+			const double limit = rel_limit_ * rel_limit_ * rhs_norm;
+			l_amg_->apply( &cg_r_[0], &cg_z_[0] );
+			for ( int i = 0; i < n; ++i ) {
+				cg_p_[i] = cg_z_[i];
+				rz += cg_r_[i] * cg_z_[i];
+			}
+			int iteration = 0;
+			double rr = rhs_norm;
+			while ( rr > limit && iteration < max_iter_ && rz != 0.0 ) {
+				++iteration;
+				l_.mult( &cg_p_[0], &cg_q_[0] );
+				double pq = 0.0;
+				for ( int i = 0; i < n; ++i )
+					pq += cg_p_[i] * cg_q_[i];
+				if ( pq == 0.0 )
+					break;
+				const double alpha = rz / pq;
+				rr = 0.0;
+				for ( int i = 0; i < n; ++i ) {
+					y[i] += alpha * cg_p_[i];
+					cg_r_[i] -= alpha * cg_q_[i];
+					rr += cg_r_[i] * cg_r_[i];
+				}
+				l_amg_->apply( &cg_r_[0], &cg_z_[0] );
+				double rz_new = 0.0;
+				for ( int i = 0; i < n; ++i )
+					rz_new += cg_r_[i] * cg_z_[i];
+				const double beta = rz_new / rz;
+				rz = rz_new;
+				for ( int i = 0; i < n; ++i )
+					cg_p_[i] = cg_z_[i] + beta * cg_p_[i];
+			}
+			last_iterations_ = iteration;
+		}
+
+		const A_OperatorType& a_op_;
+		std::vector< double > inv_diag_a_;
+		const double rel_limit_;
+		const int max_iter_;
+		CompressedRowStorage b_;
+		CompressedRowStorage b_t_;
+		CompressedRowStorage l_;
+		std::unique_ptr< AggregationAMG > l_amg_;
+		mutable std::vector< double > velocity_tmp1_;
+		mutable std::vector< double > velocity_tmp2_;
+		mutable std::vector< double > pressure_tmp_;
+		mutable std::vector< double > cg_r_;
+		mutable std::vector< double > cg_z_;
+		mutable std::vector< double > cg_p_;
+		mutable std::vector< double > cg_q_;
+		mutable int last_iterations_;
+};
+
+/** \brief \f$ \hat S = R - E Q^{-1} Z \f$ assembled once, approximately inverted by ILU(0) or one AMG V-cycle
+	Q^{-1} is handed in as a matrix, the inverted diagonal of A or its inverted element blocks.
+	Also provides the OEM preconditioner interface, so it can serve as SchurkomplementOperator::preconditionMatrix().
+  **/
+class AssembledSchurPreconditioner : public VectorPreconditionerInterface
+{
+	public:
+		enum SolverType { ILU, AMG };
+
+		template < class E_MatrixType, class R_MatrixType, class Z_MatrixType >
+		AssembledSchurPreconditioner( const CompressedRowStorage& q_inv,
+									  const E_MatrixType& e_mat,
+									  const R_MatrixType& r_mat,
+									  const Z_MatrixType& z_mat,
+									  const SolverType solver_type,
+									  const int pressure_block_size )
+		{
+			CompressedRowStorage e, r, z, q_inv_z, e_q_inv_z;
+			e.assign( e_mat.matrix() );
+			r.assign( r_mat.matrix() );
+			z.assign( z_mat.matrix() );
+			multiply( q_inv, z, q_inv_z );
+			multiply( e, q_inv_z, e_q_inv_z );
+			add( 1.0, r, -1.0, e_q_inv_z, s_hat_ );
+			if ( solver_type == AMG )
+				amg_.reset( new AggregationAMG( s_hat_, AggregationAMG::Parameters( pressure_block_size ) ) );
+			else
+				ilu_.reset( new IncompleteLU0( s_hat_ ) );
+		}
+
+		void precondition( const double* x, double* y ) const
+		{
+			if ( amg_ )
+				amg_->apply( x, y );
+			else
+				ilu_->apply( x, y );
+		}
+
+		template <class VecType>
+		void multOEM( const VecType* x, VecType* y ) const
+		{
+			precondition( x, y );
+		}
+
+		template <class VecType, class IterationInfoType>
+		void multOEM( const VecType* x, VecType* y, const IterationInfoType& /*info*/ ) const
+		{
+			precondition( x, y );
+		}
+
+		bool rightPrecondition() const { return false; }
+
+		const CompressedRowStorage& matrix() const { return s_hat_; }
+
+		//! inverted diagonal as CSR, zeros become one
+		static void diagonalInverse( const std::vector< double >& diag, CompressedRowStorage& q_inv )
+		{
+			const int n = diag.size();
+			std::vector< int > row_start( n + 1 );
+			std::vector< int > col( n );
+			std::vector< double > values( n );
+			for ( int i = 0; i < n; ++i ) {
+				row_start[i] = i;
+				col[i] = i;
+				values[i] = diag[i] != 0.0 ? 1.0 / diag[i] : 1.0;
+			}
+			row_start[n] = n;
+			q_inv.swapIn( n, n, row_start, col, values );
+		}
+
+	private:
+		CompressedRowStorage s_hat_;
+		std::unique_ptr< AggregationAMG > amg_;
+		std::unique_ptr< IncompleteLU0 > ilu_;
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVERS_SCHUR_PRECONDITIONER_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
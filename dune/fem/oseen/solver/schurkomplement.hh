@@ -12,6 +12,15 @@
 
 #include <dune/fem/oseen/oemsolver/preconditioning.hh>
 #include <dune/fem/oseen/oemsolver/oemsolver.hh>
+#include <dune/fem/oseen/solver/schur_preconditioner.hh>
+#include <dune/common/exceptions.hh>
+#include <dune/fem/oseen/solver/block_smoother.hh>
+#include <dune/fem/oseen/solver/inner_tolerance.hh>
+#include <dune/fem/oseen/assembler/compressed_rowstorage.hh>
+
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace Dune {
 
@@ -22,76 +31,30 @@ struct SaddlepointInverseOperatorInfo {
     int iterations_inner_max;
     int iterations_outer_total;
     double max_inner_accuracy;
+    //! inner solves started from a projected guess (inner_projection_size), their mean residual reduction
+    //! by the projection and the (estimated) inner iterations that saved
+    long inner_projected_solves;
+    double inner_projection_reduction_avg;
+    double iterations_inner_saved;
+    //! inner tolerance, inner iterations and residual reduction of every outer step (SaddlepointInverseOperator only)
+    std::vector< Oseen::OuterStepRecord > outer_steps;
+    //! Lanczos estimates of the extreme eigenvalues from the CG coefficients (Oseen::LanczosEstimate), -1 if unknown
+    //! outer: the (mass preconditioned) Schur complement of the Uzawa CG, inner: A as seen by the inner CG
+    double outer_eigenvalue_min;
+    double outer_eigenvalue_max;
+    double inner_eigenvalue_min;
+    double inner_eigenvalue_max;
 
     SaddlepointInverseOperatorInfo()
         :iterations_inner_avg(-1.0f),iterations_inner_min(-1),
         iterations_inner_max(-1),iterations_outer_total(-1),
-        max_inner_accuracy(-1.0f)
+        max_inner_accuracy(-1.0f),inner_projected_solves(-1),
+        inner_projection_reduction_avg(-1.0f),iterations_inner_saved(-1.0f),
+        outer_eigenvalue_min(-1.0f),outer_eigenvalue_max(-1.0f),
+        inner_eigenvalue_min(-1.0f),inner_eigenvalue_max(-1.0f)
     {}
 };
 
-template < class SchurkomplementOperatorType >
-class PreconditionOperatorDefault {
-    typedef PreconditionOperatorDefault< SchurkomplementOperatorType >
-        ThisType;
-    public:
-        typedef typename SchurkomplementOperatorType::DiscretePressureFunctionType
-            RowDiscreteFunctionType;
-        typedef typename RowDiscreteFunctionType::DiscreteFunctionSpaceType
-            DomainSpaceType;
-        typedef typename SchurkomplementOperatorType::DiscretePressureFunctionType
-            ColDiscreteFunctionType;
-        typedef typename ColDiscreteFunctionType::DiscreteFunctionSpaceType
-            RangeSpaceType;
-    private:
-        const SchurkomplementOperatorType& sk_op_;
-        const typename SchurkomplementOperatorType::A_PreconditionMatrix& a_precond_;
-        mutable typename SchurkomplementOperatorType::DiscreteVelocityFunctionType velo_tmp;
-        mutable typename SchurkomplementOperatorType::DiscreteVelocityFunctionType velo_tmp2;
-
-        const typename SchurkomplementOperatorType::Z_MatrixType::DomainSpaceType& pressure_space_;
-        const typename SchurkomplementOperatorType::E_MatrixType::DomainSpaceType& velocity_space_;
-
-    public:
-
-        PreconditionOperatorDefault( const typename SchurkomplementOperatorType::A_SolverType& a_solver,
-                           const SchurkomplementOperatorType& sk_op,
-                           const typename SchurkomplementOperatorType::E_MatrixType::DomainSpaceType& velocity_space,
-                           const typename SchurkomplementOperatorType::Z_MatrixType::DomainSpaceType& pressure_space)
-            : sk_op_( sk_op),
-            a_precond_( a_solver.getOperator().preconditionMatrix() ),
-            velo_tmp( "sdeio", pressure_space ),
-            velo_tmp2( "2sdeio", pressure_space ),
-            pressure_space_(pressure_space),
-            velocity_space_(velocity_space)
-        {}
-
-        template <class VECtype>
-        void multOEM(const VECtype* x, VECtype* ret, const IterationInfo& ) const
-        {
-            multOEM(x,ret);
-        }
-
-        template <class VECtype>
-        void multOEM(const VECtype* x, VECtype* ret) const
-        {
-            sk_op_.z_mat_.matrix().multOEM( x,velo_tmp.leakPointer());
-            a_precond_.apply( velo_tmp, velo_tmp2);
-            sk_op_.e_mat_.matrix().multOEM( velo_tmp2.leakPointer(),ret);
-            sk_op_.r_mat_.matrix().multOEMAdd( x, ret);
-        }
-
-        ThisType& systemMatrix () { return *this; }
-        const ThisType& systemMatrix () const { return *this; }
-
-        double ddotOEM(const double*v, const double* w) const
-        {
-            typename SchurkomplementOperatorType::DiscretePressureFunctionType V( "ddot_V2", velocity_space_, v );
-            typename SchurkomplementOperatorType::DiscretePressureFunctionType W( "ddot_W1", velocity_space_, w );
-            return V.scalarProductDofs( W );
-        }
-};
-
 /** \brief Operator wrapping Matrix vector multiplication for
 			matrix \f$ S :=  B_t * A^-1 * B + rhs3 \f$
 			**/
@@ -118,20 +81,11 @@ class SchurkomplementOperator //: public StokesOEMSolver::PreconditionInterface
 											DiscreteVelocityFunctionType,
 											DiscretePressureFunctionType>
 				ThisType;
-		typedef typename A_SolverType::A_OperatorType::PreconditionMatrix
-		    A_PreconditionMatrix;
-        typedef DSC::IdentityMatrixObject<R_MatrixType>
-		    PreconditionMatrixBaseType;
-        typedef PreconditionOperatorDefault< ThisType >
-            PreconditionOperator;
         //if shit goes south wrt precond working check if this doesn't need to be OEmSolver instead of StokesOEMSolver
         friend class Conversion<ThisType,StokesOEMSolver::PreconditionInterface>;
-        friend class PreconditionOperatorDefault< ThisType >;
-
 
-        typedef DSFe::OperatorBasedPreconditioner< PreconditionOperator,
-                                                    DuneStokes::OUTER_CG_SOLVERTYPE,
-													DiscretePressureFunctionType>
+		//! \f$ \hat S = R - E Q^{-1} Z \f$, assembled on first use
+        typedef Oseen::AssembledSchurPreconditioner
 			PreconditionMatrix;
 		typedef DiscretePressureFunctionType RowDiscreteFunctionType;
 		typedef DiscretePressureFunctionType ColDiscreteFunctionType;
@@ -155,9 +109,7 @@ public:
 			tmp2 ( "schurkomplementoperator_tmp2", velocity_space ),
             do_bfg( DSC_CONFIG_GET( "do-bfg", true ) ),
             total_inner_iterations( 0 ),
-			pressure_space_(pressure_space),
-            precond_operator_( a_solver, *this, pressure_space, velocity_space),
-            precond_( precond_operator_, pressure_space )
+			pressure_space_(pressure_space)
 	{}
 
     double ddotOEM(const double*v, const double* w) const
@@ -225,11 +177,44 @@ public:
 
     ThisType& systemMatrix () { return *this; }
     const ThisType& systemMatrix () const { return *this; }
-    const PreconditionMatrix& preconditionMatrix() const { return precond_; }
+    /** Q is diag(A) or, with schur_approximation: block, the element blocks of the explicitly formed A.
+		outerPrecond_type ilu uses ILU(0) of \f$ \hat S \f$, amg one AMG V-cycle on it; other types have no matrix here.
+	  **/
+    const PreconditionMatrix& preconditionMatrix() const
+    {
+		if ( !precond_ ) {
+			const std::string precond_type = DSC_CONFIG_GET( "outerPrecond_type", std::string("none") );
+			if ( precond_type != "ilu" && precond_type != "amg" )
+				DUNE_THROW( InvalidStateException, "Schur complement preconditionMatrix() only for outerPrecond_type ilu or amg, not "
+							<< precond_type );
+			Oseen::CompressedRowStorage q_inv;
+			if ( DSC_CONFIG_GET( "schur_approximation", std::string("diagonal") ) == "block" ) {
+				Oseen::CompressedRowStorage a_matrix;
+				a_solver_.getOperator().assemble( a_matrix );
+				Oseen::BlockDiagonalInverse blocks;
+				blocks.assign( a_matrix, tmp1.space().mapper().maxNumDofs() );
+				blocks.toMatrix( q_inv );
+			}
+			else {
+				DiscreteVelocityFunctionType diag_a( "diag_a", tmp1.space() );
+				a_solver_.getOperator().getDiag( diag_a );
+				PreconditionMatrix::diagonalInverse( std::vector< double >( diag_a.leakPointer(),
+																			diag_a.leakPointer() + tmp1.space().size() ),
+													 q_inv );
+			}
+			const PreconditionMatrix::SolverType solver_type =
+					precond_type == "amg" ? PreconditionMatrix::AMG : PreconditionMatrix::ILU;
+			precond_.reset( new PreconditionMatrix( q_inv, e_mat_, r_mat_, z_mat_, solver_type,
+													pressure_space_.mapper().maxNumDofs() ) );
+		}
+		return *precond_;
+	}
 
+    //! only the assembled \f$ \hat S \f$ preconditioners (outerPrecond_type ilu, amg) are provided as matrix
     bool hasPreconditionMatrix () const
     {
-        return DSC_CONFIG_GET( "outerPrecond", false );
+        const std::string precond_type = DSC_CONFIG_GET( "outerPrecond_type", std::string("none") );
+        return precond_type == "ilu" || precond_type == "amg";
     }
 
     bool rightPrecondition() const { return false; }
@@ -246,8 +231,7 @@ public:
         bool do_bfg;
         mutable long total_inner_iterations;
 		const typename DiscretePressureFunctionType::DiscreteFunctionSpaceType& pressure_space_;
-		PreconditionOperator precond_operator_;
-		PreconditionMatrix precond_;
+		mutable std::unique_ptr< PreconditionMatrix > precond_;
 };
 
 } //end namespace Dune
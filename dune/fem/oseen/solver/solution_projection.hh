@@ -0,0 +1,320 @@
+#ifndef DUNE_OSEEN_SOLVERS_SOLUTION_PROJECTION_HH
+#define DUNE_OSEEN_SOLVERS_SOLUTION_PROJECTION_HH
+
+#include <dune/common/exceptions.hh>
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+
+namespace Dune {
+namespace Oseen {
+
+/** \brief initial guesses for repeated solves with the same operator, after Fischer
+	Keeps the previous solutions V and W = A V with W orthonormal. A new right hand side b and start vector x
+	get x_0 = x + V W^T ( b - A x ), which minimises the residual over x + span V.
+	For SPD A this is the A-norm minimising projection of Fischer's method up to the choice of inner product,
+	W orthonormal keeps it meaningful for the nonsymmetric Oseen A as well.
+	The span is the recycled subspace, a full space is discarded and rebuilt from the next solutions.
+	For SPD A, deflatedCG() goes further and keeps the span out of the whole Krylov iteration, not only the start vector.
+	Operator needs multOEM( const double*, double* ) and ddotOEM( const double*, const double* ).
+  **/
+class SolutionProjection
+{
+	public:
+		SolutionProjection( const int size, const int max_vectors )
+			: size_( size ),
+			  max_vectors_( max_vectors ),
+			  vectors_( 0 ),
+			  gram_( max_vectors * max_vectors, 0.0 ),
+			  residual_( size ),
+			  projected_solves_( 0 ),
+			  reduction_sum_( 0.0 ),
+			  iterations_saved_( 0.0 )
+		{}
+
+		bool enabled() const { return max_vectors_ > 0; }
+
+		/** x is replaced by the projected start vector
+			\return the residual norm before and after the projection, zeros while the space is empty
+		  **/
+		template < class Operator >
+		std::pair< double, double > initialGuess( const Operator& op, const double* b, double* x )
+		{
+			if ( vectors_ == 0 )
+				return std::make_pair( 0.0, 0.0 );
+			op.multOEM( x, &residual_[0] );
+			for ( int i = 0; i < size_; ++i )
+				residual_[i] = b[i] - residual_[i];
+			const double before = std::sqrt( op.ddotOEM( &residual_[0], &residual_[0] ) );
+			for ( int k = 0; k < vectors_; ++k ) {
+				const double c = op.ddotOEM( w( k ), &residual_[0] );
+				const double* v_k = v( k );
+				const double* w_k = w( k );
+				for ( int i = 0; i < size_; ++i ) {
+					x[i] += c * v_k[i];
+					residual_[i] -= c * w_k[i];
+				}
+			}
+			const double after = std::sqrt( op.ddotOEM( &residual_[0], &residual_[0] ) );
+			return std::make_pair( before, after );
+		}
+
+		//! add the converged solution x of a solve started from initialGuess
+		template < class Operator >
+		void add( const Operator& op, const double* x )
+		{
+			if ( !enabled() )
+				return;
+			if ( vectors_ == max_vectors_ )
+				vectors_ = 0;
+			if ( basis_.size() < std::size_t( 2 * max_vectors_ * size_ ) )
+				basis_.resize( std::size_t( 2 * max_vectors_ * size_ ) );
+			double* v_new = v( vectors_ );
+			double* w_new = w( vectors_ );
+			std::copy( x, x + size_, v_new );
+			op.multOEM( v_new, w_new );
+			const double norm_in = std::sqrt( op.ddotOEM( w_new, w_new ) );
+			// modified Gram-Schmidt, twice is enough
+			for ( int pass = 0; pass < 2; ++pass ) {
+				for ( int k = 0; k < vectors_; ++k ) {
+					const double c = op.ddotOEM( w( k ), w_new );
+					const double* v_k = v( k );
+					const double* w_k = w( k );
+					for ( int i = 0; i < size_; ++i ) {
+						v_new[i] -= c * v_k[i];
+						w_new[i] -= c * w_k[i];
+					}
+				}
+			}
+			const double norm = std::sqrt( op.ddotOEM( w_new, w_new ) );
+			// (numerically) in the span already
+			if ( norm <= 1e-10 * norm_in || norm == 0.0 )
+				return;
+			for ( int i = 0; i < size_; ++i ) {
+				v_new[i] /= norm;
+				w_new[i] /= norm;
+			}
+			// G = V^T A V = V^T W for deflatedCG, the new row and column
+			const int n = vectors_;
+			for ( int k = 0; k <= n; ++k ) {
+				gram_[ n * max_vectors_ + k ] = op.ddotOEM( v_new, w( k ) );
+				gram_[ k * max_vectors_ + n ] = op.ddotOEM( v( k ), w_new );
+			}
+			++vectors_;
+		}
+
+		/** deflated preconditioned CG (Saad, Yeung, Erhel, Guyomarc'h, SIAM J Sci Comput 21, 1909-1926 (2000)) for SPD A
+			The start vector gets the Galerkin correction x += V G^{-1} V^T r, G = V^T A V, and every search direction
+			is made A-orthogonal to span V (p = z - V G^{-1} W^T z), so CG runs on the complement of the stored solutions
+			and converges with the spectrum A has there. Costs vectors() extra scalar products and axpys per iteration.
+			prec (precondition( const double*, double* ), typed) may be null. Stops at |r| <= abs_limit * |b| like the OEM solvers.
+			\param residuals receives the residual norms before and after the start correction, for record()
+			\return iterations and final residual norm
+		  **/
+		template < class Operator, class Preconditioner >
+		std::pair< int, double > deflatedCG( const Operator& op, const Preconditioner* prec, const double* b, double* x,
+											 const double abs_limit, const int max_iter,
+											 std::pair< double, double >& residuals )
+		{
+			const int k = vectors_;
+			factorGram();
+			z_.resize( size_ );
+			p_.resize( size_ );
+			ap_.resize( size_ );
+			coefficients_.resize( k );
+
+			op.multOEM( x, &residual_[0] );
+			for ( int i = 0; i < size_; ++i )
+				residual_[i] = b[i] - residual_[i];
+			residuals.first = std::sqrt( op.ddotOEM( &residual_[0], &residual_[0] ) );
+			// x += V G^{-1} V^T r, r -= W G^{-1} V^T r
+			for ( int j = 0; j < k; ++j )
+				coefficients_[j] = op.ddotOEM( v( j ), &residual_[0] );
+			solveGram( coefficients_ );
+			for ( int j = 0; j < k; ++j ) {
+				const double* v_j = v( j );
+				const double* w_j = w( j );
+				for ( int i = 0; i < size_; ++i ) {
+					x[i] += coefficients_[j] * v_j[i];
+					residual_[i] -= coefficients_[j] * w_j[i];
+				}
+			}
+			double norm = std::sqrt( op.ddotOEM( &residual_[0], &residual_[0] ) );
+			residuals.second = norm;
+			const double limit = abs_limit * std::sqrt( op.ddotOEM( b, b ) );
+
+			precondition( prec, &residual_[0], &z_[0] );
+			std::copy( z_.begin(), z_.end(), p_.begin() );
+			deflateDirection( op );
+			double rz = op.ddotOEM( &residual_[0], &z_[0] );
+			int iterations = 0;
+			while ( norm > limit && iterations < max_iter ) {
+				op.multOEM( &p_[0], &ap_[0] );
+				const double alpha = rz / op.ddotOEM( &p_[0], &ap_[0] );
+				for ( int i = 0; i < size_; ++i ) {
+					x[i] += alpha * p_[i];
+					residual_[i] -= alpha * ap_[i];
+				}
+				++iterations;
+				norm = std::sqrt( op.ddotOEM( &residual_[0], &residual_[0] ) );
+				if ( norm <= limit )
+					break;
+				precondition( prec, &residual_[0], &z_[0] );
+				const double rz_new = op.ddotOEM( &residual_[0], &z_[0] );
+				const double beta = rz_new / rz;
+				rz = rz_new;
+				// p = z + beta p - V G^{-1} W^T z
+				for ( int i = 0; i < size_; ++i )
+					p_[i] = z_[i] + beta * p_[i];
+				deflateDirection( op );
+			}
+			return std::make_pair( iterations, norm );
+		}
+
+		/** book keeping for SaddlepointInverseOperatorInfo
+			The saved iterations are estimated from the convergence rate of the solve itself:
+			reducing the residual from before to after the projection would have taken
+			log(before/after) / log(after/final) * iterations more.
+		  **/
+		void record( const std::pair< double, double >& residuals, const int iterations, const double final_residual )
+		{
+			const double before = residuals.first;
+			const double after = residuals.second;
+			if ( before <= 0.0 )
+				return;
+			++projected_solves_;
+			reduction_sum_ += after / before;
+			if ( after < before && after > 0.0 && final_residual > 0.0 && final_residual < after && iterations > 0 )
+				iterations_saved_ += iterations * std::log( before / after ) / std::log( after / final_residual );
+		}
+
+		int vectors() const { return vectors_; }
+		long projectedSolves() const { return projected_solves_; }
+		double averageReduction() const { return projected_solves_ ? reduction_sum_ / projected_solves_ : -1.0; }
+		double iterationsSaved() const { return iterations_saved_; }
+
+	private:
+		//! p -= V G^{-1} W^T z, z_ the current preconditioned residual
+		template < class Operator >
+		void deflateDirection( const Operator& op )
+		{
+			const int k = vectors_;
+			for ( int j = 0; j < k; ++j )
+				coefficients_[j] = op.ddotOEM( w( j ), &z_[0] );
+			solveGram( coefficients_ );
+			for ( int j = 0; j < k; ++j ) {
+				const double* v_j = v( j );
+				for ( int i = 0; i < size_; ++i )
+					p_[i] -= coefficients_[j] * v_j[i];
+			}
+		}
+
+		template < class Preconditioner >
+		void precondition( const Preconditioner* prec, const double* r, double* z ) const
+		{
+			if ( prec )
+				prec->precondition( r, z );
+			else
+				std::copy( r, r + size_, z );
+		}
+
+		//! Cholesky factor of the leading vectors() x vectors() block of G, throws unless G is symmetric positive definite
+		void factorGram()
+		{
+			const int k = vectors_;
+			const int m = max_vectors_;
+			cholesky_.assign( k * k, 0.0 );
+			double scale = 0.0;
+			for ( int i = 0; i < k; ++i )
+				scale = std::max( scale, std::fabs( gram_[ i * m + i ] ) );
+			for ( int i = 0; i < k; ++i ) {
+				for ( int j = 0; j < i; ++j )
+					if ( std::fabs( gram_[ i * m + j ] - gram_[ j * m + i ] ) > 1e-8 * scale )
+						DUNE_THROW( InvalidStateException, "inner_deflation needs a symmetric A (Stokes), V^T A V is not" );
+				for ( int j = 0; j <= i; ++j ) {
+					double sum = gram_[ i * m + j ];
+					for ( int l = 0; l < j; ++l )
+						sum -= cholesky_[ i * k + l ] * cholesky_[ j * k + l ];
+					if ( i == j ) {
+						if ( sum <= 1e-14 * scale )
+							DUNE_THROW( InvalidStateException, "inner_deflation needs a positive definite A, V^T A V is not" );
+						cholesky_[ i * k + i ] = std::sqrt( sum );
+					}
+					else
+						cholesky_[ i * k + j ] = sum / cholesky_[ j * k + j ];
+				}
+			}
+		}
+
+		//! c = G^{-1} c with the factor of factorGram()
+		void solveGram( std::vector< double >& c ) const
+		{
+			const int k = vectors_;
+			for ( int i = 0; i < k; ++i ) {
+				for ( int l = 0; l < i; ++l )
+					c[i] -= cholesky_[ i * k + l ] * c[l];
+				c[i] /= cholesky_[ i * k + i ];
+			}
+			for ( int i = k - 1; i >= 0; --i ) {
+				for ( int l = i + 1; l < k; ++l )
+					c[i] -= cholesky_[ l * k + i ] * c[l];
+				c[i] /= cholesky_[ i * k + i ];
+			}
+		}
+
+		double* v( const int k ) { return &basis_[ std::size_t( 2 * k ) * size_ ]; }
+		double* w( const int k ) { return &basis_[ std::size_t( 2 * k + 1 ) * size_ ]; }
+
+		const int size_;
+		const int max_vectors_;
+		int vectors_;
+		//! v_0, w_0, v_1, w_1, ...
+		std::vector< double > basis_;
+		//! V^T W, max_vectors x max_vectors row major, the leading vectors() block is valid
+		std::vector< double > gram_;
+		std::vector< double > cholesky_;
+		std::vector< double > coefficients_;
+		std::vector< double > residual_;
+		std::vector< double > z_;
+		std::vector< double > p_;
+		std::vector< double > ap_;
+		long projected_solves_;
+		double reduction_sum_;
+		double iterations_saved_;
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVERS_SOLUTION_PROJECTION_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
@@ -0,0 +1,233 @@
+#ifndef DUNE_OSEEN_SOLVERS_SOLVER_REGISTRY_HH
+#define DUNE_OSEEN_SOLVERS_SOLVER_REGISTRY_HH
+
+#include <cmake_config.h>
+
+#include <dune/fem/oseen/oemsolver/oemsolver.hh>
+#include <dune/fem/oseen/solver/lanczos.hh>
+#include <dune/common/exceptions.hh>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <utility>
+
+#ifndef INNER_SOLVER_NAME
+	#define INNER_SOLVER_NAME "CG"
+#endif
+#ifndef OUTER_SOLVER_NAME
+	#define OUTER_SOLVER_NAME "CG"
+#endif
+
+namespace Dune {
+namespace Oseen {
+
+//! names accepted by RuntimeOEMSolver, the same as for INNER_SOLVER/OUTER_SOLVER in CMake (INNER_SOLVER also takes CHEBYSHEV)
+inline std::vector< std::string > oemSolverNames()
+{
+	std::vector< std::string > names;
+	names.push_back( "CG" );
+	names.push_back( "BICGSTAB" );
+	names.push_back( "GMRES" );
+	names.push_back( "PIPECG" );
+	names.push_back( "PIPEBICGSTAB" );
+	return names;
+}
+
+/** \brief one of the DuneStokes::OEM*Op solvers, picked by name at runtime
+	All of them are compiled in, INNER_SOLVER and OUTER_SOLVER from CMake only set the defaults of the inner_solver
+	and outer_solver parameters. Apart from one virtual call per solve this behaves like the wrapped solver.
+  **/
+template < class DiscreteFunctionType, class OperatorType >
+class RuntimeOEMSolver
+{
+	public:
+		typedef std::pair< int, double > ReturnValueType;
+
+		RuntimeOEMSolver( const std::string& name, OperatorType& op, const double relLimit, const double absLimit,
+						  const int maxIter, const bool verbose )
+			: solver_( create( name, op, relLimit, absLimit, maxIter, verbose ) )
+		{}
+
+		void apply( const DiscreteFunctionType& arg, DiscreteFunctionType& dest ) const
+		{
+			ReturnValueType ret;
+			solver_->apply( arg, dest, ret );
+		}
+
+		void apply( const DiscreteFunctionType& arg, DiscreteFunctionType& dest, ReturnValueType& ret ) const
+		{
+			solver_->apply( arg, dest, ret );
+		}
+
+		void operator()( const DiscreteFunctionType& arg, DiscreteFunctionType& dest ) const
+		{
+			apply( arg, dest );
+		}
+
+		void setAbsoluteLimit( const double abs )
+		{
+			solver_->setAbsoluteLimit( abs );
+		}
+
+		//! Lanczos estimates of the last solve, null unless the wrapped solver is CG
+		const LanczosEstimate* spectrum() const
+		{
+			return solver_->spectrum();
+		}
+
+	private:
+		struct Interface {
+			virtual ~Interface() {}
+			virtual void apply( const DiscreteFunctionType& arg, DiscreteFunctionType& dest, ReturnValueType& ret ) const = 0;
+			virtual void setAbsoluteLimit( const double abs ) = 0;
+			virtual const LanczosEstimate* spectrum() const = 0;
+		};
+
+		template < class SolverImp >
+		struct Model : public Interface {
+			Model( OperatorType& op, const double relLimit, const double absLimit, const int maxIter, const bool verbose )
+				: solver( op, relLimit, absLimit, maxIter, verbose )
+			{}
+
+			void apply( const DiscreteFunctionType& arg, DiscreteFunctionType& dest, ReturnValueType& ret ) const
+			{
+				solver.apply( arg, dest, ret );
+			}
+
+			void setAbsoluteLimit( const double abs )
+			{
+				solver.setAbsoluteLimit( abs );
+			}
+
+			const LanczosEstimate* spectrum() const
+			{
+				return spectrumOf( solver );
+			}
+
+			SolverImp solver;
+		};
+
+		template < class SolverImp >
+		static const LanczosEstimate* spectrumOf( const SolverImp& )
+		{
+			return 0;
+		}
+
+		static const LanczosEstimate* spectrumOf( const DuneStokes::OEMCGOp< DiscreteFunctionType, OperatorType >& solver )
+		{
+			return &solver.spectrum();
+		}
+
+		static Interface* create( const std::string& name, OperatorType& op, const double relLimit, const double absLimit,
+								  const int maxIter, const bool verbose )
+		{
+			if ( name == "CG" )
+				return new Model< DuneStokes::OEMCGOp< DiscreteFunctionType, OperatorType > >( op, relLimit, absLimit, maxIter, verbose );
+			if ( name == "BICGSTAB" )
+				return new Model< DuneStokes::OEMBICGSTABOp< DiscreteFunctionType, OperatorType > >( op, relLimit, absLimit, maxIter, verbose );
+			if ( name == "GMRES" )
+				return new Model< DuneStokes::OEMGMRESOp< DiscreteFunctionType, OperatorType > >( op, relLimit, absLimit, maxIter, verbose );
+			if ( name == "PIPECG" )
+				return new Model< DuneStokes::OEMPIPECGOp< DiscreteFunctionType, OperatorType > >( op, relLimit, absLimit, maxIter, verbose );
+			if ( name == "PIPEBICGSTAB" )
+				return new Model< DuneStokes::OEMPIPEBICGSTABOp< DiscreteFunctionType, OperatorType > >( op, relLimit, absLimit, maxIter, verbose );
+			DUNE_THROW( InvalidStateException, "unknown OEM solver: " << name << ", use CG, BICGSTAB, GMRES, PIPECG or PIPEBICGSTAB" );
+		}
+
+		std::unique_ptr< Interface > solver_;
+};
+
+/** \brief remembers which saddle point strategy and inner solver won the autotune trials
+	A candidate is "strategy" or "strategy/inner_solver", e.g. "fgmres/PIPECG", strategies as for saddlepoint_solver.
+	Stokes and Oseen systems are tuned separately, each once per run, so refinement sweeps and time steps reuse the choice.
+	The choice lives here only, SolverCallerProxy sets inner_solver from it for the duration of each tuned solve.
+  **/
+class SolverAutotuner
+{
+	public:
+		struct Candidate {
+			std::string strategy;
+			std::string inner_solver;
+
+			Candidate( const std::string& strategy_in, const std::string& inner_solver_in )
+				: strategy( strategy_in ),
+				  inner_solver( inner_solver_in )
+			{}
+
+			std::string str() const { return strategy + "/" + inner_solver; }
+		};
+
+		static SolverAutotuner& instance()
+		{
+			static SolverAutotuner tuner;
+			return tuner;
+		}
+
+		//! candidates separated by blanks or commas, those without inner solver get default_inner_solver
+		static std::vector< Candidate > parse( const std::string& list, const std::string& default_inner_solver )
+		{
+			std::vector< Candidate > candidates;
+			std::string token;
+			for ( std::size_t i = 0; i <= list.size(); ++i ) {
+				if ( i < list.size() && list[i] != ' ' && list[i] != ',' && list[i] != '\t' ) {
+					token += list[i];
+					continue;
+				}
+				if ( token.empty() )
+					continue;
+				const std::size_t slash = token.find( '/' );
+				if ( slash == std::string::npos )
+					candidates.push_back( Candidate( token, default_inner_solver ) );
+				else
+					candidates.push_back( Candidate( token.substr( 0, slash ), token.substr( slash + 1 ) ) );
+				token.clear();
+			}
+			return candidates;
+		}
+
+		bool tuned( const bool oseen ) const { return choice_[oseen].get() != 0; }
+
+		const Candidate& choice( const bool oseen ) const { return *choice_[oseen]; }
+
+		void setChoice( const bool oseen, const Candidate& candidate ) { choice_[oseen].reset( new Candidate( candidate ) ); }
+
+	private:
+		SolverAutotuner() {}
+
+		std::unique_ptr< Candidate > choice_[2];
+};
+
+} //namespace Oseen
+} //namespace Dune
+
+#endif // DUNE_OSEEN_SOLVERS_SOLVER_REGISTRY_HH
+
+/** Copyright (c) 2012, Rene Milk 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies, 
+ * either expressed or implied, of the FreeBSD Project.
+**/
+
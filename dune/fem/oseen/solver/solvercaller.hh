@@ -5,9 +5,18 @@
 #include <dune/fem/oseen/solver/saddle_point.hh>
 #include <dune/fem/oseen/solver/bicg_saddle_point.hh>
 #include <dune/fem/oseen/solver/new_bicgstab.hh>
+#include <dune/fem/oseen/solver/monolithic.hh>
+#include <dune/fem/oseen/solver/augmented_lagrangian.hh>
 #include <dune/fem/oseen/solver/reconstruction.hh>
+#include <dune/fem/oseen/solver/solver_registry.hh>
 #include <dune/stuff/common/profiler.hh>
 #include <dune/stuff/common/logging.hh>
+#include <dune/stuff/common/parameter/configcontainer.hh>
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <memory>
 
 namespace Dune {
 namespace Oseen {
@@ -16,8 +25,47 @@ namespace Solver {
     enum SolverID {
         SaddlePoint_Solver_ID		= 1,
         Reduced_Solver_ID			= 2,
-        BiCg_Saddlepoint_Solver_ID	= 4
+        BiCg_Saddlepoint_Solver_ID	= 4,
+        Monolithic_Solver_ID		= 8,
+        Monolithic_Direct_Solver_ID	= 16,
+        FGMRES_Saddlepoint_Solver_ID	= 32,
+        AugmentedLagrangian_Solver_ID	= 64
     };
+
+    //! the strategy names of saddlepoint_solver and autotune_candidates
+    inline SolverID fromName( const std::string& name )
+    {
+        if ( name == "saddlepoint" )
+            return SaddlePoint_Solver_ID;
+        if ( name == "reduced" )
+            return Reduced_Solver_ID;
+        if ( name == "bicgstab" )
+            return BiCg_Saddlepoint_Solver_ID;
+        if ( name == "monolithic" )
+            return Monolithic_Solver_ID;
+        if ( name == "direct" )
+            return Monolithic_Direct_Solver_ID;
+        if ( name == "fgmres" )
+            return FGMRES_Saddlepoint_Solver_ID;
+        if ( name == "al" )
+            return AugmentedLagrangian_Solver_ID;
+        DUNE_THROW( InvalidStateException, "unknown saddle point strategy: " << name
+                    << ", use saddlepoint, reduced, bicgstab, monolithic, direct, fgmres or al" );
+    }
+
+    inline std::string name( const SolverID id )
+    {
+        switch ( id ) {
+            case SaddlePoint_Solver_ID:         return "saddlepoint";
+            case Reduced_Solver_ID:             return "reduced";
+            case BiCg_Saddlepoint_Solver_ID:    return "bicgstab";
+            case Monolithic_Solver_ID:          return "monolithic";
+            case Monolithic_Direct_Solver_ID:   return "direct";
+            case FGMRES_Saddlepoint_Solver_ID:  return "fgmres";
+            case AugmentedLagrangian_Solver_ID: return "al";
+        }
+        return "unknown";
+    }
 }
 
 template<class OseenLDGMethodType >
@@ -33,6 +81,12 @@ struct SolverCaller {
 	//! this is used for reduced (no pressure, incompress. condition) oseen pass
     typedef ReducedInverseOperator< OseenLDGMethodType >
 		ReducedSolverType;
+	//! one preconditioned Krylov iteration on the whole velocity/pressure system
+    typedef MonolithicSaddlepointInverseOperator< OseenLDGMethodType >
+		MonolithicSolverType;
+	//! grad-div augmented system, for low viscosity Oseen problems
+    typedef AugmentedLagrangianSaddlepointInverseOperator< OseenLDGMethodType >
+		AugmentedLagrangianSolverType;
 
 
 	template <  class DomainType,
@@ -48,7 +102,8 @@ struct SolverCaller {
 				class DiscreteSigmaFunctionType,
 				class DiscreteVelocityFunctionType,
 				class DiscretePressureFunctionType,
-				class DataContainerType >
+				class DataContainerType,
+				class PressureMassMatrixObjectType >
     static SaddlepointInverseOperatorInfo solve(
                 const Solver::SolverID solverID,
                 const bool with_oseen_discretization,
@@ -66,7 +121,9 @@ struct SolverCaller {
 				const DiscreteSigmaFunctionType& H1rhs,
 				const DiscreteVelocityFunctionType& H2rhs,
 				const DiscretePressureFunctionType& H3rhs,
-				const DiscreteVelocityFunctionType& beta )
+				const DiscreteVelocityFunctionType& beta,
+				const PressureMassMatrixObjectType* pressure_mass,
+				const double viscosity )
 	{
 		DSC::Profiler::ScopedTiming solver_time("solver");
 
@@ -79,16 +136,39 @@ struct SolverCaller {
                                                              H1rhs, H2rhs, H3rhs );
                                             break;
 
+            case Solver::FGMRES_Saddlepoint_Solver_ID:result = BiCgSaddlepointSolverType( true ).solve( arg, dest,
+                                                             X, M_invers, Y,
+                                                             O, E, R, Z, W,
+                                                             H1rhs, H2rhs, H3rhs );
+                                            break;
+
             case Solver::Reduced_Solver_ID:			result = ReducedSolverType().solve(	arg, dest,
                                                                                         X, M_invers, Y,
                                                                                         O, E, R, Z, W,
                                                              H1rhs, H2rhs, H3rhs );
                                             break;
-			case Solver::SaddlePoint_Solver_ID:		result = SaddlepointSolverType().solve(	arg, dest,
+			case Solver::SaddlePoint_Solver_ID:		result = SaddlepointSolverType( DSC_CONFIG_GET( "outerPrecond_mass", false )
+                                                                                            ? pressure_mass : nullptr ).solve(	arg, dest,
                                                                                             X, M_invers, Y,
                                                                                             O, E, R, Z, W,
 															 H1rhs, H2rhs, H3rhs );
 											break;
+            case Solver::Monolithic_Solver_ID:		result = MonolithicSolverType( with_oseen_discretization ).solve( arg, dest,
+                                                                                            X, M_invers, Y,
+                                                                                            O, E, R, Z, W,
+                                                             H1rhs, H2rhs, H3rhs );
+                                            break;
+            case Solver::Monolithic_Direct_Solver_ID:	result = MonolithicSolverType( with_oseen_discretization, true ).solve( arg, dest,
+                                                                                            X, M_invers, Y,
+                                                                                            O, E, R, Z, W,
+                                                             H1rhs, H2rhs, H3rhs );
+                                            break;
+
+            case Solver::AugmentedLagrangian_Solver_ID:	result = AugmentedLagrangianSolverType( pressure_mass, viscosity ).solve( arg, dest,
+                                                                                            X, M_invers, Y,
+                                                                                            O, E, R, Z, W,
+                                                             H1rhs, H2rhs, H3rhs );
+                                            break;
 
             default:
                 throw std::runtime_error("invalid Solver ID selected");
@@ -125,9 +205,38 @@ public:
                 ? Oseen::Solver::BiCg_Saddlepoint_Solver_ID
                 : Oseen::Solver::SaddlePoint_Solver_ID;
 
+        //Schur complement FGMRES, for inexact inner solves
+        if ( DSC_CONFIG_GET( "fgmres_outer_solver", false ) )
+              solver_ID = Oseen::Solver::FGMRES_Saddlepoint_Solver_ID;
+
+        if ( DSC_CONFIG_GET( "monolithic_solver", false ) )
+              solver_ID = Oseen::Solver::Monolithic_Solver_ID;
+
+        //names any strategy, overrides the switches above
+        const std::string saddlepoint_solver = DSC_CONFIG_GET( "saddlepoint_solver", std::string( "" ) );
+        if ( !saddlepoint_solver.empty() )
+              solver_ID = Oseen::Solver::fromName( saddlepoint_solver );
+
+        //small systems are factored as a whole instead, serial only like the monolithic solver
+        const int direct_max_dofs = DSC_CONFIG_GET( "direct_solver_max_dofs", 0 );
+        if ( direct_max_dofs > 0 && dest.discretePressure().space().grid().comm().size() == 1
+                && dest.discreteVelocity().space().size() + dest.discretePressure().space().size() <= direct_max_dofs )
+              solver_ID = Oseen::Solver::Monolithic_Direct_Solver_ID;
+
         if(use_reduced_solver)
               solver_ID = Oseen::Solver::Reduced_Solver_ID;
 
+        //the reduced and the small direct systems are left alone
+        //the tuned inner solver only holds for this solve, the user's inner_solver is back afterwards
+        std::unique_ptr< ScopedInnerSolver > tuned_inner_solver;
+        if ( DSC_CONFIG_GET( "autotune", false )
+                && solver_ID != Oseen::Solver::Reduced_Solver_ID
+                && solver_ID != Oseen::Solver::Monolithic_Direct_Solver_ID ) {
+              solver_ID = autotune< ContainerType >( solver_ID, do_oseen_discretization, dest, args... );
+              tuned_inner_solver.reset(
+                      new ScopedInnerSolver( SolverAutotuner::instance().choice( do_oseen_discretization ).inner_solver ) );
+        }
+
         if ( DSC_CONFIG_GET( "smart_reconstruction", false ) )
             return SolverCaller<>::solve(solver_ID,
                                                 do_oseen_discretization,
@@ -141,6 +250,89 @@ public:
                                            dest,
                                            args...);
     }
+
+private:
+    //! sets inner_solver while it lives, the previous value is put back however the scope is left
+    class ScopedInnerSolver
+    {
+        public:
+            explicit ScopedInnerSolver( const std::string& inner_solver )
+                : previous_( DSC_CONFIG_GET( "inner_solver", std::string( INNER_SOLVER_NAME ) ) )
+            {
+                DSC_CONFIG.set( "inner_solver", inner_solver );
+            }
+
+            ~ScopedInnerSolver()
+            {
+                DSC_CONFIG.set( "inner_solver", previous_ );
+            }
+
+        private:
+            const std::string previous_;
+    };
+
+    /** time a trial solve of every autotune_candidates entry on this system, to absLimit * autotune_tolerance_factor
+        and into a copy of dest, then keep the fastest for the rest of the run (see SolverAutotuner).
+        The default candidates are every strategy with the configured inner_solver, and the configured strategy
+        with every other inner solver. Candidates that throw, e.g. an unsupported preconditioner combination, are skipped.
+      **/
+    template < class ContainerType, class RangeType, class... Args >
+    static Oseen::Solver::SolverID autotune( const Oseen::Solver::SolverID configured,
+                                             const bool do_oseen_discretization,
+                                             RangeType& dest,
+                                             const Args&... args )
+    {
+        SolverAutotuner& tuner = SolverAutotuner::instance();
+        if ( !tuner.tuned( do_oseen_discretization ) ) {
+            const std::string inner_solver = DSC_CONFIG_GET( "inner_solver", std::string( INNER_SOLVER_NAME ) );
+            std::string default_candidates = do_oseen_discretization ? "bicgstab fgmres monolithic al"
+                                                                     : "saddlepoint bicgstab fgmres monolithic";
+            const std::vector< std::string > oem_names = oemSolverNames();
+            for ( std::size_t i = 0; i < oem_names.size(); ++i )
+                if ( oem_names[i] != inner_solver )
+                    default_candidates += " " + Oseen::Solver::name( configured ) + "/" + oem_names[i];
+            std::vector< SolverAutotuner::Candidate > candidates
+                    = SolverAutotuner::parse( DSC_CONFIG_GET( "autotune_candidates", default_candidates ), inner_solver );
+            if ( candidates.empty() )
+                candidates = SolverAutotuner::parse( default_candidates, inner_solver );
+
+            const double absLimit = DSC_CONFIG_GET( "absLimit", 1e-8 );
+            //puts back the relaxed absLimit, whatever a candidate throws
+            struct TrialConfigGuard {
+                const double absLimit;
+                ~TrialConfigGuard() { DSC_CONFIG.set( "absLimit", absLimit ); }
+            } const guard = { absLimit };
+            DSC_CONFIG.set( "absLimit", absLimit * DSC_CONFIG_GET( "autotune_tolerance_factor", 1e3 ) );
+            SolverAutotuner::Candidate best( Oseen::Solver::name( configured ), inner_solver );
+            double best_time = -1.0;
+            for ( std::size_t i = 0; i < candidates.size(); ++i ) {
+                const SolverAutotuner::Candidate& candidate = candidates[i];
+                const ScopedInnerSolver trial_inner_solver( candidate.inner_solver );
+                RangeType trial( dest.space(), dest.discreteVelocity(), dest.discretePressure() );
+                const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                try {
+                    SolverCaller<>::solve( Oseen::Solver::fromName( candidate.strategy ), do_oseen_discretization,
+                                           static_cast< ContainerType* >( 0 ), trial, args... );
+                }
+                catch ( Dune::Exception& e ) {
+                    DSC_LOG_INFO << "autotune: " << candidate.str() << " failed: " << e.what() << std::endl;
+                    continue;
+                }
+                const double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+                DSC_LOG_INFO << "autotune: " << candidate.str() << " " << seconds << "s" << std::endl;
+                if ( best_time < 0.0 || seconds < best_time ) {
+                    best_time = seconds;
+                    best = candidate;
+                }
+            }
+            if ( best_time < 0.0 )
+                DUNE_THROW( InvalidStateException, "autotune: every candidate failed" );
+            DSC_LOG_INFO << "autotune: using " << best.str() << " for the "
+                         << ( do_oseen_discretization ? "oseen" : "stokes" ) << " systems" << std::endl;
+            tuner.setChoice( do_oseen_discretization, best );
+        }
+        return Oseen::Solver::fromName( tuner.choice( do_oseen_discretization ).strategy );
+    }
 };
 
 
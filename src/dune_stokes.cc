@@ -9,6 +9,8 @@
 #include <cstdio>
 #include <vector>
 #include <string>
+#include <sstream>
+#include <memory>
 
 #include <iostream>
 #include <cmath>
@@ -24,7 +26,10 @@
 #include <dune/fem/oseen/functionspacewrapper.hh>
 #include <dune/fem/oseen/modeldefault.hh>
 
+#define OSEEN_ALLOCATION_COUNTER_HOOKS
+#include <dune/fem/oseen/allocation_counter.hh>
 #include <dune/fem/oseen/ldg_method.hh>
+#include <dune/fem/oseen/picard.hh>
 #include <dune/fem/oseen/boundarydata.hh>
 #include <dune/fem/oseen/runinfo.hh>
 #include <dune/fem/oseen/tex.hh>
@@ -338,11 +343,45 @@ DSC::RunInfo singleRun(  CollectiveCommunication& /*mpicomm*/,
     if ( !check( gridPart, oseenLDG, stokesModel, computedSolutions ) )
         DUNE_THROW( Dune::InvalidStateException, check.error() );
     DSC_PROFILER.startTiming( "Pass -- APPLY" );
-    auto last_wrapper ( computedSolutions );
-    oseenLDG.apply( last_wrapper, computedSolutions);
+    if ( DSC_CONFIG_GET( "navier_stokes", false ) ) {
+        //the force of the model problems is the stokes one, errors are against the stokes solution then
+        const auto navierStokesModel = [&]( const double nu ) {
+            return StokesModelImpType( stabil_coeff, AnalyticalForceType( nu, alpha ), analyticalDirichletData,
+                                       nu, alpha, 1.0 /*convection_scale_factor*/, 1.0 /*pressure_gradient_scale_factor*/ );
+        };
+        Dune::Oseen::PicardIteration< OseenLDGMethodType > picard( gridPart, discreteStokesFunctionSpaceWrapper );
+        const Dune::Oseen::PicardInfo picard_info = picard.solve( navierStokesModel, viscosity, computedSolutions,
+                                                                  nullptr, &info );
+        infoStream << "  - picard: " << picard_info.iterations << " oseen solves, residual " << picard_info.residual
+                   << ( picard_info.converged ? "" : " (not converged)" ) << std::endl;
+    }
+    else if ( !DSC_CONFIG_GET( "multi_rhs_force_scalings", std::string() ).empty() ) {
+        //one extra system per listed factor with the force scaled by it, solved together with the unscaled one
+        std::istringstream scalings( DSC_CONFIG_GET( "multi_rhs_force_scalings", std::string() ) );
+        std::vector< StokesModelImpType > rhs_models( 1, stokesModel );
+        std::vector< std::shared_ptr< DiscreteOseenFunctionWrapperType > > extra_solutions;
+        std::vector< DiscreteOseenFunctionWrapperType* > dests( 1, &computedSolutions );
+        double scaling = 1.0;
+        while ( scalings >> scaling ) {
+            rhs_models.push_back( StokesModelImpType( stabil_coeff, AnalyticalForceType( viscosity, alpha, scaling ),
+                                                      analyticalDirichletData, viscosity, alpha, 0.0, 1.0 ) );
+            extra_solutions.push_back( std::make_shared< DiscreteOseenFunctionWrapperType >( "multi_rhs_",
+                                                                                           discreteStokesFunctionSpaceWrapper,
+                                                                                           gridPart ) );
+            extra_solutions.back()->clear();
+            dests.push_back( extra_solutions.back().get() );
+        }
+        oseenLDG.applyMulti( rhs_models, dests );
+        oseenLDG.getRuninfo( info );
+        infoStream << "  - multi rhs: solved " << dests.size() << " systems at once" << std::endl;
+    }
+    else {
+        auto last_wrapper ( computedSolutions );
+        oseenLDG.apply( last_wrapper, computedSolutions);
+        oseenLDG.getRuninfo( info );
+    }
     DSC_PROFILER.stopTiming( "Pass -- APPLY" );
     info.run_time = DSC_PROFILER.getTiming( "Pass -- APPLY" );
-    oseenLDG.getRuninfo( info );
 
     /* ********************************************************************** *
      * Problem postprocessing